@@ -0,0 +1,399 @@
+/*
+ * Modem_AT.c
+ *
+ *  Non-blocking AT command engine and link manager for the RF modem
+ *
+ *  Everything is paced by the timer tick from Modem_AT_service() and the
+ *  UCA3 interrupts, nothing here waits on the UART. Telemetry keeps flowing
+ *  until the message in progress has gone out, then the UART belongs to
+ *  the engine until the script (ending in ATCN) is answered.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+long modem_baud = MODEM_BR1;
+volatile unsigned int modem_rx_errors = 0;
+unsigned int modem_rf_packet = MODEM_RF_PACKET;
+unsigned int modem_at_value = 0;
+
+// Private variables - engine
+static unsigned char at_state = AT_IDLE;
+static unsigned char at_tries;
+static unsigned char at_result;
+static unsigned long at_tick;
+static char *at_script;
+static char *at_line;
+static void (*at_done)(unsigned char result);
+static char at_tx[AT_LINE_SIZE];
+static char at_rx[AT_RESP_SIZE];
+static volatile unsigned char at_rx_n;
+static volatile unsigned char at_resp;
+
+// Private variables - link manager
+static unsigned char link_state = LINK_UP;
+static unsigned long link_fe_tick;
+
+// Private functions
+static void at_send(char *str);
+static void at_send_line(void);
+static void at_finish(unsigned char result);
+static void at_rf_packet(char *script);
+static unsigned int at_param(char *script, char c0, char c1);
+static void link_config_done(unsigned char result);
+static void link_upgrade_done(unsigned char result);
+static void link_verify_done(unsigned char result);
+static void link_fallback_done(unsigned char result);
+static void link_fallback(void);
+
+/*************************************************************
+/ Name: Modem_AT_run
+/ IN: script (AT command lines each ending in CR, without the
+/     "+++"), completion callback (or 0)
+/ OUT:  1 if started, 0 if a script is already running
+/ DESC:  The callback gets AT_RESULT_OK once every line was
+/        answered with OK, AT_RESULT_FAIL otherwise
+************************************************************/
+int Modem_AT_run(char *script, void (*done)(unsigned char result))
+{
+	if(at_state != AT_IDLE) return 0;
+
+	at_script = script;
+	at_done = done;
+	at_tries = 0;
+	at_state = AT_WAIT_TX;
+	return 1;
+}
+
+/*
+ * TRUE while a script is pending, no new telemetry message may start
+ */
+int Modem_AT_busy(void)
+{
+	return (at_state != AT_IDLE);
+}
+
+/*
+ * TRUE while the engine owns the UART (RX replies and TX completion)
+ */
+int Modem_AT_active(void)
+{
+	return (at_state > AT_WAIT_TX);
+}
+
+/*************************************************************
+/ Name: Modem_AT_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part of the engine - guard time, response
+/        checks, retries and the completion callback
+************************************************************/
+void Modem_AT_service(void)
+{
+	extern char put_status_MODEM;
+	unsigned long ticks;
+
+	ticks = tb_get_ticks();
+
+	switch(at_state)
+	{
+	  case AT_WAIT_TX:
+		if(!put_status_MODEM && telem_out_idle(TOUT_SINK_MODEM))	// whole telemetry frame is out
+		{
+			at_tick = ticks;
+			at_state = AT_GUARD;
+		}
+		break;
+	  case AT_GUARD:
+		if(put_status_MODEM) at_tick = ticks;			// guard starts after the last character
+		else if((ticks - at_tick) >= AT_GUARD_TICKS)
+		{
+			at_send(MODEMEsc);
+			at_tick = ticks;
+			at_state = AT_ESCAPE;
+		}
+		break;
+	  case AT_ESCAPE:
+		if(at_resp == AT_RESP_OK)
+		{
+			at_tries = 0;
+			at_line = at_script;
+			at_send_line();
+			at_tick = ticks;
+			at_state = AT_COMMAND;
+		}
+		else if((ticks - at_tick) >= (AT_GUARD_TICKS + AT_OK_TICKS))
+		{
+			at_tries++;
+			if(at_tries >= AT_RETRIES) at_finish(AT_RESULT_FAIL);	// not in command mode, nothing to leave
+			else
+			{
+				at_tick = ticks;
+				at_state = AT_GUARD;
+			}
+		}
+		break;
+	  case AT_COMMAND:
+		if(put_status_MODEM) at_tick = ticks;			// response time counts from the CR
+		else if((at_resp == AT_RESP_OK) || (at_resp == AT_RESP_VALUE))
+		{
+			if(at_resp == AT_RESP_VALUE) modem_at_value = (unsigned int)strtoul(at_rx, 0, 16);
+			while(*at_line != 0x0D && *at_line != '\0') at_line++;
+			if(*at_line == 0x0D) at_line++;
+			if(*at_line == '\0') at_finish(AT_RESULT_OK);
+			else
+			{
+				at_tries = 0;
+				at_send_line();
+				at_tick = ticks;
+			}
+		}
+		else if((at_resp == AT_RESP_ERROR) || ((ticks - at_tick) >= AT_OK_TICKS))
+		{
+			at_tries++;
+			if(at_tries < AT_RETRIES) at_send_line();
+			else
+			{
+				at_result = AT_RESULT_FAIL;
+				at_send("ATCN\r");						// back to data mode
+				at_state = AT_EXIT;
+			}
+			at_tick = ticks;
+		}
+		break;
+	  case AT_EXIT:
+		if(put_status_MODEM) at_tick = ticks;
+		else if((at_resp != AT_RESP_NONE) || ((ticks - at_tick) >= AT_OK_TICKS))
+			at_finish(at_result);						// the modem CT timeout covers a lost ATCN
+		break;
+	  default:
+		break;
+	}
+}
+
+/*************************************************************
+/ Name: Modem_AT_rx_char
+/ IN: received character
+/ OUT:  void
+/ DESC:  Called from the USCI_A3 ISR, collects the modem reply
+/        lines while the engine owns the UART
+************************************************************/
+void Modem_AT_rx_char(char ch)
+{
+	if(!Modem_AT_active()) return;
+
+	if(ch == 0x0D)
+	{
+		at_rx[at_rx_n] = '\0';
+		at_rx_n = 0;
+		if(strcmp(at_rx, "OK") == 0) at_resp = AT_RESP_OK;
+		else if(strcmp(at_rx, "ERROR") == 0) at_resp = AT_RESP_ERROR;
+		else if(isxdigit(at_rx[0]) && (at_state == AT_COMMAND)) at_resp = AT_RESP_VALUE;
+	}
+	else if((ch != 0x0A) && (at_rx_n < AT_RESP_SIZE - 1))
+	{
+		at_rx[at_rx_n++] = ch;
+	}
+}
+
+/*************************************************************
+/ Name: Modem_link_start
+/ IN: void
+/ OUT:  void
+/ DESC:  Configures the modem at MODEM_BR1 and then upgrades
+/        the serial link to MODEM_BR2
+************************************************************/
+void Modem_link_start(void)
+{
+	modem_baud = MODEM_BR1;
+	Modem_UART_baud(modem_baud);
+	link_state = LINK_CONFIG_LOW;
+	Modem_AT_run(RFModemH, link_config_done);
+}
+
+/*************************************************************
+/ Name: Modem_link_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Falls back to MODEM_BR1 when the UCA3 framing errors
+/        exceed LINK_FE_LIMIT in a LINK_FE_WINDOW
+************************************************************/
+void Modem_link_service(void)
+{
+	unsigned long ticks;
+
+	ticks = tb_get_ticks();
+
+	if((link_state != LINK_UP) || (modem_baud != MODEM_BR2))
+	{
+		link_fe_tick = ticks;
+		return;
+	}
+
+	if((ticks - link_fe_tick) >= LINK_FE_WINDOW)
+	{
+		link_fe_tick = ticks;
+		if(modem_rx_errors >= LINK_FE_LIMIT)
+		{
+			link_state = LINK_FALLBACK_HIGH;
+			Modem_AT_run(RFModemBaudL, link_fallback_done);
+		}
+		modem_rx_errors = 0;
+	}
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+static void at_send(char *str)
+{
+	unsigned char ii;
+
+	for(ii = 0; (str[ii] != '\0') && (ii < AT_LINE_SIZE - 1); ii++) at_tx[ii] = str[ii];
+	at_tx[ii] = '\0';
+
+	at_rx_n = 0;
+	at_resp = AT_RESP_NONE;
+	Modem_UART_puts_dma(&at_tx[0], ii);
+}
+
+/*
+ * Sends the script line at at_line, up to and including its CR
+ */
+static void at_send_line(void)
+{
+	unsigned char ii;
+
+	for(ii = 0; (ii < AT_LINE_SIZE - 1) && (at_line[ii] != '\0'); ii++)
+	{
+		at_tx[ii] = at_line[ii];
+		if(at_line[ii] == 0x0D)
+		{
+			ii++;
+			break;
+		}
+	}
+	at_tx[ii] = '\0';
+
+	at_rx_n = 0;
+	at_resp = AT_RESP_NONE;
+	Modem_UART_puts_dma(&at_tx[0], ii);
+}
+
+static void at_finish(unsigned char result)
+{
+	at_state = AT_IDLE;
+	if(result == AT_RESULT_OK) at_rf_packet(at_script);
+	if(at_done) at_done(result);
+}
+
+/*
+ * RF packet size from the ATPK and ATRB of a script, unchanged if it has neither
+ */
+static void at_rf_packet(char *script)
+{
+	unsigned int pk, rb;
+
+	pk = at_param(script, 'P', 'K');
+	rb = at_param(script, 'R', 'B');
+	if(pk == 0) pk = rb;
+	if((rb == 0) || (rb > pk)) rb = pk;
+	if(rb == 0) return;
+	modem_rf_packet = (rb > MODEM_RF_MAX) ? MODEM_RF_MAX : rb;
+}
+
+/*
+ * Hex value of a command ("ATPK 201" or ",PK 201"), 0 if not in the script
+ */
+static unsigned int at_param(char *script, char c0, char c1)
+{
+	char *p;
+
+	for(p = script; (p[0] != '\0') && (p[1] != '\0'); p++)
+	{
+		if((p[0] != c0) || (p[1] != c1)) continue;
+		if((p == script) || ((p[-1] != 'T') && (p[-1] != ','))) continue;
+		return (unsigned int)strtoul(&p[2], 0, 16);
+	}
+	return 0;
+}
+
+/*
+ * Link bring-up callbacks, run from Modem_AT_service()
+ */
+static void link_config_done(unsigned char result)
+{
+	if(result == AT_RESULT_OK)
+	{
+		// RFModemH leaves the modem at MODEM_BR1 (ATBD 3)
+		modem_baud = MODEM_BR1;
+		Modem_UART_baud(modem_baud);
+		link_state = LINK_UPGRADE;
+		Modem_AT_run(RFModemBaud, link_upgrade_done);
+	}
+	else if(link_state == LINK_CONFIG_LOW)
+	{
+		// No answer at MODEM_BR1, the modem may still run MODEM_BR2 from before an MCU reset
+		modem_baud = MODEM_BR2;
+		Modem_UART_baud(modem_baud);
+		link_state = LINK_CONFIG_HIGH;
+		Modem_AT_run(RFModemH, link_config_done);
+	}
+	else
+	{
+		modem_baud = MODEM_BR1;					// modem not answering, keep the default
+		Modem_UART_baud(modem_baud);
+		link_state = LINK_UP;
+	}
+}
+
+static void link_upgrade_done(unsigned char result)
+{
+	if(result == AT_RESULT_OK)
+	{
+		// ATCN answered at MODEM_BR1, the modem now runs ATBD 7
+		modem_baud = MODEM_BR2;
+		Modem_UART_baud(modem_baud);
+		link_state = LINK_VERIFY;
+		Modem_AT_run(RFModemVerify, link_verify_done);
+	}
+	else link_state = LINK_UP;					// stays at MODEM_BR1
+}
+
+static void link_verify_done(unsigned char result)
+{
+	if(result == AT_RESULT_OK)
+	{
+		modem_rx_errors = 0;
+		link_state = LINK_UP;
+	}
+	else link_fallback();
+}
+
+/*
+ * Back to MODEM_BR1, tried at MODEM_BR1 first and then at MODEM_BR2
+ */
+static void link_fallback(void)
+{
+	modem_baud = MODEM_BR1;
+	Modem_UART_baud(modem_baud);
+	link_state = LINK_FALLBACK;
+	Modem_AT_run(RFModemBaudL, link_fallback_done);
+}
+
+static void link_fallback_done(unsigned char result)
+{
+	if((result != AT_RESULT_OK) && (link_state == LINK_FALLBACK))
+	{
+		modem_baud = MODEM_BR2;
+		Modem_UART_baud(modem_baud);
+		link_state = LINK_FALLBACK_HIGH;
+		Modem_AT_run(RFModemBaudL, link_fallback_done);
+		return;
+	}
+
+	modem_baud = MODEM_BR1;						// ATBD 3 answered or nothing left to try
+	Modem_UART_baud(modem_baud);
+	link_state = LINK_UP;
+}
@@ -0,0 +1,80 @@
+/*
+ * Modem_AT.h
+ *
+ *  Non-blocking AT command engine for the RF modem on UCA3
+ *
+ *  - A script is a string of AT command lines, each ending in CR
+ *  - The engine waits for the telemetry message in progress, the guard
+ *    time, sends "+++" and then one line at a time, each answered by
+ *    "OK" or "ERROR" with retries
+ *  - The completion callback runs from Modem_AT_service() in the main loop
+ *  - A reply other than OK/ERROR to a query line ("ATDB") is taken as its
+ *    hex value, kept in modem_at_value, and the script goes on
+ *
+ *  The link manager brings the modem up at MODEM_BR1, upgrades to
+ *  MODEM_BR2 and falls back when UCA3 framing errors build up.
+ *
+ *  A script answered with OK also sets the RF packet size the telemetry
+ *  packer fills, the smaller of its ATPK (packet size) and ATRB
+ *  (packetization threshold, the radio starts sending at RB bytes).
+ */
+
+#ifndef MODEM_AT_H_
+#define MODEM_AT_H_
+
+#define AT_LINE_SIZE		32
+#define AT_RESP_SIZE		16
+#define AT_RETRIES			3
+#define AT_GUARD_TICKS		(TICK_RATE + TICK_RATE/4)	// > 1 s silence around "+++" (ATGT default)
+#define AT_OK_TICKS			(TICK_RATE*2)				// response wait after each line
+
+// Engine states
+#define AT_IDLE				0
+#define AT_WAIT_TX			1		// telemetry message still going out
+#define AT_GUARD			2		// silence before "+++"
+#define AT_ESCAPE			3		// "+++" sent, waiting for OK
+#define AT_COMMAND			4		// command line sent, waiting for OK/ERROR
+#define AT_EXIT				5		// script failed, ATCN sent to leave command mode
+
+// Responses and results
+#define AT_RESP_NONE		0
+#define AT_RESP_OK			1
+#define AT_RESP_ERROR		2
+#define AT_RESP_VALUE		3		// query reply, in at_rx until the next line is sent
+#define AT_RESULT_OK		1
+#define AT_RESULT_FAIL		0
+
+// Link manager
+#define LINK_CONFIG_LOW		0		// config script at MODEM_BR1
+#define LINK_CONFIG_HIGH	1		// config script at MODEM_BR2 (modem kept BR2 over an MCU reset)
+#define LINK_UPGRADE		2		// ATBD 7
+#define LINK_VERIFY			3		// "+++"/OK at MODEM_BR2
+#define LINK_FALLBACK		4		// ATBD 3 sent at MODEM_BR1
+#define LINK_FALLBACK_HIGH	5		// ATBD 3 sent at MODEM_BR2
+#define LINK_UP				6
+
+#define LINK_FE_WINDOW		(TICK_RATE*10)		// framing error check period
+#define LINK_FE_LIMIT		8					// framing errors per window before fallback
+
+// RF packets
+#define MODEM_RF_PACKET		0x12F				// RB 12F of RFModemH, until a script sets it
+#define MODEM_RF_MAX		0x201				// largest size taken from a script
+#define MODEM_RF_OVERHEAD	16					// air bytes per RF packet (preamble, header, CRC), estimate
+
+// Public variables
+extern long modem_baud;							// current UCA3 rate
+extern volatile unsigned int modem_rx_errors;	// UCA3 framing/overrun errors
+extern unsigned int modem_rf_packet;			// bytes per RF packet
+extern unsigned int modem_at_value;				// last query reply
+
+// Public functions
+int Modem_AT_run(char *script, void (*done)(unsigned char result));
+int Modem_AT_busy(void);
+int Modem_AT_active(void);
+void Modem_AT_service(void);
+void Modem_AT_rx_char(char ch);
+
+void Modem_link_start(void);
+void Modem_link_service(void);
+
+#endif /* MODEM_AT_H_ */
@@ -1,128 +1,142 @@
-/*
- *  Originally Written for TELEMETRY 2021 PCB Development
- * 
- *  Modem_UART to Modem UCA3 Interface
- *
- *  Clock and microcontroller Initialization RS232
- */
-
-// Include files
-#include "Modem_RS232.h"
-
-#include <msp430x54xa.h>
-#include "Sunseeker2021.h"
-
-/*********************************************************************************/
-// Modem_UART to Modem UCA3 Interface (voltage isolated)
-/*********************************************************************************/
-void Modem_UART_init(void)
-{
-    UCA3CTL1 |= UCSWRST | UCSSEL_2;	//put state machine in reset & SMCLK
-    UCA3CTL0 |= UCMODE_0;
-    UCA3BRW = (int)(SMCLK_RATE/MODEM_BR1);	//10MHZ/9600
-    UCA3MCTL |= UCBRF_0 + (char)MODEM_UCBRS1; //modulation UCBRSx=computed from baud rate UCBRFx=0
-	
-	UCA3IFG &= ~UCTXIFG;			//Clear Xmit and Rec interrupt flags
-	UCA3IFG &= ~UCRXIFG;
-	UCA3CTL1 &= ~UCSWRST;			// initalize state machine
-	UCA3ABCTL |= UCABDEN;			// automatic baud rate
-
-//  UCA3IE |= UCRXIE|UCTXIE;		//enable TX & RX interrupt
-}
-
-/*********************************************************************************/
-// Special MODEM routines
-/*********************************************************************************/
-void MODEM_command_puts(char data[])
-{
-  int ii;
-  Modem_UART_puts(MODEMCmd);
-  for (ii=0;ii<0x100;ii++) delay();
-
-  Modem_UART_puts(data);
-  // Note: after the completion of the data send
-  // an "OK" is sent of the command is executed
-  // an "ERROR" is sent if there is an error
-}
-
-
-
-/*********************************************************************************/
-// Typical polling based getchr & gets and putchr & puts
-/*********************************************************************************/
-void Modem_UART_putchar(char data)
-{
-    while((UCA3IFG & UCTXIFG) == 0);
-    UCA3TXBUF = data; 
-}
-
-unsigned char Modem_UART_getchar(void)
-{
-	char i = 100; //avoid infinite loop
-
-    while((UCA3IFG & UCRXIFG) == 0 && i != 0)
-    {
-    	i--;
-    }
-    return(UCA3RXBUF);
-}
-
-int Modem_UART_puts(char *str)
-{
-	int i;
-    char ch;
-    i = 0;
-
-    while((ch=*str)!= '\0')
-    {
-    	Modem_UART_putchar(ch);
-    	str++;
-    	i++;
-    }
-    
-    return(i);
-}
-
-int Modem_UART_gets(char *ptr)
-{
-    int i;
-    i = 0;
-    while (1) {
-          *ptr = Modem_UART_getchar();
-          if (*ptr == 0x0D){
-             *ptr = 0;
-             return(i);
-          }
-          else 
-          {
-          	ptr++;
-          	i++;
-          }
-     }
-}
-
-/*********************************************************************************/
-// Typical interrupt based puts
-/*********************************************************************************/
-
-void Modem_UART_puts_int(void)
-{
-    extern char *Modem_TX_ptr;
-    extern char put_status_MODEM;
-    char ch;
-    
-    ch = *Modem_TX_ptr++;
-
-	if (ch == '\0')
-	{
-		UCA3IE &= ~UCTXIE;
-		put_status_MODEM = FALSE;
-	}
-	else
-	{
-		UCA3TXBUF = ch;
-		UCA3IE |= UCTXIE;
-		put_status_MODEM = TRUE;
-	}
-}
-
+/*
+ *  Originally Written for TELEMETRY 2021 PCB Development
+ * 
+ *  Modem_UART to Modem UCA3 Interface
+ *
+ *  Clock and microcontroller Initialization RS232
+ */
+
+// Include files
+#include "Modem_RS232.h"
+
+#include <msp430x54xa.h>
+#include "Sunseeker2021.h"
+
+// Private variables
+static unsigned int modem_dma_period = UART_DMA_PERIOD(MODEM_BR1);
+
+/*********************************************************************************/
+// Modem_UART to Modem UCA3 Interface (voltage isolated)
+/*********************************************************************************/
+void Modem_UART_init(void)
+{
+    UCA3CTL1 |= UCSWRST | UCSSEL_2;	//put state machine in reset & SMCLK
+    UCA3CTL1 |= UCRXEIE;			//characters with framing/parity errors still set UCRXIFG
+    UCA3CTL0 |= UCMODE_0;
+    UCA3BRW = UART_BRW(MODEM_BR1);	//10MHZ/9600
+    UCA3MCTL = UART_MCTL(MODEM_BR1);	//modulation and oversampling from uart_baud.h
+	
+	UCA3IFG &= ~UCTXIFG;			//Clear Xmit and Rec interrupt flags
+	UCA3IFG &= ~UCRXIFG;
+	UCA3CTL1 &= ~UCSWRST;			// initalize state machine
+	UCA3ABCTL |= UCABDEN;			// automatic baud rate
+
+	UCA3IE |= UCRXIE;				//enable RX interrupt, TX interrupt is enabled per message
+}
+
+/*************************************************************
+/ Name: Modem_UART_baud
+/ IN: baud rate, MODEM_BR1 or MODEM_BR2
+/ OUT:  void
+/ DESC:  Reprograms UCA3 between messages, the reset clears
+/        the interrupt enables so RX is enabled again
+************************************************************/
+void Modem_UART_baud(long rate)
+{
+    UCA3CTL1 |= UCSWRST;			//put state machine in reset
+    UCA3CTL1 |= UCRXEIE;			//errored characters reach the ISR error count
+    if(rate == MODEM_BR2)
+    {
+        UCA3BRW = UART_BRW(MODEM_BR2);	//10MHZ/115200
+        UCA3MCTL = UART_MCTL(MODEM_BR2);
+        modem_dma_period = UART_DMA_PERIOD(MODEM_BR2);
+    }
+    else
+    {
+        UCA3BRW = UART_BRW(MODEM_BR1);	//10MHZ/9600
+        UCA3MCTL = UART_MCTL(MODEM_BR1);
+        modem_dma_period = UART_DMA_PERIOD(MODEM_BR1);
+    }
+	UCA3CTL1 &= ~UCSWRST;			// initalize state machine
+	UCA3IE |= UCRXIE;
+}
+
+/*********************************************************************************/
+// Typical polling based getchr & gets and putchr & puts
+/*********************************************************************************/
+void Modem_UART_putchar(char data)
+{
+    while((UCA3IFG & UCTXIFG) == 0);
+    UCA3TXBUF = data; 
+}
+
+unsigned char Modem_UART_getchar(void)
+{
+	char i = 100; //avoid infinite loop
+
+    while((UCA3IFG & UCRXIFG) == 0 && i != 0)
+    {
+    	i--;
+    }
+    return(UCA3RXBUF);
+}
+
+int Modem_UART_puts(char *str)
+{
+	int i;
+    char ch;
+    i = 0;
+
+    while((ch=*str)!= '\0')
+    {
+    	Modem_UART_putchar(ch);
+    	str++;
+    	i++;
+    }
+    
+    return(i);
+}
+
+int Modem_UART_gets(char *ptr)
+{
+    int i;
+    i = 0;
+    while (1) {
+          *ptr = Modem_UART_getchar();
+          if (*ptr == 0x0D){
+             *ptr = 0;
+             return(i);
+          }
+          else 
+          {
+          	ptr++;
+          	i++;
+          }
+     }
+}
+
+/*********************************************************************************/
+// DMA based puts
+// - UCA3 has no DMA trigger, Timer A1 CCR0 paces DMA0 at UART_DMA_PERIOD
+// - the DMA0 interrupt (Telem_main.c) stops the timer and signals completion
+/*********************************************************************************/
+
+int Modem_UART_puts_dma(char *str, unsigned int len)
+{
+    extern char put_status_MODEM;
+
+    if(put_status_MODEM || (len == 0)) return 0;
+    put_status_MODEM = TRUE;
+
+    DMA0CTL = 0;
+    DMACTL0 = (DMACTL0 & ~DMA0TSEL_31) | DMA0TSEL_3;	// TA1CCR0 trigger
+    DMACTL4 = DMARMWDIS;							// no transfers inside CPU read-modify-write
+    __data16_write_addr((unsigned short)&DMA0SA, (unsigned long)str);
+    __data16_write_addr((unsigned short)&DMA0DA, (unsigned long)&UCA3TXBUF);
+    DMA0SZ = len;
+    DMA0CTL = DMADT_0 | DMASRCINCR_3 | DMADSTINCR_0 | DMASRCBYTE | DMADSTBYTE | DMAIE | DMAEN;
+
+    TA1CCR0 = modem_dma_period - 1;
+    TA1CTL = TASSEL_2 | MC_1 | TACLR;				// SMCLK, up mode, first byte after one period
+    return 1;
+}
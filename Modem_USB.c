@@ -1,113 +1,111 @@
-/*
- *  Originally Written for TELEMETRY 2021 PCB Development
- *
- *  Modem_UART to USB UCA2 Interface
- *
- *  Clock and microcontroller Initialization USB
- */
-
-// Include files
-#include "Modem_USB.h"
-
-#include <msp430x54xa.h>
-#include "Sunseeker2021.h"
-
-/*********************************************************************************/
-// Modem_USB to Modem UCA2 Interface (voltage isolated)
-/*********************************************************************************/
-void Modem_USB_init(void)
-{
-    UCA2CTL1 |= UCSWRST | UCSSEL_3;	//put state machine in reset & SMCLK
-    UCA2CTL0 |= UCMODE_0;
-    UCA2BRW = (int)(SMCLK_RATE/MODEM_BR1);	//10MHZ/9600
-    UCA2MCTL |= UCBRF_0 + (char)MODEM_UCBRS1; //modulation UCBRSx=computed from baud rate UCBRFx=0
-
-	UCA2IFG &= ~UCTXIFG;			//Clear Xmit and Rec interrupt flags
-	UCA2IFG &= ~UCRXIFG;
-	UCA2CTL1 &= ~UCSWRST;			// initalize state machine
-	UCA2ABCTL |= UCABDEN;			// automatic baud rate
-
-//  UCA2IE |= UCRXIE|UCTXIE;		//enable TX & RX interrupt
-}
-
-/*********************************************************************************/
-// Typical polling based getchr & gets and putchr & puts
-/*********************************************************************************/
-void Modem_USB_putchar(char data)
-{
-    while((UCA2IFG & UCTXIFG) == 0);
-    UCA2TXBUF = data;
-}
-
-unsigned char Modem_USB_getchar(void)
-{
-	char i = 100; //avoid infinite loop
-
-    while((UCA2IFG & UCRXIFG) == 0 && i != 0)
-    {
-    	i--;
-    }
-    return(UCA2RXBUF);
-}
-
-int Modem_USB_puts(char *str)
-{
-	int i;
-    char ch;
-    i = 0;
-
-    while((ch=*str)!= '\0')
-    {
-    	Modem_USB_putchar(ch);
-    	str++;
-    	i++;
-    }
-
-    return(i);
-}
-
-int Modem_USB_gets(char *ptr)
-{
-    int i;
-    i = 0;
-    while (1) {
-          *ptr = Modem_USB_getchar();
-          if (*ptr == 0x0D){
-             *ptr = 0;
-             return(i);
-          }
-          else
-          {
-          	ptr++;
-          	i++;
-          }
-     }
-}
-
-/*********************************************************************************/
-// Typical interrupt based puts
-/*********************************************************************************/
-
-void Modem_USB_puts_int(void)
-{
-    extern char *USB_TX_ptr;
-    extern char put_status_USB;
-    char ch;
-
-    ch = *USB_TX_ptr++;
-
-	if (ch == '\0')
-	{
-		UCA2IE &= ~UCTXIE;
-		put_status_USB = FALSE;
-	}
-	else
-	{
-		UCA2TXBUF = ch;
-		UCA2IE |= UCTXIE;
-		put_status_USB = TRUE;
-	}
-}
-
-
-
+/*
+ *  Originally Written for TELEMETRY 2021 PCB Development
+ *
+ *  Modem_UART to USB UCA2 Interface
+ *
+ *  Clock and microcontroller Initialization USB
+ */
+
+// Include files
+#include "Modem_USB.h"
+
+#include <msp430x54xa.h>
+#include "Sunseeker2021.h"
+
+/*********************************************************************************/
+// Modem_USB to Modem UCA2 Interface (voltage isolated)
+/*********************************************************************************/
+void Modem_USB_init(void)
+{
+    UCA2CTL1 |= UCSWRST | UCSSEL_3;	//put state machine in reset & SMCLK
+    UCA2CTL0 |= UCMODE_0;
+    UCA2BRW = UART_BRW(USB_BR);		//10MHZ/USB_BR
+    UCA2MCTL = UART_MCTL(USB_BR);	//modulation and oversampling from uart_baud.h
+
+	UCA2IFG &= ~UCTXIFG;			//Clear Xmit and Rec interrupt flags
+	UCA2IFG &= ~UCRXIFG;
+	UCA2CTL1 &= ~UCSWRST;			// initalize state machine
+	UCA2ABCTL |= UCABDEN;			// automatic baud rate
+
+    UCA2IE |= UCRXIE;				//enable RX interrupt, command lines
+}
+
+/*********************************************************************************/
+// Typical polling based getchr & gets and putchr & puts
+/*********************************************************************************/
+void Modem_USB_putchar(char data)
+{
+    while((UCA2IFG & UCTXIFG) == 0);
+    UCA2TXBUF = data;
+}
+
+unsigned char Modem_USB_getchar(void)
+{
+	char i = 100; //avoid infinite loop
+
+    while((UCA2IFG & UCRXIFG) == 0 && i != 0)
+    {
+    	i--;
+    }
+    return(UCA2RXBUF);
+}
+
+int Modem_USB_puts(char *str)
+{
+	int i;
+    char ch;
+    i = 0;
+
+    while((ch=*str)!= '\0')
+    {
+    	Modem_USB_putchar(ch);
+    	str++;
+    	i++;
+    }
+
+    return(i);
+}
+
+int Modem_USB_gets(char *ptr)
+{
+    int i;
+    i = 0;
+    while (1) {
+          *ptr = Modem_USB_getchar();
+          if (*ptr == 0x0D){
+             *ptr = 0;
+             return(i);
+          }
+          else
+          {
+          	ptr++;
+          	i++;
+          }
+     }
+}
+
+/*********************************************************************************/
+// DMA based puts
+// - UCA2 has no DMA trigger, Timer A0 CCR0 paces DMA1 at UART_DMA_PERIOD
+// - the DMA1 interrupt (Telem_main.c) stops the timer and signals completion
+/*********************************************************************************/
+
+int Modem_USB_puts_dma(char *str, unsigned int len)
+{
+    extern char put_status_USB;
+
+    if(put_status_USB || (len == 0)) return 0;
+    put_status_USB = TRUE;
+
+    DMA1CTL = 0;
+    DMACTL0 = (DMACTL0 & ~DMA1TSEL_31) | DMA1TSEL_1;	// TA0CCR0 trigger
+    DMACTL4 = DMARMWDIS;							// no transfers inside CPU read-modify-write
+    __data16_write_addr((unsigned short)&DMA1SA, (unsigned long)str);
+    __data16_write_addr((unsigned short)&DMA1DA, (unsigned long)&UCA2TXBUF);
+    DMA1SZ = len;
+    DMA1CTL = DMADT_0 | DMASRCINCR_3 | DMADSTINCR_0 | DMASRCBYTE | DMADSTBYTE | DMAIE | DMAEN;
+
+    TA0CCR0 = UART_DMA_PERIOD(USB_BR) - 1;
+    TA0CTL = TASSEL_2 | MC_1 | TACLR;				// SMCLK, up mode, first byte after one period
+    return 1;
+}
@@ -0,0 +1,19 @@
+/*
+ * budget.c
+ *
+ *  Bandwidth budget report, the figures checked in budget.h
+ */
+
+#include "Sunseeker2021.h"
+
+const budget_line budget_report[] = {
+  {"modem ASCII, RATE_DIV_MIN, FEC",	BUDGET_FEC(BUDGET_MODEM_FRAME),	RATE_DIV_MIN,		MODEM_BR1,			BUDGET_MODEM_UTIL},
+  {"modem binary, RATE_DIV_MIN, FEC",	BUDGET_FEC(BUDGET_MODEM_BIN),	RATE_DIV_MIN,		MODEM_BR1,			BUDGET_MODEM_BUTIL},
+  {"modem ASCII, nominal",				BUDGET_MODEM_FRAME,				TOUT_MODEM_DIV,		MODEM_BR1,			BUDGET_MODEM_NOM},
+  {"modem background, per tick",		BUDGET_BG_PART*TOUT_BG_PER_TICK, 1,					MODEM_BR1,			BUDGET_BG_UTIL},
+  {"modem alarm queue, ms to drain",	TOUT_ALARMS*TOUT_ALARM_SIZE,		0,					MODEM_BR1,			BUDGET_ALARM_MS},
+  {"USB ASCII",							BUDGET_USB_FRAME,				TOUT_USB_DIV,		USB_BR,				BUDGET_USB_UTIL},
+  {"CAN0 AC slot",						BUDGET_CAN_AC,					AC_COMMS_SPEED,		BUDGET_CAN_BITRATE,	BUDGET_CAN(BUDGET_CAN_AC, AC_COMMS_SPEED)},
+  {"CAN0 status",						BUDGET_CAN_STATUS,				TELEM_STATUS_COUNT,	BUDGET_CAN_BITRATE,	BUDGET_CAN(BUDGET_CAN_STATUS, TELEM_STATUS_COUNT)},
+  {0, 0, 0, 0, 0}
+};
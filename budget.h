@@ -0,0 +1,86 @@
+/*
+ * budget.h
+ *
+ *  Compile time bandwidth budget of the telemetry links
+ *
+ *  Every packet class is counted as bytes (or CAN frames) per period in
+ *  ticks and turned into link utilisation in 0.01 % units:
+ *   - UART: 10 bits per byte at the class's baud rate
+ *   - CAN0: BUDGET_CAN_BITS per frame (8 data bytes, worst case bit
+ *     stuffing) at BUDGET_CAN_BITRATE
+ *  Classes that must always fit fail the build above their limit. Filler
+ *  (background parts) and bursts (alarm queue) are only reported, the
+ *  output layer sends them in the idle time the checked classes leave.
+ *
+ *  The same figures are kept in budget_report[] (budget.c), readable from
+ *  the image with the debugger or the map file.
+ */
+
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#define BUDGET_UART_LIMIT	7000		// 70.00 %, headroom for alarms, backfill and retries
+#define BUDGET_CAN_LIMIT	1000		// 10.00 % of CAN0 for this board's own frames
+#define BUDGET_CAN_BITRATE	250000UL	// can0_init CNF1 BRP = 3
+#define BUDGET_CAN_BITS		135UL		// standard frame, 8 data bytes, stuffed, with IFS
+
+// CAN0 frames sent by the main loop, keep in step with Telem_main.c
+#define BUDGET_CAN_AC		3			// worst AC_comm_flag slot (shunt + 2 MPPT frames)
+#define BUDGET_CAN_STATUS	6			// status_flag: ID, TM_BOOT, TM_ALARM_LAT, TM_RF_EFF, TM_RATE, TM_SDLOG
+
+// Utilisation in 0.01 % of bytes every ticks at br baud, and of CAN frames every ticks
+#define BUDGET_UART(bytes,ticks,br)	((bytes)*10UL*TICK_RATE*10000UL / ((ticks)*1UL*(br)))
+#define BUDGET_CAN(frames,ticks)	((frames)*BUDGET_CAN_BITS*TICK_RATE*10000UL / ((ticks)*BUDGET_CAN_BITRATE))
+
+// Bytes on the UART with FEC codewords around n bytes
+#define BUDGET_FEC(n)		((n) + (((n) + FEC_DATA - 1) / FEC_DATA)*(FEC_BLOCK - FEC_DATA))
+
+// Packet classes
+#define BUDGET_MODEM_FRAME	(TOUT_ASCII_SIZE + TOUT_RECORD_SIZE)	// HF packet with CRC line and sequence tag
+#define BUDGET_MODEM_BIN	(TOUT_BIN_SIZE + TOUT_BIN_HEADER + 8 + TOUT_BIN_TRAILER)
+#define BUDGET_USB_FRAME	TOUT_ASCII_SIZE
+#define BUDGET_BG_PART		HIST_PART_SIZE							// largest background part
+
+// Checked: fastest modem period the rate controller may pick, at the lower modem rate, with FEC
+#define BUDGET_MODEM_UTIL	BUDGET_UART(BUDGET_FEC(BUDGET_MODEM_FRAME), RATE_DIV_MIN, MODEM_BR1)
+#define BUDGET_MODEM_BUTIL	BUDGET_UART(BUDGET_FEC(BUDGET_MODEM_BIN), RATE_DIV_MIN, MODEM_BR1)
+#define BUDGET_USB_UTIL		BUDGET_UART(BUDGET_USB_FRAME, TOUT_USB_DIV, USB_BR)
+#define BUDGET_CAN_UTIL		(BUDGET_CAN(BUDGET_CAN_AC, AC_COMMS_SPEED) + BUDGET_CAN(BUDGET_CAN_STATUS, TELEM_STATUS_COUNT))
+
+// Reported: nominal modem period, background filler and one full alarm queue
+#define BUDGET_MODEM_NOM	BUDGET_UART(BUDGET_MODEM_FRAME, TOUT_MODEM_DIV, MODEM_BR1)
+#define BUDGET_BG_UTIL		BUDGET_UART(BUDGET_BG_PART*TOUT_BG_PER_TICK, 1, MODEM_BR1)
+#define BUDGET_ALARM_MS		(TOUT_ALARMS*TOUT_ALARM_SIZE*10UL*1000UL / MODEM_BR1)
+
+/*
+ * Budget checks
+ */
+#if BUDGET_MODEM_UTIL > BUDGET_UART_LIMIT
+#error "Modem ASCII frames at RATE_DIV_MIN exceed BUDGET_UART_LIMIT of MODEM_BR1"
+#endif
+
+#if BUDGET_MODEM_BUTIL > BUDGET_UART_LIMIT
+#error "Modem binary frames at RATE_DIV_MIN exceed BUDGET_UART_LIMIT of MODEM_BR1"
+#endif
+
+#if BUDGET_USB_UTIL > BUDGET_UART_LIMIT
+#error "USB frames at TOUT_USB_DIV exceed BUDGET_UART_LIMIT of USB_BR"
+#endif
+
+#if BUDGET_CAN_UTIL > BUDGET_CAN_LIMIT
+#error "CAN0 transmit schedule exceeds BUDGET_CAN_LIMIT"
+#endif
+
+typedef struct _budget_line
+{
+  const char *name;
+  unsigned int bytes;				// per period, CAN: frames
+  unsigned int ticks;				// period
+  unsigned long rate;				// baud or CAN bit rate
+  unsigned int util;				// 0.01 %
+} budget_line;
+
+// Public variables
+extern const budget_line budget_report[];
+
+#endif /* BUDGET_H_ */
@@ -0,0 +1,236 @@
+/*
+ * capture.c
+ *
+ *  Triggered full rate capture of motor controller frames
+ *
+ *  Recording is one record copy per selected frame in decode(). Times are
+ *  kept as tb_now() counts and only turned into ms when the dump is sent.
+ */
+
+#include "Sunseeker2021.h"
+
+// Rows recorded at full rate, by CAN address, 0 terminated
+static const unsigned int cap_select[] = {
+  MC_CAN_BASE1 + MC_LIMITS, MC_CAN_BASE1 + MC_BUS, MC_CAN_BASE1 + MC_VELOCITY,
+  MC_CAN_BASE1 + MC_PHASE, MC_CAN_BASE1 + MC_V_VECTOR, MC_CAN_BASE1 + MC_I_VECTOR,
+  MC_CAN_BASE1 + MC_BEMF_VECTOR, MC_CAN_BASE1 + MC_SLIPSPEED, 0};
+
+// Private variables
+static cap_record cap_ring[CAP_RECORDS];
+static unsigned char cap_sel[LOOKUP_ROWS];		// TRUE for recorded rows
+static unsigned char cap_state = CAP_ARMED;
+static unsigned int cap_head;					// next record written
+static unsigned int cap_count;					// valid records
+static unsigned int cap_cause;
+static unsigned long cap_trig_time;				// tb_now() of the trigger
+static unsigned long cap_trig_ms;				// ms of day of the trigger
+static unsigned long cap_trig_tick;
+static unsigned int cap_dump;					// 0 = start, 1..cap_count = records, cap_count+1 = end
+static char cap_line[CAP_LINE_SIZE];
+static unsigned char cap_seq = 0;
+
+// Private functions
+static void cap_cmd(unsigned char port, char *args);
+static unsigned int cap_render_ascii(void);
+static unsigned int cap_render_binary(void);
+static long cap_offset(cap_record *rec);
+
+/*************************************************************
+/ Name: capture_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Marks the recorded rows, arms the capture and adds the
+/        "capture" command (after cmd_init)
+************************************************************/
+void capture_init(void)
+{
+	const unsigned int *addr;
+	int off, pos, pck, row;
+
+	for(row = 0; row < LOOKUP_ROWS; row++) cap_sel[row] = FALSE;
+	for(addr = cap_select; *addr != 0; addr++)
+		if(lookup(*addr, &off, &pos, &pck, &row)) cap_sel[row] = TRUE;
+
+	cap_head = 0;
+	cap_count = 0;
+	cap_state = CAP_ARMED;
+
+	cmd_register("capture", cap_cmd);
+}
+
+/*************************************************************
+/ Name: capture_frame
+/ IN: lookup row, CAN payload
+/ OUT:  void
+/ DESC:  Called by decode() for every frame in the lookup table,
+/        selected rows are recorded unless the ring is frozen
+************************************************************/
+void capture_frame(int row, unsigned char *data)
+{
+	cap_record *rec;
+	int ii;
+
+	if(!cap_sel[row] || (cap_state == CAP_FROZEN)) return;
+
+	rec = &cap_ring[cap_head];
+	rec->time = tb_now();
+	rec->row = (unsigned char)row;
+	for(ii = 0; ii < 8; ii++) rec->data[ii] = data[ii];
+
+	cap_head = (cap_head + 1) & (CAP_RECORDS - 1);
+	if(cap_count < CAP_RECORDS) cap_count++;
+}
+
+/*************************************************************
+/ Name: capture_trigger
+/ IN: cause (rule alarm code or CAP_CAUSE_CMD)
+/ OUT:  void
+/ DESC:  Starts the post trigger window, ignored while a capture
+/        is being completed or sent
+************************************************************/
+void capture_trigger(unsigned int cause)
+{
+	if(cap_state != CAP_ARMED) return;
+
+	cap_cause = cause;
+	cap_trig_time = tb_now();
+	cap_trig_ms = tb_get_ms();
+	cap_trig_tick = tb_get_ticks();
+	cap_state = CAP_POST;
+}
+
+/*************************************************************
+/ Name: capture_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - freezes the ring at the end of the
+/        post trigger window
+************************************************************/
+void capture_service(void)
+{
+	if((cap_state == CAP_POST) && ((tb_get_ticks() - cap_trig_tick) >= CAP_POST_TICKS))
+	{
+		cap_dump = 0;
+		cap_state = CAP_FROZEN;
+	}
+}
+
+/*************************************************************
+/ Name: capture_next
+/ IN: sink format, pointer to the part
+/ OUT:  length of the next dump part, 0 if nothing to send
+/ DESC:  Background source of the telemetry output layer, the
+/        same part is returned until capture_sent()
+************************************************************/
+unsigned int capture_next(unsigned char format, char **buf)
+{
+	if(cap_state != CAP_FROZEN) return 0;
+
+	*buf = cap_line;
+	return (format == TOUT_BINARY) ? cap_render_binary() : cap_render_ascii();
+}
+
+/*
+ * Last part from capture_next() is out, re-arms after the end marker
+ */
+void capture_sent(void)
+{
+	if(cap_state != CAP_FROZEN) return;
+
+	cap_seq++;
+	cap_dump++;
+	if(cap_dump > cap_count + 1)
+	{
+		cap_head = 0;
+		cap_count = 0;
+		cap_state = CAP_ARMED;
+	}
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+static void cap_cmd(unsigned char port, char *args)
+{
+	capture_trigger(CAP_CAUSE_CMD);
+}
+
+static unsigned int cap_render_ascii(void)
+{
+	cap_record *rec;
+	unsigned int n;
+
+	if((cap_dump == 0) || (cap_dump > cap_count))
+	{
+		memcpy(cap_line, (cap_dump == 0) ? "TL_CPS," : "TL_CPE,", 7);
+		n = 7;
+		n += telem_out_hex32(&cap_line[n], (cap_dump == 0) ? cap_trig_ms : 0);
+		cap_line[n++] = ',';
+		n += telem_out_hex32(&cap_line[n], (cap_dump == 0) ? (((unsigned long)cap_cause << 16) | cap_count) : cap_count);
+	}
+	else
+	{
+		rec = &cap_ring[(cap_head - cap_count + cap_dump - 1) & (CAP_RECORDS - 1)];
+		for(n = 0; n < 6; n++) cap_line[n] = name_lookup[rec->row][n];
+		cap_line[n++] = ',';
+		n += telem_out_hex_data(&cap_line[n], rec->data);
+		cap_line[n++] = ',';
+		n += telem_out_hex32(&cap_line[n], (unsigned long)cap_offset(rec));
+	}
+	return telem_out_crc_field(cap_line, n);
+}
+
+/*
+ * A5 5A type seq 0D 00 | offset (4) | row (1) | data (8) | crc
+ * Start: offset = trigger ms of day, row 0xFF, data = cause, records
+ * End:   row 0xFE, data = records sent
+ */
+static unsigned int cap_render_binary(void)
+{
+	unsigned char *p;
+	cap_record *rec;
+	unsigned long t;
+	unsigned int ii;
+
+	p = (unsigned char *)cap_line;
+	for(ii = TOUT_BIN_HEADER; ii < TOUT_BIN_HEADER + 13; ii++) p[ii] = 0;
+
+	if(cap_dump == 0)
+	{
+		t = cap_trig_ms;
+		p[TOUT_BIN_HEADER + 4] = 0xFF;
+		p[TOUT_BIN_HEADER + 5] = (unsigned char)cap_cause;
+		p[TOUT_BIN_HEADER + 6] = (unsigned char)(cap_cause >> 8);
+		p[TOUT_BIN_HEADER + 7] = (unsigned char)cap_count;
+		p[TOUT_BIN_HEADER + 8] = (unsigned char)(cap_count >> 8);
+	}
+	else if(cap_dump > cap_count)
+	{
+		t = 0;
+		p[TOUT_BIN_HEADER + 4] = 0xFE;
+		p[TOUT_BIN_HEADER + 5] = (unsigned char)cap_count;
+		p[TOUT_BIN_HEADER + 6] = (unsigned char)(cap_count >> 8);
+	}
+	else
+	{
+		rec = &cap_ring[(cap_head - cap_count + cap_dump - 1) & (CAP_RECORDS - 1)];
+		t = (unsigned long)cap_offset(rec);
+		p[TOUT_BIN_HEADER + 4] = rec->row;
+		for(ii = 0; ii < 8; ii++) p[TOUT_BIN_HEADER + 5 + ii] = rec->data[ii];
+	}
+
+	p[TOUT_BIN_HEADER] = (unsigned char)t;
+	p[TOUT_BIN_HEADER + 1] = (unsigned char)(t >> 8);
+	p[TOUT_BIN_HEADER + 2] = (unsigned char)(t >> 16);
+	p[TOUT_BIN_HEADER + 3] = (unsigned char)(t >> 24);
+	return telem_out_bin_frame(cap_line, TOUT_TYPE_CAPTURE, cap_seq, 13);
+}
+
+/*
+ * ms from the trigger, negative before it
+ */
+static long cap_offset(cap_record *rec)
+{
+	return (long)(rec->time - cap_trig_time) / (long)(TB_COUNT_RATE/1000);
+}
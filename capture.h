@@ -0,0 +1,50 @@
+/*
+ * capture.h
+ *
+ *  Triggered full rate capture of motor controller frames
+ *
+ *  - decode() stores every frame of the selected rows in a ring, so the
+ *    last CAP_RECORDS frames (about 2 s before a trigger) are kept
+ *  - A rule with RULE_CAPTURE or the "capture" command triggers it, the
+ *    ring keeps recording for CAP_POST_TICKS and is then frozen
+ *  - The frozen ring trickles out in the modem background slot, one
+ *    record per write, and capture re-arms when the last one is sent
+ *
+ *  ASCII dump:
+ *   "TL_CPS,0xTTTTTTTT,0xCCCCNNNN"  start, trigger ms of day, cause, records
+ *   "XXXXXX,0xHHHHHHHH,0xHHHHHHHH,0xOOOOOOOO"  record, O = ms from trigger (signed)
+ *   "TL_CPE,0x00000000,0x0000NNNN"  end, records sent
+ *   each line ends in the CRC field ",0x0000KKKK" (telem_out_crc_field)
+ *  Binary: TOUT_TYPE_CAPTURE frames, payload = ms from trigger (4) + row (1) + data (8)
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#define CAP_RECORDS			128				// power of 2, 8 MC rows at 5 Hz = 3.2 s
+#define CAP_POST_TICKS		TICK_RATE		// recording after the trigger
+#define CAP_LINE_SIZE		(41 + TOUT_CRC_FIELD)	// longest dump line, record with offset and CRC
+
+// States
+#define CAP_ARMED			0
+#define CAP_POST			1
+#define CAP_FROZEN			2
+
+#define CAP_CAUSE_CMD		0x0001			// ground command, rules use their alarm code
+
+typedef struct _cap_record
+{
+  unsigned long time;						// tb_now()
+  unsigned char row;
+  unsigned char data[8];
+} cap_record;
+
+// Public functions
+void capture_init(void);
+void capture_frame(int row, unsigned char *data);
+void capture_trigger(unsigned int cause);
+void capture_service(void);
+unsigned int capture_next(unsigned char format, char **buf);
+void capture_sent(void);
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,182 @@
+/*
+ * command.c
+ *
+ *  Line based command interface on the modem (UCA3) and USB (UCA2) ports
+ *
+ *  The RX interrupts call cmd_rx_char(), which is a bounded ring write.
+ *  Line editing, matching and the command work all happen in the main
+ *  loop from cmd_service(), so adding a command never touches ISR code.
+ */
+
+#include "Sunseeker2021.h"
+
+// Private variables
+static cmd_ring cmd_rings[CMD_PORTS];
+static char cmd_line[CMD_PORTS][CMD_LINE_SIZE];
+static unsigned char cmd_len[CMD_PORTS];
+static cmd_entry cmd_table[CMD_MAX];
+static unsigned char cmd_count = 0;
+
+// Private functions
+static unsigned int cmd_hash(const char *str);
+static void cmd_dispatch(unsigned char port, char *line);
+static void cmd_var1(unsigned char port, char *args);
+static void cmd_var2(unsigned char port, char *args);
+
+/*************************************************************
+/ Name: cmd_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Empties the rings and registers the built in commands
+************************************************************/
+void cmd_init(void)
+{
+	int ii;
+
+	for(ii = 0; ii < CMD_PORTS; ii++)
+	{
+		cmd_rings[ii].head = 0;
+		cmd_rings[ii].tail = 0;
+		cmd_rings[ii].overflow = 0;
+		cmd_len[ii] = 0;
+	}
+	cmd_count = 0;
+
+	cmd_register("var1", cmd_var1);
+	cmd_register("var2", cmd_var2);
+}
+
+/*************************************************************
+/ Name: cmd_register
+/ IN: command name (first word of the line), handler
+/ OUT:  1 if added, 0 if the table is full
+/ DESC:  The handler gets the port and the rest of the line
+************************************************************/
+int cmd_register(const char *name, cmd_fn fn)
+{
+	if(cmd_count >= CMD_MAX) return 0;
+
+	cmd_table[cmd_count].hash = cmd_hash(name);
+	cmd_table[cmd_count].name = name;
+	cmd_table[cmd_count].fn = fn;
+	cmd_count++;
+	return 1;
+}
+
+/*************************************************************
+/ Name: cmd_rx_char
+/ IN: port, received character
+/ OUT:  void
+/ DESC:  Called from the UART RX interrupts, stores the
+/        character or counts it as dropped
+************************************************************/
+void cmd_rx_char(unsigned char port, char ch)
+{
+	cmd_ring *ring;
+	unsigned char next;
+
+	ring = &cmd_rings[port];
+	next = (ring->head + 1) & (CMD_RING_SIZE - 1);
+	if(next == ring->tail) ring->overflow++;
+	else
+	{
+		ring->buf[ring->head] = ch;
+		ring->head = next;
+	}
+}
+
+/*************************************************************
+/ Name: cmd_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - drains the rings, edits the lines
+/        (backspace/delete) and dispatches each complete line
+************************************************************/
+void cmd_service(void)
+{
+	cmd_ring *ring;
+	unsigned char port;
+	char ch;
+
+	for(port = 0; port < CMD_PORTS; port++)
+	{
+		ring = &cmd_rings[port];
+		while(ring->tail != ring->head)
+		{
+			ch = ring->buf[ring->tail];
+			ring->tail = (ring->tail + 1) & (CMD_RING_SIZE - 1);
+
+			if(ch == CMD_CR)
+			{
+				cmd_line[port][cmd_len[port]] = '\0';
+				cmd_len[port] = 0;
+				cmd_dispatch(port, &cmd_line[port][0]);
+			}
+			else if((ch == CMD_BS) || (ch == CMD_DEL))
+			{
+				if(cmd_len[port] > 0) cmd_len[port]--;
+			}
+			else if(ch != CMD_LF)
+			{
+				if(cmd_len[port] < CMD_LINE_SIZE - 1) cmd_line[port][cmd_len[port]++] = ch;
+			}
+		}
+	}
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * 16 bit FNV-1a style hash of a name, up to '\0' or a space
+ */
+static unsigned int cmd_hash(const char *str)
+{
+	unsigned int h = 0x811C;
+
+	while((*str != '\0') && (*str != ' '))
+	{
+		h ^= (unsigned char)*str++;
+		h *= 0x0193;
+	}
+	return h;
+}
+
+/*
+ * First word selects the command, the rest is passed as arguments,
+ * a line that matches nothing is ignored
+ */
+static void cmd_dispatch(unsigned char port, char *line)
+{
+	unsigned int h;
+	char *args;
+	unsigned char ii;
+
+	args = line;
+	while((*args != '\0') && (*args != ' ')) args++;
+	if(*args == ' ') *args++ = '\0';
+
+	h = cmd_hash(line);
+	for(ii = 0; ii < cmd_count; ii++)
+	{
+		if((cmd_table[ii].hash == h) && (strcmp(cmd_table[ii].name, line) == 0))
+		{
+			cmd_table[ii].fn(port, args);
+			return;
+		}
+	}
+}
+
+/*
+ * Built in commands - data set queries, answered on the asking port
+ */
+static void cmd_var1(unsigned char port, char *args)
+{
+	telem_out_query((port == CMD_PORT_USB) ? TOUT_SINK_USB : TOUT_SINK_MODEM, TOUT_SET_VAR1);
+}
+
+static void cmd_var2(unsigned char port, char *args)
+{
+	telem_out_query((port == CMD_PORT_USB) ? TOUT_SINK_USB : TOUT_SINK_MODEM, TOUT_SET_VAR2);
+}
@@ -0,0 +1,52 @@
+/*
+ * command.h
+ *
+ *  Line based command interface on the modem (UCA3) and USB (UCA2) ports
+ *
+ *  - The RX interrupts only store the character in the port ring
+ *  - cmd_service() assembles lines in the main loop and dispatches the
+ *    first word through one command table shared by both ports
+ *  - Commands are found by a 16 bit name hash, confirmed with strcmp,
+ *    and can be added at run time with cmd_register()
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#define CMD_PORT_MODEM		0
+#define CMD_PORT_USB		1
+#define CMD_PORTS			2
+
+#define CMD_RING_SIZE		64		// power of 2, > one line at 115200 between main loop passes
+#define CMD_LINE_SIZE		32		// including the terminating '\0'
+#define CMD_MAX				16		// command table entries
+
+#define CMD_CR				0x0D
+#define CMD_LF				0x0A
+#define CMD_BS				0x08
+#define CMD_DEL				0x7F
+
+typedef void (*cmd_fn)(unsigned char port, char *args);
+
+typedef struct _cmd_entry
+{
+  unsigned int hash;
+  const char *name;
+  cmd_fn fn;
+} cmd_entry;
+
+typedef struct _cmd_ring
+{
+  char buf[CMD_RING_SIZE];
+  volatile unsigned char head;		// written by the RX interrupt
+  volatile unsigned char tail;		// written by cmd_service()
+  volatile unsigned int overflow;	// characters dropped on a full ring
+} cmd_ring;
+
+// Public functions
+void cmd_init(void);
+int cmd_register(const char *name, cmd_fn fn);
+void cmd_rx_char(unsigned char port, char ch);
+void cmd_service(void);
+
+#endif /* COMMAND_H_ */
@@ -1,198 +1,198 @@
-//
-// Decode and Lookup Table Routines
-//
-
-#include "Sunseeker2021.h"
-
-extern hf_packet pckHF;
-extern lf_packet pckLF;
-extern status_packet pckST;
-
-extern unsigned int can_mask0, can_mask1; //Mask 0 should always be the lower value(higher priority)
-
-static char init_pre_msg[8] = "ABCDEF\r\n";
-static char init_msg[30] = "XXXXXX,0xHHHHHHHH,0xHHHHHHHH\r\n";
-static char init_time_msg[17] = "TL_TIM,HH:MM:SS\r\n";
-static char init_post_msg[9] = "UVWXYZ\r\n\0";
-
-#define priority(row) addr_lookup[row][4]
-#define address(row) addr_lookup[row][0]
-
-unsigned int lookup_next(int pri);
-
-void decode()
-{
-  int offset;
-  int position;
-  int pck;
-  int row;
-  int i;
-  char a0, a1, dflag;
-  static can_struct current;
-  static pck_message *xmit_string;
-  
-  dflag = 0x00;
-  
-  if(can_fifo_GET(&can0_queue, &current))
-  {
-    if(lookup(current.address, &offset, &position, &pck, &row))
-    {
-      //if(row == can_mask1) can_mask1 = lookup_next(priority(row)); 
-      //else if(row == can_mask0) {
-      //	can_mask0 = can_mask1;
-      //	can_mask1 = lookup_next(priority(can_mask0));
-      //} else {
-      	//shouldn't happen!
-      //}
-      //can1_sources(address(can_mask0), address(can_mask1));    	
-   
-      if(pck == 0)
-      {
-        if( (pckHF.msg_filled & position) == 0)
-        {
-          xmit_string = &(pckHF.xmit[offset]);
-          pckHF.msg_filled |= position;
-          dflag = 0xFF;
-        }
-      }
-      else if(pck == 1)
-      {  
-        if( (pckLF.msg_filled & position) == 0)
-        {
-          xmit_string = &(pckLF.xmit[offset]);
-          pckLF.msg_filled |= position;
-          dflag = 0xFF;
-        }
-      }
-      else if(pck == 2)
-      {  
-        if( (pckST.msg_filled & position) == 0)
-        {
-          xmit_string = &(pckST.xmit[offset]);
-          pckST.msg_filled |= position;
-          dflag = 0xFF;
-        }
-      }
-      else
-      {
-        dflag = 0x00;
-      }
-      
-      if (dflag == 0xFF)
-      {
-        for(i=0;i<4;i++)
-        {
-          a1 = ((current.data.data_u8[i]>>4) & 0x0F)+'0';
-          if (a1 > '9')
-            a1 = a1 - '0' - 0x0a + 'A';
-          a0 = (current.data.data_u8[i] & 0x0F)+'0';
-          if (a0 > '9')
-            a0 = a0 - '0' - 0x0a + 'A';
-          xmit_string->message[2*i+9]=a1;
-          xmit_string->message[2*i+10]=a0;
-        }
-        for(i=0;i<4;i++)
-        {
-          a1 = ((current.data.data_u8[i+4]>>4) & 0x0F)+'0';
-          if (a1 > '9')
-            a1 = a1 - '0' - 0x0a + 'A';
-          a0 = (current.data.data_u8[i+4] & 0x0F)+'0';
-          if (a0 > '9')
-            a0 = a0 - '0' - 0x0a + 'A';
-          xmit_string->message[2*i+20]=a1;
-          xmit_string->message[2*i+21]=a0;
-        }
-      }
-    }
-  }
-}
-
-unsigned int lookup_next(int pri)
-{
-	int row;
-	pri++;
-	
-	for(row = 0; row < sizeof(lut_blacklist); row++)
-	{
-		if(pri == lut_blacklist[row]) pri++;
-		if(pri == LOOKUP_ROWS) pri = 0;
-	}
-	
-	for(row = 0; row < LOOKUP_ROWS; row++)
-		if(addr_lookup[row][4] == pri) break;
-		
-	if(row == LOOKUP_ROWS) row = 0;
-	
-	return row; 
-}
-
-//void start_mask()
-//{
-//  can_mask0 = lookup_next(-1);
-//  can_mask1 = lookup_next(0);
-//  can0_sources(address(can_mask0), address(can_mask1));
-//}
-
-int lookup(unsigned int address, int *off, int *pos, int *pck, int *row)
-{ 
-  for(*row = 0; *row < LOOKUP_ROWS;(*row)++)
-  {
-    if(address == addr_lookup[*row][0])
-    {
-      *off = addr_lookup[*row][1];
-      *pos = addr_lookup[*row][2];
-      *pck = addr_lookup[*row][3];
-      return 1;   //found address
-    }
-  }
-  *row = 0;
- return 0;         //search failed 
-}
-
-/*************************************************************
-/ Name: packet_init
-/ IN: global pckHF, pckLH, pckST
-/ OUT:  void
-/ DESC:  This function is used to fill the packets
-************************************************************/
-void packet_init(void)
-{
-int i, pck_type, pck_offset;
-
-  strncpy(pckHF.prexmit.pre_msg,init_pre_msg,8);
-  for( i =0;i<HF_MSG_PACKET;i++){
-    strncpy(pckHF.xmit[i].message,init_msg,MSG_SIZE);
-  }
-  strncpy(pckHF.timexmit.time_msg,init_time_msg,17);
-  strncpy(pckHF.postxmit.post_msg,init_post_msg,9);
-  
-  strncpy(pckLF.prexmit.pre_msg,init_pre_msg,8);
-  for( i =0;i<LF_MSG_PACKET;i++){
-    strncpy(pckLF.xmit[i].message,init_msg,MSG_SIZE);
-  }
-  strncpy(pckLF.timexmit.time_msg,init_time_msg,17);
-  strncpy(pckLF.postxmit.post_msg,init_post_msg,9);
-  
-  
-  strncpy(pckST.prexmit.pre_msg,init_pre_msg,8);
-  for( i =0;i<ST_MSG_PACKET;i++){
-    strncpy(pckST.xmit[i].message,init_msg,MSG_SIZE);
-  }
-  strncpy(pckST.timexmit.time_msg,init_time_msg,17);
-  strncpy(pckST.postxmit.post_msg,init_post_msg,9);
-  
-  for (i =0;i<LOOKUP_ROWS;i++){
-    pck_type = addr_lookup[i][3];
-    pck_offset =  addr_lookup[i][1];
-    if(pck_type == 0){
-      strncpy(pckHF.xmit[pck_offset].message,name_lookup[i],6);
-    }
-    else if(pck_type == 1){
-      strncpy(pckLF.xmit[pck_offset].message,name_lookup[i],6);
-    }
-    else if(pck_type == 2){
-      strncpy(pckST.xmit[pck_offset].message,name_lookup[i],6);
-    }
-    
-  }
-} 
+//
+// Decode and Lookup Table Routines
+//
+
+#include "Sunseeker2021.h"
+
+extern hf_packet pckHF;
+extern lf_packet pckLF;
+extern status_packet pckST;
+
+extern unsigned int can_mask0, can_mask1; //Mask 0 should always be the lower value(higher priority)
+
+// Lookup tables, one copy in flash for every module
+const int addr_lookup[LOOKUP_ROWS][5] = {
+  //address                           ASCII Offset      MSG_REC position        Packet(0-HF:1-LF:2-Status)		Filter Priority
+  {MC_CAN_BASE1,					  0,                0x0001,                   3,							29},                    //0-0x400     High = CAN1_SERIAL Number        Low = "TRIa" string
+  {MC_CAN_BASE1 + MC_LIMITS,	      8,                0x0100,                   0,							15},                    //1-0x01        High = Active Motor              Low = Error & Limit flags
+  {MC_CAN_BASE1 + MC_BUS,	      	  0,                0x0002,                   0,							 1},                    //2-0x02	    High = Bus Current               Low = Bus Voltage
+  {MC_CAN_BASE1 + MC_VELOCITY,	      1,                0x0004,                   0,							 2},                    //3-0x03	    High = Velocity (m/s)            Low = Velocity (rpm)
+  {MC_CAN_BASE1 + MC_PHASE,           1,                0x0001,                   3,							30},                    //4-0x04	    High = Phase A Current           Low = Phase B Current
+  {MC_CAN_BASE1 + MC_V_VECTOR,	      2,                0x0002,                   3,							31},                    //5-0x05	    High = Vd vector                 Low = Vq vector
+  {MC_CAN_BASE1 + MC_I_VECTOR,	      3,                0x0004,                   3,							32},                    //6-0x06	    High = Id vector                 Low = Iq vector
+  {MC_CAN_BASE1 + MC_BEMF_VECTOR,     4,                0x0008,                   3,							33},                    //7-0x07	    High = BEMFd vector              Low = BEMFq vector
+  {MC_CAN_BASE1 + MC_RAIL1,	      	  1,                0x0002,                   3,							16},                    //8-0x08	    High = 15V                       Low = Reserved
+  {MC_CAN_BASE1 + MC_RAIL2,	      	  2,                0x0004,                   3,							17},                    //9-0x09	    High = 3.3V                      Low = 1.9V
+  {MC_CAN_BASE1 + MC_TEMP1,	      	  0,                0x0001,                   3,							 7},                    //10-0x0B	    High = Heatsink Temp             Low = Motor Temp
+  {MC_CAN_BASE1 + MC_TEMP2,	      	  1,                0x0002,                   3,							 8},                    //11-0x0C	    High = Inlet Temp                Low = CPU Temp
+  {MC_CAN_BASE1 + MC_CUMULATIVE,      3,                0x0008,                   3,							18},                    //12-x0E	    High = DC Bus AmpHours           Low = Odometer
+  {MC_CAN_BASE1 + MC_SLIPSPEED,       5,                0x0010,                   3,							34},                    //13-0x17	    High =Slip Speed (Hz)            Low = Reserved
+  {DC_CAN_BASE,		              	 12,                0x0800,                   3,							41},                    //28-0x500    High = CAN1_SERIAL Number        Low = "TRIb" string
+  {DC_CAN_BASE + DC_DRIVE,            2,                0x0800,                   0,							23},                    //29-0x01	    High = Motor Current Setpoint    Low = Motor Velocity Setpoint
+  {DC_CAN_BASE + DC_POWER,            9,                0x0200,                   3,							24},                    //30-0x02	    High = Bus Current Setpoint      Low = Unused
+  {DC_CAN_BASE + DC_RESET,	      	 13,                0x1000,                   3,							42},                    //31-0x03	    High = Unused                    Low = Unused
+  {DC_CAN_BASE + DC_SWITCH,           3,                0x0080,                   0,							25},                    //32-0x04	    High = Switch position           Low = Switch state change
+  {BP_CAN_BASE,                      14,                0x2000,                   3,							43},                    //33-0x580    High = BPV2" string or nulls     Low = CAN1_SERIAL Number
+  {BP_CAN_BASE + BP_VMAX,             4,                0x0010,                   0,							11},                    //34-0x01       High = Max Voltage               Low = Cell Number
+  {BP_CAN_BASE + BP_VMIN,             5,                0x0020,                   0,							12},                    //35-0x02	    High = Min Voltage               Low = Cell Number
+  {BP_CAN_BASE + BP_TMAX,             6,                0x0040,                   0,							13},                    //36-0x03	    High = Temp Max                  Low = Cell Number
+  {BP_CAN_BASE + BP_PCDONE,          15,                0x0200,                   3,							44},                    //37-0x04	    High = "BPV1" string             Low = CAN1_SERIAL Number
+  {BP_CAN_BASE + BP_ISH,              7,                0x0080,                   0,						     5},                    //38-0x05	    High = Shunt Current  			 Low = Battery Voltage
+  {AC_CAN_BASE,                      16,                0x8000,                   3,							45},                    //39-0x5C0    High = ACV1" string or nulls     Low = CAN1_SERIAL Number
+  {AC_CAN_BASE + AC_M1,              11,                0x0800,                   3,							26},                    //40-0x01       High = Array Voltage Average	 Low = Array Current Average
+  {AC_CAN_BASE + AC_M2,              12,                0x1000,                   3,							27},                    //41-0x02	    High = Array Voltage Average	 Low = Array Current Average
+  {AC_CAN_BASE + AC_M3,              13,                0x2000,                   3,							28},                    //42-0x03	    High = Array Voltage Average	 Low = Array Current Average
+  {AC_CAN_BASE + AC_ISH,              5,                0x0020,                   3,							 6},                    //43-0x04	    High = Shunt Current             Low = Battery Voltage
+  {AC_CAN_BASE + AC_TMAX,             7,                0x0080,                   3,						    14},                    //44-0x05	    High = Max. Temperature		     Low = Max. Temperature MPPT
+  {AC_CAN_BASE + AC_TVAL1,           17,                0x1000,                   3,							46},                    //45-0x03	    High = Temp AC1   				 Low = Temp AC2
+  {AC_CAN_BASE + AC_TVAL2,           18,                0x2000,                   3,							47},                    //46-0x04	    High = Temp AC3   				 Low = Reserved
+  {AC_CAN_BASE + AC_BP_CHARGE,       19,                0x4000,                   3,						    48},                    //47-0x05	    High = "ACV1" or "0000" string   Low = CAN1_SERIAL Number
+};
+// removed
+//{MC_CAN_BASE1 + MC_FAN,	      	  -,                0x----,                   -,							--},                    //xx-0x0A	    High = Fan speed (rpm)           Low = Fan drive (%)
+//{MC_CAN_BASE1 + MC_TEMP3,	          -,                0x----,                   -,							--},                    //xx-0x0D	    High = Outlet Temp               Low = Capacitor Temp
+//{MC_CAN_BASE2 + MC_FAN,	      	  -,                0x----,                   -,							--},                    //xx-0x0A	    High = Fan speed (rpm)           Low = Fan drive (%)
+//{MC_CAN_BASE2 + MC_TEMP3,	          -,                0x----,                   -,							--},                    //xx-0x0D	    High = Outlet Temp               Low = Capacitor Temp
+
+
+//static char lut_blacklist[] = {32,11,4,5,11,12,13,14,15,23,24,25,3,26,27,28};
+//static char lut_blacklist[] = {44};
+static const char lut_blacklist[] = {49};
+
+const char * const name_lookup[NAME_LOOKUP_ROWS] = {
+  //name
+  "MC1BAS", //MC_CAN_BASE1_
+  "MC1LIM", //MC_CAN_BASE1 + MC_LIMITS
+  "MC1BUS", //MC_CAN_BASE1 + MC_BUS
+  "MC1VEL", //MC_CAN_BASE1 + MC_VELOCITY
+  "MC1PHA", //MC_CAN_BASE1 + MC_PHASE
+  "MC1VVC", //MC_CAN_BASE1 + MC_V_VECTOR
+  "MC1IVC", //MC_CAN_BASE1 + MC_I_VECTOR
+  "MC1BEM", //MC_CAN_BASE1 + MC_BEMF_VECTOR
+  "MC1RL1", //MC_CAN_BASE1 + MC_RAIL1
+  "MC1RL2", //MC_CAN_BASE1 + MC_RAIL2
+  "MC1TP1", //MC_CAN_BASE1 + MC_TEMP1
+  "MC1TP2", //MC_CAN_BASE1 + MC_TEMP2
+  "MC1CUM", //MC_CAN_BASE1 + MC_CUMULATIVE
+  "MC1SLS", //MC_CAN_BASE1 + MC_SLIPSPEED
+  "DC_BAS", //DC_CAN_BASE
+  "DC_DRV", //DC_CAN_BASE + DC_DRIVE
+  "DC_POW", //DC_CAN_BASE + DC_POWER
+  "DC_RST", //DC_CAN_BASE + DC_RESET
+  "DC_SWC", //DC_CAN_BASE + DC_SWITCH
+  "BP_BAS", //BP_CAN_BASE
+  "BP_VMX", //BP_CAN_BASE + BP_VMAX
+  "BP_VMN", //BP_CAN_BASE + BP_VMIN
+  "BP_TMX", //BP_CAN_BASE + BP_TMAX
+  "BP_PCD", //BP_CAN_BASE + BP_PCDONE
+  "BP_ISH", //BP_CAN_BASE + BP_ISH
+  "AC_BAS", //AC_CAN_BASE
+  "AC_MP1", //AC_CAN_BASE + AC_M1
+  "AC_MP2", //AC_CAN_BASE + AC_M2
+  "AC_MP3", //AC_CAN_BASE + AC_M3
+  "AC_ISH", //AC_CAN_BASE + AC_ISH
+  "AC_TMX", //AC_CAN_BASE + AC_TMAX
+  "AC_TV1", //AC_CAN_BASE + AC_TVAL1
+  "AC_TV2", //AC_CAN_BASE + AC_TVAL2
+  "AC_BPC", //AC_CAN_BASE + AC_BP_CHARGE
+};
+
+// removed
+// "MC1FAN", //MC_CAN_BASE1 + MC_FAN
+// "MC1TP3", //MC_CAN_BASE1 + MC_TEMP3
+// "MC2FAN", //MC_CAN_BASE2 + MC_FAN
+// "MC2TP3", //MC_CAN_BASE2 + MC_TEMP3
+
+#define priority(row) addr_lookup[row][4]
+#define address(row) addr_lookup[row][0]
+
+unsigned int lookup_next(int pri);
+
+void decode()
+{
+  int offset;
+  int position;
+  int pck;
+  int row;
+  static can_struct current;
+
+  if(can_fifo_GET(&can0_queue, &current))
+  {
+    sdlog_frame(0, &current);				// black box, every frame
+    if(lookup(current.address, &offset, &position, &pck, &row))
+    {
+      telem_out_row(row, &current.data.data_u8[0]);	// latest raw value for the output layer
+      capture_frame(row, &current.data.data_u8[0]);	// full rate pre-trigger ring
+      rule_row(row, &current.data.data_u8[0]);		// limit and event rules of this message
+
+      //if(row == can_mask1) can_mask1 = lookup_next(priority(row)); 
+      //else if(row == can_mask0) {
+      //	can_mask0 = can_mask1;
+      //	can_mask1 = lookup_next(priority(can_mask0));
+      //} else {
+      	//shouldn't happen!
+      //}
+      //can1_sources(address(can_mask0), address(can_mask1));    	
+   
+      if(pck == 0) pckHF.msg_filled |= position;	// lines are rendered from tout_rows at send time
+      else if(pck == 1) pckLF.msg_filled |= position;
+      else if(pck == 2) pckST.msg_filled |= position;
+    }
+  }
+}
+
+unsigned int lookup_next(int pri)
+{
+	int row;
+	pri++;
+	
+	for(row = 0; row < sizeof(lut_blacklist); row++)
+	{
+		if(pri == lut_blacklist[row]) pri++;
+		if(pri == LOOKUP_ROWS) pri = 0;
+	}
+	
+	for(row = 0; row < LOOKUP_ROWS; row++)
+		if(addr_lookup[row][4] == pri) break;
+		
+	if(row == LOOKUP_ROWS) row = 0;
+	
+	return row; 
+}
+
+//void start_mask()
+//{
+//  can_mask0 = lookup_next(-1);
+//  can_mask1 = lookup_next(0);
+//  can0_sources(address(can_mask0), address(can_mask1));
+//}
+
+int lookup(unsigned int address, int *off, int *pos, int *pck, int *row)
+{ 
+  for(*row = 0; *row < LOOKUP_ROWS;(*row)++)
+  {
+    if(address == addr_lookup[*row][0])
+    {
+      *off = addr_lookup[*row][1];
+      *pos = addr_lookup[*row][2];
+      *pck = addr_lookup[*row][3];
+      return 1;   //found address
+    }
+  }
+  *row = 0;
+ return 0;         //search failed 
+}
+
+/*************************************************************
+/ Name: packet_init
+/ IN: global pckHF, pckLH, pckST
+/ OUT:  void
+/ DESC:  This function is used to clear the packets, the text
+/        is rendered by telem_out from the raw rows
+************************************************************/
+void packet_init(void)
+{
+  pckHF.msg_filled = 0;
+  pckLF.msg_filled = 0;
+  pckST.msg_filled = 0;
+} 
@@ -0,0 +1,128 @@
+/*
+ * fec.c
+ *
+ *  Forward error correction of the modem telemetry stream
+ *
+ *  Table driven systematic encoder, the parity is the remainder of the
+ *  codeword divided by the generator polynomial, kept in log form so a
+ *  byte costs one log lookup and FEC_PARITY exp lookups.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+unsigned char fec_on = FEC_DEFAULT;
+
+// Private variables
+static unsigned char fec_exp[512];				// alpha^i, doubled so no modulo is needed
+static unsigned char fec_log[256];
+static unsigned char fec_gen[FEC_PARITY];		// generator coefficients (log), highest first
+
+// Private functions
+static void fec_cmd(unsigned char port, char *args);
+static void fec_block(unsigned char *p, unsigned char *data, unsigned char len);
+
+/*************************************************************
+/ Name: fec_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Builds the GF(256) tables and the generator polynomial
+/        and adds the "fec" command (after cmd_init)
+************************************************************/
+void fec_init(void)
+{
+	unsigned char poly[FEC_PARITY + 1];
+	unsigned int x;
+	int ii, jj;
+
+	x = 1;
+	for(ii = 0; ii < 255; ii++)
+	{
+		fec_exp[ii] = (unsigned char)x;
+		fec_exp[ii + 255] = (unsigned char)x;
+		fec_log[x] = (unsigned char)ii;
+		x <<= 1;
+		if(x & 0x100) x ^= 0x11D;
+	}
+	fec_exp[510] = fec_exp[0];
+	fec_exp[511] = fec_exp[1];
+	fec_log[0] = 0;								// never used, zero is tested first
+
+	// g(x) = (x - a^0)(x - a^1)...(x - a^(FEC_PARITY-1)), poly[0] = x^FEC_PARITY
+	poly[0] = 1;
+	for(ii = 1; ii <= FEC_PARITY; ii++) poly[ii] = 0;
+	for(ii = 0; ii < FEC_PARITY; ii++)
+	{
+		for(jj = ii + 1; jj > 0; jj--)
+			if(poly[jj - 1] != 0) poly[jj] ^= fec_exp[fec_log[poly[jj - 1]] + ii];
+	}
+	for(ii = 0; ii < FEC_PARITY; ii++) fec_gen[ii] = fec_log[poly[ii + 1]];
+
+	cmd_register("fec", fec_cmd);
+}
+
+/*************************************************************
+/ Name: fec_encode
+/ IN: output buffer (FEC_BUF_SIZE), part, part length
+/ OUT:  encoded length, 0 if the part does not fit
+/ DESC:  Splits the part into codewords of up to FEC_DATA bytes
+************************************************************/
+unsigned int fec_encode(char *out, char *buf, unsigned int len)
+{
+	unsigned int n, chunk;
+
+	if(len > FEC_BLOCKS*FEC_DATA) return 0;
+
+	n = 0;
+	while(len > 0)
+	{
+		chunk = (len > FEC_DATA) ? FEC_DATA : len;
+		fec_block((unsigned char *)&out[n], (unsigned char *)buf, (unsigned char)chunk);
+		n += 3 + chunk + FEC_PARITY;
+		buf += chunk;
+		len -= chunk;
+	}
+	return n;
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "fec 1" / "fec 0", takes effect with the next modem write
+ */
+static void fec_cmd(unsigned char port, char *args)
+{
+	fec_on = (strtoul(args, 0, 0) != 0);
+}
+
+/*
+ * One block, parity over len and data
+ */
+static void fec_block(unsigned char *p, unsigned char *data, unsigned char len)
+{
+	unsigned char *par;
+	unsigned char fb, lfb;
+	unsigned char ii;
+	int jj;
+
+	p[0] = FEC_SYNC0;
+	p[1] = FEC_SYNC1;
+	p[2] = len;
+	for(ii = 0; ii < len; ii++) p[3 + ii] = data[ii];
+
+	par = &p[3 + len];
+	for(jj = 0; jj < FEC_PARITY; jj++) par[jj] = 0;
+
+	for(ii = 0; ii <= len; ii++)
+	{
+		fb = p[2 + ii] ^ par[0];
+		for(jj = 0; jj < FEC_PARITY - 1; jj++) par[jj] = par[jj + 1];
+		par[FEC_PARITY - 1] = 0;
+		if(fb == 0) continue;
+
+		lfb = fec_log[fb];
+		for(jj = 0; jj < FEC_PARITY; jj++) par[jj] ^= fec_exp[lfb + fec_gen[jj]];
+	}
+}
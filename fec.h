@@ -0,0 +1,34 @@
+/*
+ * fec.h
+ *
+ *  Forward error correction of the modem telemetry stream
+ *
+ *  - Optional ("fec 1", default FEC_DEFAULT), every part handed to the
+ *    modem sink is sent as one or more shortened Reed-Solomon codewords
+ *  - RS over GF(256), polynomial 0x11D, FEC_PARITY check bytes, corrects
+ *    up to FEC_PARITY/2 byte errors per codeword
+ *  - Block: C3 3C | len | data[len] | parity[FEC_PARITY], the codeword is
+ *    len + data (len <= FEC_DATA), the sync bytes only frame it
+ *  - AT command scripts are written to the UART directly and stay plain
+ */
+
+#ifndef FEC_H_
+#define FEC_H_
+
+#define FEC_DEFAULT			FALSE
+#define FEC_SYNC0			0xC3
+#define FEC_SYNC1			0x3C
+#define FEC_PARITY			16						// RS(255,239)
+#define FEC_DATA			(255 - FEC_PARITY - 1)	// data bytes per codeword, 1 for len
+#define FEC_BLOCK			(2 + 1 + FEC_DATA + FEC_PARITY)
+#define FEC_BLOCKS			2						// TOUT_FRAME_SIZE <= FEC_BLOCKS*FEC_DATA
+#define FEC_BUF_SIZE		(FEC_BLOCKS*FEC_BLOCK)
+
+// Public variables
+extern unsigned char fec_on;
+
+// Public functions
+void fec_init(void);
+unsigned int fec_encode(char *out, char *buf, unsigned int len);
+
+#endif /* FEC_H_ */
@@ -0,0 +1,484 @@
+/*
+ * history.c
+ *
+ *  Store and forward history of the modem telemetry frames
+ *
+ *  The ring keeps the raw HF rows of each frame, the text is rendered
+ *  again when an entry is sent from the history. Entries are picked at
+ *  an entry boundary only - ARQ retransmits first, then backfill - so an
+ *  entry is never cut short by a new acknowledgement.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+unsigned int arq_retransmits = 0;
+unsigned int arq_lost = 0;
+
+// Private variables
+static hist_entry hist_ring[HIST_ENTRIES];
+static unsigned long hist_seq = 0;				// next sequence number
+static signed char hist_hf_row[HF_MSG_PACKET];	// lookup row of each HF offset, -1 = none
+static char hist_tag_buf[TOUT_RECORD_SIZE];
+static char hist_part[HIST_PART_SIZE];
+
+static unsigned char hist_kind = HIST_NONE;		// entry being sent
+static unsigned long hist_cur;
+static unsigned char hist_part_n;				// next part of the entry
+static unsigned int hist_part_len;
+static unsigned int hist_crc;					// ASCII entry so far
+static unsigned int hist_crc_n;
+static unsigned char hist_frame_seq = 0;		// binary frame sequence, advances once a frame is handed on
+
+static unsigned char hist_bf_active = FALSE;
+static unsigned long hist_bf_seq;				// next entry to backfill
+static unsigned long hist_bf_end;				// last entry to backfill
+static unsigned char hist_ack_pending = FALSE;
+static unsigned long hist_ack_seq;
+
+static unsigned char arq_on = ARQ_DEFAULT;
+static unsigned long arq_base = 0;				// oldest frame without ack
+static unsigned int arq_acked;					// bit n = arq_base + n acknowledged
+static unsigned int arq_resend;					// bit n = arq_base + n to send again
+static unsigned char arq_tries[ARQ_WINDOW];		// by seq % ARQ_WINDOW
+static unsigned long arq_tick[ARQ_WINDOW];		// last send
+
+// Private functions
+static void hist_cmd(unsigned char port, char *args);
+static void arq_cmd(unsigned char port, char *args);
+static void arq_ack_cmd(unsigned char port, char *args);
+static void arq_nak_cmd(unsigned char port, char *args);
+static void hist_apply_ack(void);
+static void hist_pick(void);
+static void hist_done(void);
+static void arq_slide(void);
+static unsigned int hist_line(char *buf, const char *name, unsigned long a, unsigned long b);
+static unsigned int hist_time_line(char *buf, unsigned long ms);
+static unsigned int hist_binary(char *buf, unsigned char type, hist_entry *entry);
+
+/*************************************************************
+/ Name: history_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Maps the HF message offsets to lookup rows and adds the
+/        "seq", "arq", "ack" and "nak" commands (after cmd_init)
+************************************************************/
+void history_init(void)
+{
+	int row;
+
+	for(row = 0; row < HF_MSG_PACKET; row++) hist_hf_row[row] = -1;
+	for(row = 0; row < LOOKUP_ROWS; row++)
+		if(addr_lookup[row][3] == 0) hist_hf_row[addr_lookup[row][1]] = row;
+
+	for(row = 0; row < HIST_ENTRIES; row++) hist_ring[row].seq = 0xFFFFFFFF;
+	hist_seq = 0;
+	hist_kind = HIST_NONE;
+	hist_bf_active = FALSE;
+	hist_ack_pending = FALSE;
+
+	arq_base = 0;
+	arq_acked = 0;
+	arq_resend = 0;
+
+	cmd_register("seq", hist_cmd);
+	cmd_register("arq", arq_cmd);
+	cmd_register("ack", arq_ack_cmd);
+	cmd_register("nak", arq_nak_cmd);
+}
+
+/*************************************************************
+/ Name: history_tag
+/ IN: sink format, pointer to the tag
+/ OUT:  tag length
+/ DESC:  Tag hook of the modem sink, numbers the periodic frame
+/        and stores its HF rows in the ring
+************************************************************/
+unsigned int history_tag(unsigned char format, char **buf)
+{
+	hist_entry *entry;
+	int off, ii;
+
+	entry = &hist_ring[hist_seq & (HIST_ENTRIES - 1)];
+	entry->seq = hist_seq;
+	entry->ms = tb_get_ms();
+	entry->valid = 0;
+	for(off = 0; off < HF_MSG_PACKET; off++)
+	{
+		if((hist_hf_row[off] < 0) || !tout_rows[hist_hf_row[off]].valid) continue;
+		for(ii = 0; ii < 8; ii++) entry->data[off][ii] = tout_rows[hist_hf_row[off]].data[ii];
+		entry->valid |= (1 << off);
+	}
+
+	// ARQ window, a full window gives up its oldest frame
+	if(arq_on)
+	{
+		while(hist_seq - arq_base >= ARQ_WINDOW)
+		{
+			if(!(arq_acked & 1)) arq_lost++;
+			arq_acked |= 1;
+			arq_slide();
+		}
+		arq_tries[hist_seq % ARQ_WINDOW] = 0;
+		arq_tick[hist_seq % ARQ_WINDOW] = tb_get_ticks();
+	}
+	else arq_base = hist_seq + 1;
+	hist_seq++;
+
+	*buf = hist_tag_buf;
+	if(format == TOUT_BINARY)
+	{
+		off = hist_binary(hist_tag_buf, TOUT_TYPE_SEQ, entry);
+		hist_frame_seq++;					// the tag is rendered once per frame
+		return off;
+	}
+	return hist_line(hist_tag_buf, "TL_SEQ", entry->seq, entry->ms);
+}
+
+/*************************************************************
+/ Name: history_ack
+/ IN: last sequence number received by the ground station
+/ OUT:  void
+/ DESC:  Backfills the entries after it that are still in the
+/        ring, up to the last frame sent
+************************************************************/
+void history_ack(unsigned long seq)
+{
+	hist_ack_seq = seq;
+	hist_ack_pending = TRUE;
+	if(hist_kind != HIST_BACKFILL) hist_apply_ack();	// else at the next entry boundary
+}
+
+/*************************************************************
+/ Name: history_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - ARQ timeouts, frames without ack are
+/        queued again or given up after ARQ_TRIES
+************************************************************/
+void history_service(void)
+{
+	unsigned long ticks;
+	unsigned int bit;
+	unsigned char n, slot;
+
+	if(!arq_on) return;
+
+	ticks = tb_get_ticks();
+	for(n = 0, bit = 1; (n < ARQ_WINDOW) && (arq_base + n < hist_seq); n++, bit <<= 1)
+	{
+		if((arq_acked | arq_resend) & bit) continue;
+		slot = (arq_base + n) % ARQ_WINDOW;
+		if((ticks - arq_tick[slot]) < ARQ_RTO_TICKS) continue;
+
+		if(arq_tries[slot] < ARQ_TRIES) arq_resend |= bit;
+		else
+		{
+			arq_acked |= bit;								// given up
+			arq_lost++;
+		}
+	}
+	arq_slide();
+}
+
+/*************************************************************
+/ Name: history_next
+/ IN: sink format, pointer to the part
+/ OUT:  length of the next part, 0 if nothing to send
+/ DESC:  Background source of the modem sink, the same part is
+/        returned until history_sent()
+************************************************************/
+unsigned int history_next(unsigned char format, char **buf)
+{
+	hist_entry *entry;
+	int off;
+
+	*buf = hist_part;
+	if(hist_kind == HIST_NONE) hist_pick();
+	while(hist_kind != HIST_NONE)
+	{
+		entry = &hist_ring[hist_cur & (HIST_ENTRIES - 1)];
+		if(entry->seq != hist_cur)							// overwritten meanwhile
+		{
+			hist_done();
+			hist_pick();
+			continue;
+		}
+
+		if(format == TOUT_BINARY)
+			return hist_binary(hist_part, (hist_kind == HIST_RETRANSMIT) ? TOUT_TYPE_RETRANSMIT : TOUT_TYPE_BACKFILL, entry);
+
+		while((hist_part_n >= HIST_PART_ROWS) && (hist_part_n < HIST_PART_TIME) &&
+			  !(entry->valid & (1 << (hist_part_n - HIST_PART_ROWS))))
+			hist_part_n++;
+
+		if(hist_part_n == HIST_PART_PRE)
+		{
+			memcpy(hist_part, "ABCDEF\r\n", 8);
+			hist_part_len = 8;
+		}
+		else if(hist_part_n == HIST_PART_SEQ)
+			hist_part_len = hist_line(hist_part, (hist_kind == HIST_RETRANSMIT) ? "TL_RTX" : "TL_BFS", entry->seq, entry->ms);
+		else if(hist_part_n == HIST_PART_TIME) hist_part_len = hist_time_line(hist_part, entry->ms);
+		else if(hist_part_n == HIST_PART_CRC) hist_part_len = telem_out_crc_line(hist_part, hist_crc, hist_crc_n);
+		else if(hist_part_n == HIST_PART_POST)
+		{
+			memcpy(hist_part, "UVWXYZ\r\n", 8);
+			hist_part_len = 8;
+		}
+		else
+		{
+			off = hist_part_n - HIST_PART_ROWS;
+			hist_part_len = telem_out_line(hist_part, hist_hf_row[off], entry->data[off]);
+		}
+		return hist_part_len;
+	}
+	return 0;
+}
+
+/*
+ * Last part from history_next() is out
+ */
+void history_sent(void)
+{
+	extern tout_sink tout_sinks[TOUT_SINKS];
+
+	if(hist_kind == HIST_NONE) return;
+
+	if(tout_sinks[TOUT_SINK_MODEM].format == TOUT_BINARY) hist_frame_seq++;
+	if((tout_sinks[TOUT_SINK_MODEM].format == TOUT_BINARY) || (hist_part_n >= HIST_PART_POST))
+	{
+		hist_done();
+		return;
+	}
+
+	// CRC of the packet lines as sent, the TL_ record is not part of it
+	if(hist_part_n == HIST_PART_PRE)
+	{
+		hist_crc = TOUT_CRC_SEED;
+		hist_crc_n = 0;
+	}
+	if((hist_part_n != HIST_PART_SEQ) && (hist_part_n < HIST_PART_CRC))
+	{
+		hist_crc = telem_out_crc(hist_part, hist_part_len, hist_crc);
+		hist_crc_n += hist_part_len;
+	}
+	hist_part_n++;
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "seq N", decimal or 0x hex
+ */
+static void hist_cmd(unsigned char port, char *args)
+{
+	char *end;
+	unsigned long seq;
+
+	seq = strtoul(args, &end, 0);
+	if(end != args) history_ack(seq);
+}
+
+/*
+ * "arq 1" / "arq 0", the window starts at the next frame
+ */
+static void arq_cmd(unsigned char port, char *args)
+{
+	arq_on = (strtoul(args, 0, 0) != 0);
+	arq_base = hist_seq;
+	arq_acked = 0;
+	arq_resend = 0;
+}
+
+/*
+ * "ack N" - frame N arrived
+ */
+static void arq_ack_cmd(unsigned char port, char *args)
+{
+	char *end;
+	unsigned long seq;
+
+	seq = strtoul(args, &end, 0);
+	if(!arq_on || (end == args) || (seq < arq_base) || (seq - arq_base >= ARQ_WINDOW) || (seq >= hist_seq)) return;
+
+	arq_acked |= (1 << (unsigned int)(seq - arq_base));
+	arq_resend &= ~(1 << (unsigned int)(seq - arq_base));
+	arq_slide();
+}
+
+/*
+ * "nak N" - frame N is missing or damaged, send it again now
+ */
+static void arq_nak_cmd(unsigned char port, char *args)
+{
+	char *end;
+	unsigned long seq;
+	unsigned int bit;
+
+	seq = strtoul(args, &end, 0);
+	if(!arq_on || (end == args) || (seq < arq_base) || (seq - arq_base >= ARQ_WINDOW) || (seq >= hist_seq)) return;
+
+	bit = 1 << (unsigned int)(seq - arq_base);
+	if(!(arq_acked & bit) && (arq_tries[seq % ARQ_WINDOW] < ARQ_TRIES)) arq_resend |= bit;
+}
+
+/*
+ * Window base past every acknowledged (or given up) frame
+ */
+static void arq_slide(void)
+{
+	while((arq_base < hist_seq) && (arq_acked & 1))
+	{
+		arq_acked >>= 1;
+		arq_resend >>= 1;
+		arq_base++;
+	}
+}
+
+/*
+ * New backfill range from a pending acknowledgement
+ */
+static void hist_apply_ack(void)
+{
+	unsigned long start, oldest;
+
+	if(!hist_ack_pending) return;
+	hist_ack_pending = FALSE;
+
+	if((hist_seq == 0) || (hist_ack_seq >= hist_seq - 1))
+	{
+		hist_bf_active = FALSE;						// caught up
+		return;
+	}
+
+	start = hist_ack_seq + 1;
+	oldest = (hist_seq > HIST_ENTRIES) ? hist_seq - HIST_ENTRIES : 0;
+	if(start < oldest) start = oldest;
+
+	hist_bf_seq = start;
+	hist_bf_end = hist_seq - 1;
+	hist_bf_active = TRUE;
+}
+
+/*
+ * Next entry at an entry boundary, ARQ retransmits before backfill
+ */
+static void hist_pick(void)
+{
+	unsigned char n;
+
+	hist_apply_ack();
+	hist_part_n = HIST_PART_PRE;
+	hist_kind = HIST_NONE;
+
+	if(arq_on && arq_resend)
+	{
+		for(n = 0; !(arq_resend & (1 << n)); n++);
+		hist_cur = arq_base + n;
+		hist_kind = HIST_RETRANSMIT;
+	}
+	else if(hist_bf_active)
+	{
+		hist_cur = hist_bf_seq;
+		hist_kind = HIST_BACKFILL;
+	}
+}
+
+/*
+ * Entry sent (or found overwritten)
+ */
+static void hist_done(void)
+{
+	unsigned int bit;
+
+	if(hist_kind == HIST_RETRANSMIT)
+	{
+		arq_retransmits++;									// also when acknowledged meanwhile
+		if((hist_cur >= arq_base) && (hist_cur - arq_base < ARQ_WINDOW))
+		{
+			bit = 1 << (unsigned int)(hist_cur - arq_base);
+			arq_resend &= ~bit;
+			if(hist_ring[hist_cur & (HIST_ENTRIES - 1)].seq != hist_cur) arq_acked |= bit;	// gone from the ring
+			arq_tries[hist_cur % ARQ_WINDOW]++;
+			arq_tick[hist_cur % ARQ_WINDOW] = tb_get_ticks();
+		}
+	}
+	else if(hist_kind == HIST_BACKFILL)
+	{
+		hist_bf_seq++;
+		if(hist_bf_seq > hist_bf_end) hist_bf_active = FALSE;
+	}
+	hist_kind = HIST_NONE;
+	hist_part_n = HIST_PART_PRE;
+}
+
+/*
+ * "NAME,0xAAAAAAAA,0xBBBBBBBB\r\n", MSB first
+ */
+static unsigned int hist_line(char *buf, const char *name, unsigned long a, unsigned long b)
+{
+	unsigned int n;
+
+	for(n = 0; n < 6; n++) buf[n] = name[n];
+	buf[n++] = ',';
+	n += telem_out_hex32(&buf[n], a);
+	buf[n++] = ',';
+	n += telem_out_hex32(&buf[n], b);
+	return telem_out_crc_field(buf, n);
+}
+
+/*
+ * "TL_TIM,HH:MM:SS\r\n" of the time the entry was first sent
+ */
+static unsigned int hist_time_line(char *buf, unsigned long ms)
+{
+	unsigned int hrs, min, sec;
+
+	sec = (unsigned int)((ms / 1000UL) % 60UL);
+	min = (unsigned int)((ms / 60000UL) % 60UL);
+	hrs = (unsigned int)(ms / 3600000UL);
+
+	memcpy(buf, "TL_TIM,", 7);
+	buf[7] = '0' + hrs / 10;
+	buf[8] = '0' + hrs % 10;
+	buf[9] = ':';
+	buf[10] = '0' + min / 10;
+	buf[11] = '0' + min % 10;
+	buf[12] = ':';
+	buf[13] = '0' + sec / 10;
+	buf[14] = '0' + sec % 10;
+	buf[15] = 0x0D;
+	buf[16] = 0x0A;
+	return 17;
+}
+
+/*
+ * A5 5A type seq len_lo len_hi | sequence (4) | ms of day (4) | {row, data[8]}... | crc
+ * TOUT_TYPE_SEQ carries no rows
+ */
+static unsigned int hist_binary(char *buf, unsigned char type, hist_entry *entry)
+{
+	unsigned char *p;
+	unsigned int n, ii;
+	int off;
+
+	p = (unsigned char *)buf;
+	n = TOUT_BIN_HEADER;
+	for(ii = 0; ii < 32; ii += 8) p[n++] = (unsigned char)(entry->seq >> ii);
+	for(ii = 0; ii < 32; ii += 8) p[n++] = (unsigned char)(entry->ms >> ii);
+
+	if(type != TOUT_TYPE_SEQ)
+	{
+		for(off = 0; off < HF_MSG_PACKET; off++)
+		{
+			if(!(entry->valid & (1 << off))) continue;
+			p[n++] = (unsigned char)hist_hf_row[off];
+			for(ii = 0; ii < 8; ii++) p[n++] = entry->data[off][ii];
+		}
+	}
+
+	return telem_out_bin_frame(buf, type, hist_frame_seq, n - TOUT_BIN_HEADER);
+}
@@ -0,0 +1,78 @@
+/*
+ * history.h
+ *
+ *  Store and forward history of the modem telemetry frames
+ *
+ *  - Every periodic modem frame gets a sequence number, sent as the tag
+ *    "TL_SEQ,0xSSSSSSSS,0xTTTTTTTT,0x0000KKKK" (T = ms of day, K = CRC of
+ *    the record) after the first line,
+ *    and the HF rows it carried are kept in a RAM ring
+ *  - The ground station reports the last sequence it received with
+ *    "seq N", the frames after N still in the ring are sent again as a
+ *    modem background source, between live frames, until caught up
+ *  - Backfilled frames carry "TL_BFS" instead of "TL_SEQ"
+ *
+ *  Binary sinks get TOUT_TYPE_SEQ ahead of each frame and one
+ *  TOUT_TYPE_BACKFILL frame per backfilled entry.
+ *
+ *  Optional selective repeat ARQ ("arq 1", default ARQ_DEFAULT):
+ *  - the ground answers each frame with "ack N" or asks with "nak N"
+ *  - frames in the ARQ_WINDOW not acknowledged within ARQ_RTO_TICKS are
+ *    sent again, up to ARQ_TRIES times, as "TL_RTX" entries ahead of
+ *    any backfill
+ *  - the history ring is the retransmit buffer, a full window slides on
+ *    and gives up its oldest frame instead of holding live telemetry
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#define HIST_ENTRIES		32		// power of 2, 160 s of modem frames at TELEM_STATUS_COUNT
+#define HIST_PART_SIZE		(TOUT_BIN_HEADER + 8 + HF_MSG_PACKET*9 + TOUT_BIN_TRAILER)	// binary backfill frame, > TOUT_LINE_SIZE
+
+// Backfill parts of one ASCII entry
+#define HIST_PART_PRE		0
+#define HIST_PART_SEQ		1
+#define HIST_PART_ROWS		2						// one per valid HF row
+#define HIST_PART_TIME		(HIST_PART_ROWS + HF_MSG_PACKET)
+#define HIST_PART_CRC		(HIST_PART_TIME + 1)	// over PRE, ROWS and TIME
+#define HIST_PART_POST		(HIST_PART_CRC + 1)
+
+// Selective repeat ARQ, tools/arqsim.c measures other values
+#define ARQ_DEFAULT			FALSE
+#ifndef ARQ_WINDOW
+#define ARQ_WINDOW			16						// frames in flight, bits of an unsigned int
+#endif
+#ifndef ARQ_RTO_TICKS
+#define ARQ_RTO_TICKS		(TICK_RATE*3)			// ack timeout per try
+#endif
+#ifndef ARQ_TRIES
+#define ARQ_TRIES			3						// sends after the first one
+#endif
+
+// Entry kinds sent from the history
+#define HIST_NONE			0
+#define HIST_BACKFILL		1
+#define HIST_RETRANSMIT		2
+
+typedef struct _hist_entry
+{
+  unsigned long seq;
+  unsigned long ms;					// ms of day when sent
+  unsigned int valid;				// bit per HF message offset
+  unsigned char data[HF_MSG_PACKET][8];
+} hist_entry;
+
+// Public functions
+void history_init(void);
+unsigned int history_tag(unsigned char format, char **buf);
+unsigned int history_next(unsigned char format, char **buf);
+void history_sent(void);
+void history_ack(unsigned long seq);
+void history_service(void);
+
+// ARQ counters
+extern unsigned int arq_retransmits;			// frames sent again
+extern unsigned int arq_lost;					// frames given up without ack
+
+#endif /* HISTORY_H_ */
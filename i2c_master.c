@@ -0,0 +1,318 @@
+/*
+ * i2c_master.c
+ *
+ *  Queued, interrupt driven I2C master for the USCI_B ports
+ *
+ *  - i2c_transfer() queues a write, read or write-then-read transaction
+ *  - The USCI_B ISR runs the byte sequencing through i2c_isr()
+ *  - i2c_service() (main loop) starts queued transactions once the stop
+ *    condition of the previous one has gone out, checks timeouts and
+ *    runs the completion callbacks
+ *
+ *  Nothing in here waits on the bus, except a single byte read. Its stop
+ *  has to be set while the byte comes in, so i2c_start_read() polls for
+ *  the end of the address phase (about 25 us at 400 kHz, I2C_STT_SPIN).
+ *  No extra byte is clocked in, so reads with side effects are safe.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public structures
+i2c_bus i2c_rtc_bus;
+i2c_bus i2c_imu_bus;
+
+// Private functions
+static void i2c_bus_setup(i2c_bus *bus);
+static void i2c_try_start(i2c_bus *bus);
+static void i2c_start_read(i2c_bus *bus, i2c_xfer *xfer);
+static void i2c_complete(i2c_bus *bus, unsigned char status);
+
+/*
+ * RTC bus - MCP7940 on USCI_B2 (P9.1 SDA, P9.2 SCL)
+ */
+void i2c_rtc_init(void)
+{
+	i2c_bus *bus = &i2c_rtc_bus;
+
+	P9SEL |= RTC_SDA | RTC_SCL;				// Assign I2C pins to USCI_B2
+
+	bus->ctl0  = &UCB2CTL0;
+	bus->ctl1  = &UCB2CTL1;
+	bus->br0   = &UCB2BR0;
+	bus->br1   = &UCB2BR1;
+	bus->stat  = &UCB2STAT;
+	bus->ie    = &UCB2IE;
+	bus->ifg   = &UCB2IFG;
+	bus->rxbuf = &UCB2RXBUF;
+	bus->txbuf = &UCB2TXBUF;
+	bus->i2csa = &UCB2I2CSA;
+	i2c_bus_setup(bus);
+}
+
+/*
+ * IMU bus - USCI_B1 (P3.7 SDA, P5.4 SCL), pins are selected in io_init()
+ */
+void i2c_imu_init(void)
+{
+	i2c_bus *bus = &i2c_imu_bus;
+
+	bus->ctl0  = &UCB1CTL0;
+	bus->ctl1  = &UCB1CTL1;
+	bus->br0   = &UCB1BR0;
+	bus->br1   = &UCB1BR1;
+	bus->stat  = &UCB1STAT;
+	bus->ie    = &UCB1IE;
+	bus->ifg   = &UCB1IFG;
+	bus->rxbuf = &UCB1RXBUF;
+	bus->txbuf = &UCB1TXBUF;
+	bus->i2csa = &UCB1I2CSA;
+	i2c_bus_setup(bus);
+}
+
+/*************************************************************
+/ Name: i2c_transfer
+/ IN: bus, transaction, 7 bit address, write buffer/length,
+/     read buffer/length, completion callback (or 0)
+/ OUT:  1 if queued, 0 if the queue is full or xfer is pending
+/ DESC:  wr_len only = write, rd_len only = read,
+/        both = write then repeated start read
+************************************************************/
+int i2c_transfer(i2c_bus *bus, i2c_xfer *xfer, unsigned char addr,
+		unsigned char *wr_buf, unsigned char wr_len,
+		unsigned char *rd_buf, unsigned char rd_len,
+		void (*callback)(i2c_xfer *xfer))
+{
+	unsigned char next;
+	unsigned short istate;
+
+	if(i2c_pending(xfer)) return 0;
+	if((wr_len == 0) && (rd_len == 0)) return 0;
+
+	xfer->addr = addr;
+	xfer->wr_buf = wr_buf;
+	xfer->wr_len = wr_len;
+	xfer->rd_buf = rd_buf;
+	xfer->rd_len = rd_len;
+	xfer->callback = callback;
+
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	next = bus->q_put + 1;
+	if(next == I2C_QUEUE_SIZE) next = 0;
+	if(next == bus->q_get)
+	{
+		__set_interrupt_state(istate);
+		return 0;							// Failure queue full
+	}
+	if(bus->q_put == bus->q_get) bus->start_tick = tb_get_ticks();
+	xfer->status = I2C_QUEUED;
+	bus->queue[bus->q_put] = xfer;
+	bus->q_put = next;
+	__set_interrupt_state(istate);
+
+	i2c_try_start(bus);
+	return 1;
+}
+
+int i2c_pending(i2c_xfer *xfer)
+{
+	return ((xfer->status == I2C_QUEUED) || (xfer->status == I2C_BUSY));
+}
+
+/*************************************************************
+/ Name: i2c_service
+/ IN: bus
+/ OUT:  void
+/ DESC:  Main loop part of the engine - timeout, callbacks and
+/        starting the next queued transaction
+************************************************************/
+void i2c_service(i2c_bus *bus)
+{
+	i2c_xfer *xfer;
+	unsigned short istate;
+
+	// Head of queue stuck (slave holding SCL, bus busy) - reset the USCI
+	if((bus->q_get != bus->q_put) && ((tb_get_ticks() - bus->start_tick) > I2C_TIMEOUT_TICKS))
+	{
+		istate = __get_interrupt_state();
+		__disable_interrupt();
+		*bus->ctl1 |= UCSWRST;
+		*bus->ctl1 &= ~UCSWRST;				// clears IE, IFG and STAT
+		if(bus->q_get != bus->q_put) i2c_complete(bus, I2C_TIMEOUT);
+		__set_interrupt_state(istate);
+	}
+
+	while(bus->d_get != bus->d_put)
+	{
+		xfer = bus->done[bus->d_get];
+		bus->d_get++;
+		if(bus->d_get == I2C_QUEUE_SIZE) bus->d_get = 0;
+		if(xfer->callback) xfer->callback(xfer);
+	}
+
+	i2c_try_start(bus);
+}
+
+/*
+ * USCI_B interrupt sequencing, called with the UCBxIV value
+ */
+void i2c_isr(i2c_bus *bus, unsigned int iv)
+{
+	extern unsigned volatile char forceread;
+	i2c_xfer *xfer;
+	unsigned char data;
+
+	xfer = bus->queue[bus->q_get];
+
+	switch(__even_in_range(iv,12))
+	{
+	  case 0:break;                             // no interrupt
+	  case 2:                                   // UCALIFG
+		i2c_complete(bus, I2C_ARB_LOST);
+		break;
+	  case 4:                                   // UCNACKIFG
+		*bus->ctl1 |= UCTXSTP;                  // I2C stop condition
+		i2c_complete(bus, I2C_NACK);
+		break;
+	  case 6:                                   // UCSTTIFG - slave only
+		break;
+	  case 8:                                   // UCSTPIFG - slave only
+		break;
+	  case 10:                                  // UCRXIFG
+		data = *bus->rxbuf;
+		if(!bus->active)
+		{
+			forceread = data;                   // flush
+			break;
+		}
+		if(bus->idx < xfer->rd_len) xfer->rd_buf[bus->idx] = data;
+		bus->idx++;
+		if(bus->idx >= xfer->rd_len)
+			i2c_complete(bus, I2C_DONE);
+		else if((xfer->rd_len - bus->idx) == 1)
+			*bus->ctl1 |= UCTXSTP;              // NACK and stop after the last byte
+		break;
+	  case 12:                                  // UCTXIFG
+		if(!bus->active)
+		{
+			*bus->ie &= ~UCTXIE;
+			break;
+		}
+		if(bus->idx < xfer->wr_len)
+		{
+			*bus->txbuf = xfer->wr_buf[bus->idx++];
+		}
+		else if(xfer->rd_len)
+		{
+			bus->idx = 0;
+			i2c_start_read(bus, xfer);          // repeated start
+		}
+		else
+		{
+			*bus->ctl1 |= UCTXSTP;              // I2C stop condition
+			*bus->ifg &= ~UCTXIFG;
+			i2c_complete(bus, I2C_DONE);
+		}
+		break;
+	  default:
+		break;
+	}
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+static void i2c_bus_setup(i2c_bus *bus)
+{
+	*bus->ctl1 |= UCSWRST;                      // Enable SW reset
+	*bus->ctl0 = UCMST + UCMODE_3 + UCSYNC;     // I2C Master, synchronous mode
+	*bus->ctl1 = UCSSEL_3 + UCSWRST;            // Use SMCLK, keep SW reset
+	*bus->br0 = I2C_BR;                         // fSCL = SMCLK/25 = 400 kHz
+	*bus->br1 = 0;
+	*bus->ctl1 &= ~UCSWRST;                     // Clear SW reset, resume operation
+
+	bus->q_put = 0;
+	bus->q_get = 0;
+	bus->d_put = 0;
+	bus->d_get = 0;
+	bus->active = FALSE;
+}
+
+/*
+ * Start the head of the queue once the previous stop condition is out
+ */
+static void i2c_try_start(i2c_bus *bus)
+{
+	i2c_xfer *xfer;
+	unsigned short istate;
+
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	if(!bus->active && (bus->q_get != bus->q_put)
+			&& ((*bus->ctl1 & UCTXSTP) == 0) && ((*bus->stat & UCBBUSY) == 0))
+	{
+		xfer = bus->queue[bus->q_get];
+		bus->active = TRUE;
+		bus->idx = 0;
+		xfer->status = I2C_BUSY;
+		*bus->i2csa = xfer->addr;
+		*bus->ifg &= ~(UCTXIFG | UCRXIFG | UCNACKIFG | UCALIFG);
+		if(xfer->wr_len)
+		{
+			*bus->ctl1 |= UCTR | UCTXSTT;      // I2C TX, start condition
+			*bus->ie |= UCTXIE | UCNACKIE | UCALIE;
+		}
+		else
+		{
+			*bus->ie |= UCNACKIE | UCALIE;
+			i2c_start_read(bus, xfer);
+		}
+	}
+	__set_interrupt_state(istate);
+}
+
+/*
+ * Called from the ISR or with interrupts off. A single byte read sets
+ * the stop as soon as the address phase ends, a bus held past
+ * I2C_STT_SPIN is left to the i2c_service() timeout.
+ */
+static void i2c_start_read(i2c_bus *bus, i2c_xfer *xfer)
+{
+	unsigned int spin;
+
+	*bus->ie &= ~UCTXIE;
+	*bus->ctl1 &= ~UCTR;                        // I2C RX
+	*bus->ctl1 |= UCTXSTT;                      // (repeated) start condition
+	if(xfer->rd_len == 1)
+	{
+		for(spin = I2C_STT_SPIN; spin && (*bus->ctl1 & UCTXSTT); spin--);
+		*bus->ctl1 |= UCTXSTP;                  // NACK and stop after the only byte
+	}
+	*bus->ie |= UCRXIE;
+}
+
+/*
+ * Retire the head of the queue and hand it to i2c_service() for the callback
+ */
+static void i2c_complete(i2c_bus *bus, unsigned char status)
+{
+	i2c_xfer *xfer;
+	unsigned char next;
+
+	*bus->ie &= ~(UCTXIE | UCRXIE | UCNACKIE | UCALIE);
+	xfer = bus->queue[bus->q_get];
+	xfer->status = status;
+	bus->active = FALSE;
+	bus->q_get++;
+	if(bus->q_get == I2C_QUEUE_SIZE) bus->q_get = 0;
+	bus->start_tick = tb_get_ticks();
+
+	next = bus->d_put + 1;
+	if(next == I2C_QUEUE_SIZE) next = 0;
+	if(next != bus->d_get)
+	{
+		bus->done[bus->d_put] = xfer;
+		bus->d_put = next;
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * i2c_master.h
+ *
+ *  Queued, interrupt driven I2C master for the USCI_B ports
+ *   - USCI_B2 = RTC bus (MCP7940)
+ *   - USCI_B1 = IMU bus
+ *
+ *  Transactions are write, read or write-then-read (repeated start).
+ *  The caller owns the i2c_xfer structure and its buffers until the
+ *  callback runs. Callbacks are run from i2c_service() in the main loop.
+ */
+
+#ifndef I2C_MASTER_H_
+#define I2C_MASTER_H_
+
+#define I2C_QUEUE_SIZE		4
+#define I2C_SCL_RATE		400000					// Hz, fast mode
+#define I2C_BR				(SMCLK_RATE/I2C_SCL_RATE)	// 10 MHz / 25
+#define I2C_TIMEOUT_TICKS	(TICK_RATE/4)			// 250 ms per transaction
+#define I2C_STT_SPIN		(MCLK_RATE/20000)		// UCTXSTT polls, 5+ cycles each, > 250 us
+
+// Transaction status
+#define I2C_IDLE			0
+#define I2C_QUEUED			1
+#define I2C_BUSY			2
+#define I2C_DONE			3
+#define I2C_NACK			4
+#define I2C_TIMEOUT			5
+#define I2C_ARB_LOST		6
+
+typedef struct _i2c_xfer
+{
+  unsigned char addr;						// 7 bit slave address
+  unsigned char *wr_buf;
+  unsigned char wr_len;
+  unsigned char *rd_buf;
+  unsigned char rd_len;
+  void (*callback)(struct _i2c_xfer *xfer);	// may be 0
+  volatile unsigned char status;
+} i2c_xfer;
+
+typedef struct _i2c_bus
+{
+  volatile unsigned char *ctl0, *ctl1, *br0, *br1, *stat, *ie, *ifg;
+  volatile unsigned char *rxbuf, *txbuf;
+  volatile unsigned int *i2csa;
+  i2c_xfer *queue[I2C_QUEUE_SIZE];			// queue[q_get] is the active transaction
+  volatile unsigned char q_put, q_get;
+  i2c_xfer *done[I2C_QUEUE_SIZE];			// completed, callback not yet run
+  volatile unsigned char d_put, d_get;
+  volatile unsigned char active;
+  volatile unsigned char idx;
+  unsigned long start_tick;
+} i2c_bus;
+
+// Public structures
+extern i2c_bus i2c_rtc_bus;
+extern i2c_bus i2c_imu_bus;
+
+// Public functions
+void i2c_rtc_init(void);
+void i2c_imu_init(void);
+int i2c_transfer(i2c_bus *bus, i2c_xfer *xfer, unsigned char addr,
+		unsigned char *wr_buf, unsigned char wr_len,
+		unsigned char *rd_buf, unsigned char rd_len,
+		void (*callback)(i2c_xfer *xfer));
+int i2c_pending(i2c_xfer *xfer);
+void i2c_service(i2c_bus *bus);
+void i2c_isr(i2c_bus *bus, unsigned int iv);
+
+#endif /* I2C_MASTER_H_ */
@@ -0,0 +1,161 @@
+/*
+ * rate.c
+ *
+ *  Adaptive rate control of the modem telemetry
+ *
+ *  The controller only moves the modem sink's divider and density, the
+ *  output layer picks them up with the next periodic frame. One step per
+ *  window, so a change is measured before the next one is made.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+unsigned char rate_level;
+unsigned char rate_busy = 0;
+unsigned char rate_rssi = RATE_RSSI_NONE;
+
+// Private variables
+static unsigned char rate_on = RATE_DEFAULT;
+static unsigned char rate_rssi_on = RATE_RSSI_DEFAULT;
+static unsigned char rate_prio[HF_MSG_PACKET];	// priorities of the HF rows, highest first
+static unsigned char rate_levels;				// HF rows in the lookup table
+static unsigned long rate_tick;
+static unsigned long rate_rssi_tick;
+static unsigned int rate_late;					// sink late count at the last window
+
+// Private functions
+static void rate_cmd(unsigned char port, char *args);
+static void rate_rssi_cmd(unsigned char port, char *args);
+static void rate_rssi_done(unsigned char result);
+static void rate_apply(unsigned int divider);
+
+/*************************************************************
+/ Name: rate_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Orders the HF rows by priority and adds the "rate" and
+/        "rssi" commands (after cmd_init and telem_out_init)
+************************************************************/
+void rate_init(void)
+{
+	unsigned char pri;
+	int row, ii;
+
+	// Insertion sort, lower value = higher priority
+	rate_levels = 0;
+	for(row = 0; row < LOOKUP_ROWS; row++)
+	{
+		if(addr_lookup[row][3] != 0) continue;
+		pri = (unsigned char)addr_lookup[row][4];
+		for(ii = rate_levels; (ii > 0) && (rate_prio[ii - 1] > pri); ii--) rate_prio[ii] = rate_prio[ii - 1];
+		rate_prio[ii] = pri;
+		rate_levels++;
+	}
+
+	rate_level = rate_levels;
+	rate_tick = tb_get_ticks();
+	rate_rssi_tick = rate_tick;
+	rate_late = tout_sinks[TOUT_SINK_MODEM].late;
+
+	cmd_register("rate", rate_cmd);
+	cmd_register("rssi", rate_rssi_cmd);
+}
+
+/*************************************************************
+/ Name: rate_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - one control step per RATE_WINDOW and
+/        the periodic RSSI read
+************************************************************/
+void rate_service(void)
+{
+	tout_sink *sink;
+	unsigned long ticks, busy, period;
+	unsigned int divider, late;
+	unsigned char over;
+
+	ticks = tb_get_ticks();
+	sink = &tout_sinks[TOUT_SINK_MODEM];
+
+	if(rate_rssi_on && ((ticks - rate_rssi_tick) >= RATE_RSSI_TICKS) && !Modem_AT_busy())
+	{
+		modem_at_value = 0;
+		if(Modem_AT_run(RFModemRSSI, rate_rssi_done)) rate_rssi_tick = ticks;
+	}
+
+	if((ticks - rate_tick) < RATE_WINDOW) return;
+	rate_tick = ticks;
+
+	busy = telem_out_air_busy() * 100UL / (RATE_WINDOW * (TB_COUNT_RATE/TICK_RATE));
+	rate_busy = (busy > 100) ? 100 : (unsigned char)busy;
+	late = sink->late - rate_late;
+	rate_late = sink->late;
+	if(!rate_on || Modem_AT_busy()) return;		// a script stalls the link, not a load
+
+	divider = sink->divider;
+	period = (unsigned long)divider * (TB_COUNT_RATE/TICK_RATE);
+	over = late || (rate_busy > RATE_BUSY_HIGH) || ((sink->tx_time != TOUT_TX_NONE) && (sink->tx_time > period)) ||
+		   ((rate_rssi != RATE_RSSI_NONE) && (rate_rssi > RATE_RSSI_WEAK));
+
+	if(over)
+	{
+		if(divider < TOUT_MODEM_DIV) divider += (divider >> 2) + 1;
+		else if(!sched_on && (rate_level > RATE_LEVEL_MIN)) rate_level--;
+		else divider += (divider >> 2) + 1;
+		if(divider > RATE_DIV_MAX) divider = RATE_DIV_MAX;
+	}
+	else if(rate_busy < RATE_BUSY_LOW)
+	{
+		if(divider > TOUT_MODEM_DIV) divider--;
+		else if(!sched_on && (rate_level < rate_levels)) rate_level++;
+		else if(divider > RATE_DIV_MIN) divider--;
+	}
+	rate_apply(divider);
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "rate 0" nominal period and full frames, "rate 1" adaptive
+ */
+static void rate_cmd(unsigned char port, char *args)
+{
+	rate_on = (strtoul(args, 0, 0) != 0);
+	if(rate_on) return;
+
+	rate_level = rate_levels;
+	rate_apply(TOUT_MODEM_DIV);
+}
+
+/*
+ * "rssi 1" / "rssi 0", the first read is one RATE_RSSI_TICKS away
+ */
+static void rate_rssi_cmd(unsigned char port, char *args)
+{
+	rate_rssi_on = (strtoul(args, 0, 0) != 0);
+	rate_rssi_tick = tb_get_ticks();
+	if(!rate_rssi_on) rate_rssi = RATE_RSSI_NONE;
+}
+
+static void rate_rssi_done(unsigned char result)
+{
+	if(result == AT_RESULT_OK) rate_rssi = (modem_at_value > 0xFF) ? 0xFF : (unsigned char)modem_at_value;
+}
+
+/*
+ * New period and density of the modem frames, from the next frame on
+ */
+static void rate_apply(unsigned int divider)
+{
+	tout_sink *sink;
+
+	sink = &tout_sinks[TOUT_SINK_MODEM];
+	if(sched_on) sink->density = TOUT_DENSITY_SCHED;		// the budget follows the period
+	else sink->density = (rate_level >= rate_levels) ? TOUT_DENSITY_ALL : rate_prio[rate_level - 1];
+	sink->divider = divider;
+	if(sink->count > divider) sink->count = divider;
+}
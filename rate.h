@@ -0,0 +1,46 @@
+/*
+ * rate.h
+ *
+ *  Adaptive rate control of the modem telemetry
+ *
+ *  - Every RATE_WINDOW the controller looks at the modem sink: the share
+ *    of the window the UART spent sending bursts, periodic frames that
+ *    came due while the last one was still going and the frame time
+ *  - Overloaded (late frames, busy > RATE_BUSY_HIGH or a weak signal):
+ *    a period shorter than nominal is lengthened first, then rows are
+ *    dropped from the frame by priority, then the period is lengthened
+ *    further up to RATE_DIV_MAX
+ *  - Headroom (busy < RATE_BUSY_LOW): rows are added back first, then
+ *    the period is shortened down to RATE_DIV_MIN
+ *  - With the row scheduler on (sched.h) only the period moves, the
+ *    scheduler's byte budget follows it
+ *  - "rate 0" fixes the nominal period and full frames, "rate 1" resumes
+ *  - "rssi 1" reads ATDB every RATE_RSSI_TICKS through the AT engine,
+ *    off by default as each read costs the AT guard times of silence
+ */
+
+#ifndef RATE_H_
+#define RATE_H_
+
+#define RATE_DEFAULT		TRUE
+#define RATE_WINDOW			(TICK_RATE*4)		// decision period
+#define RATE_BUSY_HIGH		85					// % of the window
+#define RATE_BUSY_LOW		50
+#define RATE_DIV_MIN		TICK_RATE			// fastest modem frame period, ticks
+#define RATE_DIV_MAX		(TOUT_MODEM_DIV*2)
+#define RATE_LEVEL_MIN		3					// HF rows kept at the lowest density
+#define RATE_RSSI_DEFAULT	FALSE
+#define RATE_RSSI_TICKS		(TICK_RATE*60)
+#define RATE_RSSI_WEAK		100					// -dBm, weaker counts as overloaded
+#define RATE_RSSI_NONE		0
+
+// Public functions
+void rate_init(void);
+void rate_service(void);
+
+// Public variables
+extern unsigned char rate_level;				// HF rows in the modem frame
+extern unsigned char rate_busy;					// % of the last window
+extern unsigned char rate_rssi;					// -dBm, RATE_RSSI_NONE = not read
+
+#endif /* RATE_H_ */
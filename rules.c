@@ -0,0 +1,243 @@
+/*
+ * rules.c
+ *
+ *  Threshold and event rules on received CAN frames
+ *
+ *  Float limits are only used at init. A float field is compared through
+ *  its IEEE bit pattern mapped to an ordered long key, so frame time work
+ *  is integer compares.
+ */
+
+#include "Sunseeker2021.h"
+
+// Rule table - limits in the units sent on the bus
+static const rule rule_table[] = {
+  //address                           offset  type        cmp           debounce  flags                     limit     hyst
+  {MC_CAN_BASE1 + MC_LIMITS,          2,      RULE_U16,   RULE_MASK,    1,        RULE_CAN | RULE_CAPTURE,  511.0,    0.0},    // motor controller error flags
+  {BP_CAN_BASE + BP_VMAX,             4,      RULE_FP,    RULE_GT,      3,        RULE_CAN,                 4.20,     0.05},   // max cell voltage (V)
+  {BP_CAN_BASE + BP_VMIN,             4,      RULE_FP,    RULE_LT,      3,        RULE_CAN,                 2.80,     0.05},   // min cell voltage (V)
+  {BP_CAN_BASE + BP_TMAX,             4,      RULE_FP,    RULE_GT,      3,        RULE_CAN,                 55.0,     2.0},    // max cell temperature (C)
+  {DC_CAN_BASE + DC_SWITCH,           4,      RULE_U16,   RULE_CHANGE,  1,        0,                        0.0,      0.0},    // driver switch position
+  {MPPT_CAN_BASE + MPPT_CAN_ADDRESS1, 6,      RULE_U16,   RULE_GT,      1,        RULE_CAN,                 7000.0,   200.0},  // MPPT 1 temperature
+  {MPPT_CAN_BASE + MPPT_CAN_ADDRESS2, 6,      RULE_U16,   RULE_GT,      1,        RULE_CAN,                 7000.0,   200.0},  // MPPT 2 temperature
+};
+#define RULES				(sizeof(rule_table)/sizeof(rule))
+
+// Private variables
+static rule_state rule_states[RULES];
+static unsigned char rule_first[LOOKUP_ROWS];		// first rule per lookup row
+static unsigned char rule_other;					// rules on messages outside the lookup table
+
+// Private functions
+static void rule_chain(unsigned char ii);
+static void rule_eval(unsigned char ii, unsigned char *data);
+static long rule_field(const rule *r, unsigned char *data);
+static long rule_key(const rule *r, float value);
+static long rule_order(long bits);
+static void rule_emit(unsigned char ii, unsigned int code, long value);
+
+/*************************************************************
+/ Name: rule_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Builds the per row rule chains and the integer keys of
+/        the limits
+************************************************************/
+void rule_init(void)
+{
+	const rule *r;
+	unsigned char ii;
+
+	for(ii = 0; ii < LOOKUP_ROWS; ii++) rule_first[ii] = RULE_NONE;
+	rule_other = RULE_NONE;
+
+	for(ii = RULES; ii-- > 0; )						// backwards, chains keep table order
+	{
+		r = &rule_table[ii];
+		rule_states[ii].count = 0;
+		rule_states[ii].active = FALSE;
+		rule_states[ii].last = 0;
+
+		if(r->cmp == RULE_GT)
+		{
+			rule_states[ii].trip = rule_key(r, r->limit);
+			rule_states[ii].clear = rule_key(r, r->limit - r->hyst);
+		}
+		else if(r->cmp == RULE_LT)
+		{
+			rule_states[ii].trip = rule_key(r, r->limit);
+			rule_states[ii].clear = rule_key(r, r->limit + r->hyst);
+		}
+		else
+		{
+			rule_states[ii].trip = (long)r->limit;	// RULE_MASK bits
+			rule_states[ii].clear = 0;
+		}
+
+		rule_chain(ii);
+	}
+}
+
+/*************************************************************
+/ Name: rule_row
+/ IN: lookup row, CAN payload
+/ OUT:  void
+/ DESC:  Called by decode() for every frame in the lookup table
+************************************************************/
+void rule_row(int row, unsigned char *data)
+{
+	unsigned char ii;
+
+	for(ii = rule_first[row]; ii != RULE_NONE; ii = rule_states[ii].next)
+		rule_eval(ii, data);
+}
+
+/*************************************************************
+/ Name: rule_address
+/ IN: CAN address, CAN payload
+/ OUT:  void
+/ DESC:  Frames outside the lookup table (MPPT on CAN1)
+************************************************************/
+void rule_address(unsigned int address, unsigned char *data)
+{
+	unsigned char ii;
+
+	for(ii = rule_other; ii != RULE_NONE; ii = rule_states[ii].next)
+		if(rule_table[ii].address == address) rule_eval(ii, data);
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+static void rule_chain(unsigned char ii)
+{
+	int off, pos, pck, row;
+
+	if(lookup(rule_table[ii].address, &off, &pos, &pck, &row))
+	{
+		rule_states[ii].next = rule_first[row];
+		rule_first[row] = ii;
+	}
+	else
+	{
+		rule_states[ii].next = rule_other;
+		rule_other = ii;
+	}
+}
+
+static void rule_eval(unsigned char ii, unsigned char *data)
+{
+	const rule *r;
+	rule_state *st;
+	long v;
+	unsigned char hit;
+
+	r = &rule_table[ii];
+	st = &rule_states[ii];
+	v = rule_field(r, data);
+
+	switch(r->cmp)
+	{
+	  case RULE_GT:
+		hit = (v > st->trip);
+		if(st->active && (v < st->clear)) hit = 2;
+		break;
+	  case RULE_LT:
+		hit = (v < st->trip);
+		if(st->active && (v > st->clear)) hit = 2;
+		break;
+	  case RULE_MASK:
+		hit = ((v & st->trip) != 0);
+		if(st->active && !hit) hit = 2;
+		break;
+	  default:										// RULE_CHANGE, first frame only sets the reference
+		if(st->active && (v != st->last)) rule_emit(ii, RULE_ALARM_BASE + ii, v);
+		st->last = v;
+		st->active = TRUE;
+		return;
+	}
+
+	if(hit == 2)
+	{
+		st->active = FALSE;
+		st->count = 0;
+		rule_emit(ii, (RULE_ALARM_BASE + ii) | RULE_ALARM_CLEAR, v);
+	}
+	else if(hit && !st->active)
+	{
+		if(++st->count >= r->debounce)
+		{
+			st->active = TRUE;
+			rule_emit(ii, RULE_ALARM_BASE + ii, v);
+		}
+	}
+	else if(!hit) st->count = 0;
+}
+
+/*
+ * Field as an ordered integer key, float fields by their bit pattern
+ */
+static long rule_field(const rule *r, unsigned char *data)
+{
+	const unsigned char *d;
+	long v;
+
+	d = &data[r->offset];
+	switch(r->type)
+	{
+	  case RULE_U8:
+		return d[0];
+	  case RULE_U16:
+		return (unsigned int)(d[0] | (d[1] << 8));
+	  case RULE_I16:
+		return (int)(d[0] | (d[1] << 8));
+	  default:										// RULE_U32, RULE_FP
+		v = (unsigned long)d[0] | ((unsigned long)d[1] << 8) | ((unsigned long)d[2] << 16) | ((unsigned long)d[3] << 24);
+		return (r->type == RULE_FP) ? rule_order(v) : v;
+	}
+}
+
+/*
+ * Limit in the field's key space, init only
+ */
+static long rule_key(const rule *r, float value)
+{
+	long bits;
+
+	if(r->type != RULE_FP) return (long)value;
+
+	memcpy(&bits, &value, sizeof(long));
+	return rule_order(bits);
+}
+
+/*
+ * IEEE bits to a key with the float order, negative floats count
+ * down as the bits count up - also maps a key back to the bits
+ */
+static long rule_order(long bits)
+{
+	return (bits < 0) ? (bits ^ 0x7FFFFFFF) : bits;
+}
+
+/*
+ * Alarm record to telemetry, TM_EVENT frame if the rule asks for it
+ * High = alarm code, Low = field (raw bits for floats)
+ */
+static void rule_emit(unsigned char ii, unsigned int code, long value)
+{
+	extern can_struct TX_can0_message;
+
+	if(rule_table[ii].type == RULE_FP) value = rule_order(value);	// back to IEEE bits
+
+	telem_out_alarm(code, (unsigned long)value);
+	if((rule_table[ii].flags & RULE_CAPTURE) && !(code & RULE_ALARM_CLEAR)) capture_trigger(code);
+
+	if(rule_table[ii].flags & RULE_CAN)
+	{
+		TX_can0_message.address = TM_CAN_BASE + TM_EVENT;
+		TX_can0_message.data.data_u32[1] = code;
+		TX_can0_message.data.data_u32[0] = (unsigned long)value;
+		can0_transmit();
+	}
+}
@@ -0,0 +1,68 @@
+/*
+ * rules.h
+ *
+ *  Threshold and event rules on received CAN frames
+ *
+ *  - Each rule reads one field of one CAN message and compares it with a
+ *    limit, with hysteresis on the way back and a debounce count
+ *  - decode() hands every frame found in the lookup table to rule_row(),
+ *    frames outside the table (MPPT on CAN1) go to rule_address()
+ *  - Rules are chained per lookup row and limits are turned into integer
+ *    keys at init, so a frame costs one compare per rule on its message
+ *  - A triggered or cleared rule posts an alarm record to telemetry and,
+ *    if RULE_CAN is set, a TM_EVENT frame on CAN0, a trip of a
+ *    RULE_CAPTURE rule also triggers the capture buffer
+ */
+
+#ifndef RULES_H_
+#define RULES_H_
+
+// Field types, little endian at the byte offset
+#define RULE_U8				0
+#define RULE_U16			1
+#define RULE_I16			2
+#define RULE_U32			3
+#define RULE_FP				4
+
+// Comparators
+#define RULE_GT				0		// trips above limit, clears below limit - hyst
+#define RULE_LT				1		// trips below limit, clears above limit + hyst
+#define RULE_MASK			2		// trips while any bit of (long)limit is set
+#define RULE_CHANGE			3		// event on every change of the field
+
+// Flags
+#define RULE_CAN			0x01	// also send TM_EVENT on CAN0
+#define RULE_CAPTURE		0x02	// trip triggers the full rate capture
+
+#define RULE_NONE			0xFF	// end of a rule chain
+#define RULE_ALARM_BASE		0x0200	// alarm code = base + rule index
+#define RULE_ALARM_CLEAR	0x8000	// set in the code when a rule clears
+
+typedef struct _rule
+{
+  unsigned int address;				// CAN message
+  unsigned char offset;				// byte offset of the field
+  unsigned char type;				// RULE_U8 ... RULE_FP
+  unsigned char cmp;				// RULE_GT ... RULE_CHANGE
+  unsigned char debounce;			// consecutive frames before tripping, >= 1
+  unsigned char flags;
+  float limit;						// in the field's units, mask for RULE_MASK
+  float hyst;
+} rule;
+
+typedef struct _rule_state
+{
+  long trip;						// integer key of the limit
+  long clear;						// integer key of limit -/+ hyst
+  long last;						// last key, RULE_CHANGE
+  unsigned char count;				// frames meeting the trip condition
+  unsigned char active;
+  unsigned char next;				// next rule on the same message
+} rule_state;
+
+// Public functions
+void rule_init(void);
+void rule_row(int row, unsigned char *data);
+void rule_address(unsigned int address, unsigned char *data);
+
+#endif /* RULES_H_ */
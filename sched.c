@@ -0,0 +1,133 @@
+/*
+ * sched.c
+ *
+ *  Priority weighted row scheduler of the modem frames
+ *
+ *  One pick per frame, in three passes over the rows: the always set,
+ *  the rotating rows that reached SCHED_MAX_STALE (longest wait first),
+ *  then the turn order from the cursor until the frame is full. Only rows
+ *  received at least once (tout_rows) take part.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+unsigned char sched_on = SCHED_DEFAULT;
+unsigned int sched_overrun = 0;
+
+// Private variables
+static unsigned char sched_stale[LOOKUP_ROWS];	// frames since the row was sent
+static unsigned char sched_cursor = 0;			// next rotating row to try
+
+// Private functions
+static void sched_cmd(unsigned char port, char *args);
+static unsigned char sched_always(int row);
+
+/*************************************************************
+/ Name: sched_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Clears the row ages and adds the "sched" command
+/        (after cmd_init)
+************************************************************/
+void sched_init(void)
+{
+	int row;
+
+	for(row = 0; row < LOOKUP_ROWS; row++) sched_stale[row] = 0;
+	sched_cursor = 0;
+
+	cmd_register("sched", sched_cmd);
+}
+
+/*************************************************************
+/ Name: sched_budget
+/ IN: frame period in ticks
+/ OUT:  bytes of row lines per frame
+/ DESC:  SCHED_SHARE % of the serial link over one period
+************************************************************/
+unsigned int sched_budget(unsigned int divider)
+{
+	unsigned long bytes;
+
+	bytes = ((unsigned long)modem_baud / 10UL) * divider / TICK_RATE;
+	bytes = bytes * SCHED_SHARE / 100UL;
+	return (bytes > 0xFFFF) ? 0xFFFF : (unsigned int)bytes;
+}
+
+/*************************************************************
+/ Name: sched_pick
+/ IN: row list (LOOKUP_ROWS), rows that fit the budget
+/ OUT:  rows picked
+/ DESC:  Picks the rows of the next frame and ages the others
+************************************************************/
+unsigned char sched_pick(unsigned char *rows, unsigned char max)
+{
+	unsigned char picked[LOOKUP_ROWS];
+	unsigned char n, oldest, ii;
+	int row;
+
+	for(row = 0; row < LOOKUP_ROWS; row++) picked[row] = FALSE;
+	n = 0;
+
+	// Always set
+	for(row = 0; (row < LOOKUP_ROWS) && (n < max); row++)
+	{
+		if(!tout_rows[row].valid || !sched_always(row)) continue;
+		rows[n++] = (unsigned char)row;
+		picked[row] = TRUE;
+	}
+
+	// Rows at their staleness limit, longest wait first
+	while(n < max)
+	{
+		oldest = 0xFF;
+		for(row = 0; row < LOOKUP_ROWS; row++)
+		{
+			if(!tout_rows[row].valid || picked[row] || sched_always(row) || (sched_stale[row] < SCHED_MAX_STALE)) continue;
+			if((oldest == 0xFF) || (sched_stale[row] > sched_stale[oldest])) oldest = (unsigned char)row;
+		}
+		if(oldest == 0xFF) break;
+		rows[n++] = oldest;
+		picked[oldest] = TRUE;
+	}
+
+	// Turn order
+	for(ii = 0; (ii < LOOKUP_ROWS) && (n < max); ii++)
+	{
+		row = sched_cursor;
+		sched_cursor = (sched_cursor + 1) % LOOKUP_ROWS;
+		if(!tout_rows[row].valid || picked[row] || sched_always(row)) continue;
+		rows[n++] = (unsigned char)row;
+		picked[row] = TRUE;
+	}
+
+	for(row = 0; row < LOOKUP_ROWS; row++)
+	{
+		if(picked[row]) sched_stale[row] = 0;
+		else if(tout_rows[row].valid && (sched_stale[row] < 0xFF))
+		{
+			sched_stale[row]++;
+			if(sched_stale[row] == SCHED_MAX_STALE + 1) sched_overrun++;
+		}
+	}
+	return n;
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "sched 1" / "sched 0", from the next modem frame on
+ */
+static void sched_cmd(unsigned char port, char *args)
+{
+	sched_on = (strtoul(args, 0, 0) != 0);
+	tout_sinks[TOUT_SINK_MODEM].density = sched_on ? TOUT_DENSITY_SCHED : TOUT_DENSITY_ALL;
+}
+
+static unsigned char sched_always(int row)
+{
+	return (addr_lookup[row][4] <= SCHED_ALWAYS);
+}
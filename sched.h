@@ -0,0 +1,35 @@
+/*
+ * sched.h
+ *
+ *  Priority weighted row scheduler of the modem frames
+ *
+ *  - With "sched 1" the periodic modem frame carries rows picked from
+ *    the whole lookup table instead of the fixed HF packet layout
+ *  - The byte budget of a frame is SCHED_SHARE % of what the serial link
+ *    moves in one frame period, at most HF_MSG_PACKET lines for ASCII
+ *  - Rows with a "Filter Priority" up to SCHED_ALWAYS go in every frame,
+ *    the others take turns, and one that has waited SCHED_MAX_STALE
+ *    frames goes ahead of the turn order
+ *  - The staleness bound holds while the budget has room for the always
+ *    rows plus one rotating row in SCHED_MAX_STALE, frames that miss it
+ *    are counted in sched_overrun
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#define SCHED_DEFAULT		FALSE
+#define SCHED_SHARE			60			// % of the link per frame period
+#define SCHED_ALWAYS		5			// priorities sent every frame (MC bus, velocity, BP shunt)
+#define SCHED_MAX_STALE		8			// frames a rotating row may be left out
+
+// Public variables
+extern unsigned char sched_on;
+extern unsigned int sched_overrun;				// rows left out longer than SCHED_MAX_STALE
+
+// Public functions
+void sched_init(void);
+unsigned int sched_budget(unsigned int divider);
+unsigned char sched_pick(unsigned char *rows, unsigned char max);
+
+#endif /* SCHED_H_ */
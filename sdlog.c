@@ -0,0 +1,1001 @@
+/*
+ * sdlog.c
+ *
+ *  Black box log of every received CAN frame on the SD card
+ *
+ *  Appending is a 16 byte copy in the main loop. The card is driven by a
+ *  state machine in sdlog_service() that never waits on the card: a
+ *  command is a few bytes at SPI speed, the data block is DMA, and the
+ *  programming busy time is polled. Card init runs at 400 kHz, the
+ *  ACMD41 loop is one try per tick, so it leaves the main loop time for
+ *  decode() at full bus load (tools/sdsim.c).
+ *
+ *  Index and superblock are small, they are sent polled with 0xFF fill
+ *  instead of taking a sector buffer. Reads (mount, search, replay) are
+ *  polled single blocks into one sector buffer, which doubles as a cache
+ *  of the last sector read, and only run while no write is open and a
+ *  sector buffer is still free.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+unsigned char sdlog_state = SDLOG_OFF;
+unsigned long sdlog_sectors = 0;
+unsigned int sdlog_dropped = 0;
+unsigned char sdlog_errors = 0;
+
+// Private variables
+static unsigned char sdlog_buf[SDLOG_BUFS][SDLOG_SECTOR];
+static unsigned char sdlog_on = SDLOG_DEFAULT;
+static unsigned char sdlog_send = 0;			// oldest full buffer
+static unsigned char sdlog_full = 0;			// full buffers, written in order from sdlog_send
+static unsigned int sdlog_fill_n = 0;			// records in the buffer after the full ones
+static unsigned int sdlog_gap = 0;				// frames dropped since the last record
+static unsigned long sdlog_fill_tick;			// tick of the first record of the filling buffer
+static unsigned long sdlog_seq = 0;				// sequence of the next sector written
+static unsigned long sdlog_open_seq;			// sequence the open CMD25 started at
+static unsigned long sdlog_gen = 0;				// next superblock generation
+static unsigned long sdlog_day = 0;				// log day of sdlog_last_key, modulo SDLOG_DAYS
+static unsigned long sdlog_last_key = 0;		// log ms of the newest sector
+static unsigned char sdlog_super_due = FALSE;
+static unsigned char sdlog_mounted = FALSE;
+static unsigned char sdlog_mount_n;				// superblocks read, then sectors scanned + 2
+static unsigned char sdlog_block_index;			// TRUE while the index sector is programmed
+static unsigned char sdlog_index[SDLOG_INDEX_SIZE];	// index sector of the span being written
+static unsigned char sdlog_ccs;					// TRUE = block addressed card
+static unsigned long sdlog_tick;				// start of the state's timeout
+static unsigned long sdlog_init_tick;			// tick of the last ACMD41
+
+// Sector reads
+static unsigned char sdlog_rd[SDLOG_SECTOR];
+static unsigned long sdlog_rd_want = SDLOG_NONE;	// sector to read next
+static unsigned long sdlog_cache = SDLOG_NONE;	// sector in sdlog_rd
+
+// Replay
+static unsigned char sdlog_rp = SDR_NONE;
+static unsigned char sdlog_rp_sink;				// TOUT_SINK_xxx that asked
+static unsigned char sdlog_rp_format;
+static unsigned long sdlog_rp_from, sdlog_rp_to;	// log ms
+static unsigned long sdlog_rp_ref;				// ages are taken back from here
+static unsigned long sdlog_rp_end;				// first sequence not searched
+static unsigned long sdlog_rp_oldest;			// first sequence of the oldest whole span
+static unsigned long sdlog_rp_lo, sdlog_rp_hi;	// search over data sectors in log order
+static unsigned long sdlog_rp_seq;				// sector being sent
+static unsigned int sdlog_rp_rec;				// ASCII: next record, binary: next half
+static unsigned int sdlog_rp_lines;				// records in the last ASCII part
+static unsigned char sdlog_rp_past;				// last ASCII part reached TO
+static unsigned long sdlog_rp_count;			// records sent
+static unsigned char sdlog_rp_bseq = 0;
+static unsigned char sdlog_part[SDLOG_PART_SIZE];
+
+// Private functions
+static void sdlog_cmd(unsigned char port, char *args);
+static void sdlog_get_cmd(unsigned char port, char *args);
+static void sdlog_close(void);
+static unsigned long sdlog_key(unsigned long ms);
+static unsigned long sdlog_age(unsigned long key);
+static unsigned char sdlog_card_start(void);
+static void sdlog_card_fail(void);
+static void sdlog_dma_start(unsigned char *buf);
+static void sdlog_read_start(unsigned long ticks);
+static unsigned char sdlog_have(unsigned long sector);
+static void sdlog_mount_step(void);
+static void sdlog_super_write(unsigned long ticks);
+static unsigned char sdlog_index_write(void);
+static void sdlog_replay_step(void);
+static void sdlog_seek_step(void);
+static unsigned long sdlog_d2seq(unsigned long d);
+static unsigned int sdlog_next(unsigned char sink, unsigned char format, char **buf);
+static unsigned int sdlog_render_mark(const char *tag, unsigned long a, unsigned long b);
+static unsigned int sdlog_render_lines(void);
+static unsigned int sdlog_render_half(void);
+static unsigned char sd_command(unsigned char cmd, unsigned long arg);
+static unsigned char sd_put_block(unsigned char token, unsigned char *buf, unsigned int len);
+static unsigned char sd_xchg(unsigned char data);
+static void sd_put16(unsigned char *p, unsigned int value);
+static void sd_put32(unsigned char *p, unsigned long value);
+static unsigned int sd_get16(unsigned char *p);
+static unsigned long sd_get32(unsigned char *p);
+
+#define SDLOG_POS(seq)		(SDLOG_DATA + (seq) % SDLOG_DATA_SECTORS)
+
+/*************************************************************
+/ Name: sdlog_init
+/ IN: void
+/ OUT:  void
+/ DESC:  UCB0 as SPI master for the card, adds the "sdlog" and
+/        "sdget" commands (after cmd_init), the card is started
+/        and the write head recovered by sdlog_service()
+************************************************************/
+void sdlog_init(void)
+{
+	UCB0CTL1 |= UCSWRST;					//software reset
+	UCB0CTL0 = UCCKPH | UCMSB | UCMST | UCMODE_0 | UCSYNC;	//SPI mode 0, MSB first, master, 3-pin
+	UCB0CTL1 |= UCSSEL_2;					//SMCLK
+	UCB0BR0 = SDLOG_BR_INIT;
+	UCB0BR1 = 0x00;
+	UCB0STAT = 0x00;
+	UCB0CTL1 &= ~UCSWRST;
+
+	P9OUT |= SDC_CSn;
+	sdlog_state = SDLOG_OFF;
+	sdlog_mounted = FALSE;
+	sdlog_tick = tb_get_ticks() - SDLOG_RETRY_TICKS;	// first start right away
+
+	cmd_register("sdlog", sdlog_cmd);
+	cmd_register("sdget", sdlog_get_cmd);
+}
+
+/*************************************************************
+/ Name: sdlog_frame
+/ IN: SDLOG_ID_CAN1 for the MPPT bus or 0, received frame
+/ OUT:  void
+/ DESC:  Appends one record to the filling sector buffer, the
+/        frame is counted as dropped when all buffers are full.
+/        Main loop only.
+************************************************************/
+void sdlog_frame(unsigned int id, can_struct *msg)
+{
+	unsigned char *p;
+	int ii;
+
+	if(!sdlog_on || (msg->status == CAN_ERROR)) return;
+
+	if(sdlog_full >= SDLOG_BUFS)
+	{
+		if(sdlog_gap < 0xFFFF) sdlog_gap++;
+		if(sdlog_dropped < 0xFFFF) sdlog_dropped++;
+		return;
+	}
+
+	p = sdlog_buf[(sdlog_send + sdlog_full) % SDLOG_BUFS];
+	if(sdlog_fill_n == 0)
+	{
+		sd_put32(&p[SDLOG_HDR_MS], sdlog_key(tb_get_ms()));
+		sd_put32(&p[SDLOG_HDR_TB], tb_now());
+		sdlog_fill_tick = tb_get_ticks();
+	}
+
+	p += SDLOG_HEADER + sdlog_fill_n*SDLOG_RECORD;
+	id |= msg->address & 0x07FF;
+	if(msg->status == CAN_RTR) id |= SDLOG_ID_RTR;
+	sd_put32(&p[0], tb_now());
+	sd_put16(&p[4], id);
+	sd_put16(&p[6], sdlog_gap);
+	for(ii = 0; ii < 8; ii++) p[8 + ii] = msg->data.data_u8[ii];
+	sdlog_gap = 0;
+
+	sdlog_fill_n++;
+	if(sdlog_fill_n >= SDLOG_RECORDS) sdlog_close();
+}
+
+/*************************************************************
+/ Name: sdlog_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - card start, write head recovery, block
+/        writes, replay reads and the flush of a sector that
+/        fills slowly
+************************************************************/
+void sdlog_service(void)
+{
+	extern char end_SD_TX;
+	unsigned long ticks;
+	unsigned char r;
+	int ii;
+
+	ticks = tb_get_ticks();
+
+	if((sdlog_fill_n != 0) && (sdlog_full < SDLOG_BUFS) && ((ticks - sdlog_fill_tick) >= SDLOG_FLUSH_TICKS))
+		sdlog_close();
+
+	switch(sdlog_state)
+	{
+	  case SDLOG_OFF:
+		if(!sdlog_on && (sdlog_rp == SDR_NONE)) break;
+		if(P4IN & SDC_CDn) break;					// no card
+		if(!(P4IN & SDC_WPn)) break;				// write protected
+		if((ticks - sdlog_tick) < SDLOG_RETRY_TICKS) break;
+		sdlog_tick = ticks;
+		if(sdlog_card_start()) sdlog_state = SDLOG_INIT;
+		else sdlog_card_fail();
+		break;
+
+	  case SDLOG_INIT:
+		if(ticks == sdlog_init_tick) break;		// one try per tick, a try takes 0.4 ms at 400 kHz
+		sdlog_init_tick = ticks;
+		sd_command(SD_CMD55, 0);
+		r = sd_command(SD_ACMD41, 0x40000000UL);	// HCS, high capacity supported
+		if(r == 0)
+		{
+			sdlog_ccs = FALSE;
+			if(sd_command(SD_CMD58, 0) == 0) sdlog_ccs = ((sd_xchg(0xFF) & SD_OCR_CCS) != 0);
+			sd_xchg(0xFF);
+			sd_xchg(0xFF);
+			sd_xchg(0xFF);
+			P9OUT |= SDC_CSn;
+			sd_xchg(0xFF);
+			UCB0CTL1 |= UCSWRST;
+			UCB0BR0 = SDLOG_BR_FAST;
+			UCB0CTL1 &= ~UCSWRST;
+			sdlog_mount_n = 0;
+			sdlog_state = SDLOG_READY;
+		}
+		else if((r != SD_R1_IDLE) || ((ticks - sdlog_tick) >= SDLOG_INIT_TICKS)) sdlog_card_fail();
+		break;
+
+	  case SDLOG_READY:
+		if(!sdlog_mounted) sdlog_mount_step();
+		else if(sdlog_super_due)
+		{
+			sdlog_super_write(ticks);
+			break;
+		}
+		else if(sdlog_rd_want == SDLOG_NONE) sdlog_replay_step();
+
+		if((sdlog_rd_want != SDLOG_NONE) && (!sdlog_mounted || (sdlog_full < SDLOG_BUFS)))
+		{
+			sdlog_read_start(ticks);
+			break;
+		}
+		if(!sdlog_mounted) break;
+		if(sdlog_full == 0)
+		{
+			if(!sdlog_on && (sdlog_rp == SDR_NONE)) sdlog_state = SDLOG_OFF;
+			break;
+		}
+		P9OUT &= ~SDC_CSn;
+		if(sd_command(SD_CMD25, sdlog_ccs ? SDLOG_POS(sdlog_seq) : SDLOG_POS(sdlog_seq)*SDLOG_SECTOR) != 0)
+		{
+			sdlog_card_fail();
+			break;
+		}
+		sdlog_open_seq = sdlog_seq;
+		sdlog_state = SDLOG_OPEN;
+		// no break, the first block goes out right away
+
+	  case SDLOG_OPEN:
+		if((sdlog_seq % SDLOG_SPAN) == SDLOG_SPAN - 1)
+		{
+			if(!sdlog_index_write()) break;		// index right after the last data sector of the span
+			sdlog_tick = ticks;
+			sdlog_state = SDLOG_BUSY;
+			break;
+		}
+		if(sdlog_super_due || ((sdlog_seq != sdlog_open_seq) && (SDLOG_POS(sdlog_seq) == SDLOG_DATA)) ||
+		   ((sdlog_full == 0) && (!sdlog_on || (sdlog_rp != SDR_NONE))))
+		{
+			sd_xchg(SD_TOKEN_STOP);		// superblock, end of the region, stopped or replay reads
+			sd_xchg(0xFF);
+			sdlog_tick = ticks;
+			sdlog_state = SDLOG_STOP;
+			break;
+		}
+		if(sdlog_full == 0) break;
+		sd_put32(&sdlog_buf[sdlog_send][SDLOG_HDR_SEQ], sdlog_seq);
+		sd_xchg(0xFF);
+		sd_xchg(SD_TOKEN_MULTI);
+		end_SD_TX = FALSE;
+		sdlog_block_index = FALSE;
+		sdlog_dma_start(sdlog_buf[sdlog_send]);
+		sdlog_state = SDLOG_DMA;
+		break;
+
+	  case SDLOG_DMA:
+		if(!end_SD_TX) break;
+		while(UCB0STAT & UCBUSY);	// last byte shifting out
+		r = UCB0RXBUF;				// clears the overrun of the DMA block
+		sd_xchg(0xFF);				// CRC, not checked in SPI mode
+		sd_xchg(0xFF);
+		r = sd_xchg(0xFF);
+		if((r & 0x1F) != SD_DATA_ACCEPTED)
+		{
+			sdlog_card_fail();
+			break;
+		}
+		sdlog_tick = ticks;
+		sdlog_state = SDLOG_BUSY;
+		break;
+
+	  case SDLOG_BUSY:
+		if(sd_xchg(0xFF) == 0x00)
+		{
+			if((ticks - sdlog_tick) >= SDLOG_BUSY_TICKS) sdlog_card_fail();
+			break;
+		}
+		if(sdlog_cache == SDLOG_POS(sdlog_seq)) sdlog_cache = SDLOG_NONE;
+		if(sdlog_block_index) sdlog_super_due = TRUE;
+		else
+		{
+			for(ii = 0; ii < 4; ii++)
+				sdlog_index[SDLOG_HEADER + (sdlog_seq % SDLOG_SPAN)*4 + ii] = sdlog_buf[sdlog_send][SDLOG_HDR_MS + ii];
+			sdlog_send = (sdlog_send + 1) % SDLOG_BUFS;
+			sdlog_full--;
+		}
+		sdlog_seq++;
+		sdlog_sectors++;
+		sdlog_state = SDLOG_OPEN;
+		break;
+
+	  case SDLOG_STOP:
+	  case SDLOG_SUPER:
+		if(sd_xchg(0xFF) == 0x00)
+		{
+			if((ticks - sdlog_tick) >= SDLOG_BUSY_TICKS) sdlog_card_fail();
+			break;
+		}
+		P9OUT |= SDC_CSn;
+		sd_xchg(0xFF);
+		if(sdlog_state == SDLOG_SUPER)
+		{
+			sdlog_gen++;
+			sdlog_super_due = FALSE;
+		}
+		sdlog_state = SDLOG_READY;
+		break;
+
+	  case SDLOG_READ:
+		for(ii = 0; ii < SDLOG_POLLS; ii++)
+		{
+			r = sd_xchg(0xFF);
+			if(r != 0xFF) break;
+		}
+		if(r == 0xFF)
+		{
+			if((ticks - sdlog_tick) >= SDLOG_READ_TICKS) sdlog_card_fail();
+			break;
+		}
+		if(r != SD_TOKEN_SINGLE)
+		{
+			sdlog_card_fail();		// error token
+			break;
+		}
+		for(ii = 0; ii < SDLOG_SECTOR; ii++) sdlog_rd[ii] = sd_xchg(0xFF);
+		sd_xchg(0xFF);				// CRC
+		sd_xchg(0xFF);
+		P9OUT |= SDC_CSn;
+		sd_xchg(0xFF);
+		sdlog_cache = sdlog_rd_want;
+		sdlog_rd_want = SDLOG_NONE;
+		sdlog_state = SDLOG_READY;
+		break;
+
+	  default:
+		sdlog_state = SDLOG_OFF;
+		break;
+	}
+}
+
+/*************************************************************
+/ Name: sdlog_next_modem, sdlog_next_usb
+/ IN: sink format, pointer to the part
+/ OUT:  length of the next replay part, 0 if nothing to send
+/ DESC:  Background sources of the telemetry output layer, a
+/        replay goes to the port that asked for it. The same
+/        part is returned until sdlog_sent().
+************************************************************/
+unsigned int sdlog_next_modem(unsigned char format, char **buf)
+{
+	return sdlog_next(TOUT_SINK_MODEM, format, buf);
+}
+
+unsigned int sdlog_next_usb(unsigned char format, char **buf)
+{
+	return sdlog_next(TOUT_SINK_USB, format, buf);
+}
+
+/*
+ * Last part from sdlog_next() is out
+ */
+void sdlog_sent(void)
+{
+	switch(sdlog_rp)
+	{
+	  case SDR_START:
+		sdlog_rp = SDR_READ;
+		break;
+
+	  case SDR_SEND:
+		if(sdlog_rp_format == TOUT_BINARY)
+		{
+			sdlog_rp_bseq++;
+			sdlog_rp_rec++;
+			if(sdlog_rp_rec < 2) break;
+		}
+		else
+		{
+			sdlog_rp_rec += sdlog_rp_lines;
+			sdlog_rp_count += sdlog_rp_lines;
+			if(sdlog_rp_past)
+			{
+				sdlog_rp = SDR_END;
+				break;
+			}
+			if(sdlog_rp_rec < sd_get16(&sdlog_rd[SDLOG_HDR_COUNT])) break;
+		}
+		sdlog_rp_seq++;
+		sdlog_rp = SDR_READ;
+		break;
+
+	  case SDR_END:
+		sdlog_rp = SDR_NONE;
+		break;
+
+	  default:
+		break;
+	}
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "sdlog 0" closes the open write and stops logging, "sdlog 1" starts
+ */
+static void sdlog_cmd(unsigned char port, char *args)
+{
+	sdlog_on = (strtoul(args, 0, 0) != 0);
+	if(!sdlog_on)
+	{
+		sdlog_fill_n = 0;
+		sdlog_gap = 0;
+		if(sdlog_state <= SDLOG_INIT)
+		{
+			sdlog_full = 0;
+			P9OUT |= SDC_CSn;
+			sdlog_state = SDLOG_OFF;
+		}
+	}
+	else sdlog_tick = tb_get_ticks() - SDLOG_RETRY_TICKS;
+}
+
+/*
+ * "sdget FROM TO", log ms, FROM = 0 from the oldest sector, TO = 0 for
+ * everything up to the write head
+ * - replaces a replay in progress
+ */
+static void sdlog_get_cmd(unsigned char port, char *args)
+{
+	char *end;
+
+	// A day ahead of the head, the sum would not fit 32 bits near the wrap
+	if(sdlog_last_key < SDLOG_KEY_SPAN - TB_MS_PER_DAY) sdlog_rp_ref = sdlog_last_key + TB_MS_PER_DAY;
+	else sdlog_rp_ref = sdlog_last_key - (SDLOG_KEY_SPAN - TB_MS_PER_DAY);
+	sdlog_rp_from = strtoul(args, &end, 0) % SDLOG_KEY_SPAN;
+	sdlog_rp_to = strtoul(end, 0, 0) % SDLOG_KEY_SPAN;
+	if(sdlog_rp_from == 0) sdlog_rp_from = (sdlog_rp_ref + 1) % SDLOG_KEY_SPAN;	// oldest there can be
+	if(sdlog_rp_to == 0) sdlog_rp_to = (sdlog_last_key + SDLOG_DAY_TOL) % SDLOG_KEY_SPAN;
+	sdlog_rp_sink = (port == CMD_PORT_USB) ? TOUT_SINK_USB : TOUT_SINK_MODEM;
+	sdlog_rp_format = tout_sinks[sdlog_rp_sink].format;
+	sdlog_rp = SDR_REQ;
+}
+
+/*
+ * Filling buffer is complete, fills the header and queues it, the
+ * sequence is set when the block is sent
+ */
+static void sdlog_close(void)
+{
+	unsigned char *p;
+	unsigned int ii;
+
+	p = sdlog_buf[(sdlog_send + sdlog_full) % SDLOG_BUFS];
+	sd_put16(&p[SDLOG_HDR_MAGIC], SDLOG_MAGIC);
+	sd_put16(&p[SDLOG_HDR_COUNT], sdlog_fill_n);
+	for(ii = SDLOG_HEADER + sdlog_fill_n*SDLOG_RECORD; ii < SDLOG_SECTOR; ii++) p[ii] = 0xFF;
+
+	sdlog_fill_n = 0;
+	sdlog_full++;
+}
+
+/*
+ * Log ms of a new sector from its ms of day: days counted since the log
+ * began (modulo SDLOG_DAYS) + ms, never less than the newest sector. The
+ * day steps when the ms of day goes back by more than SDLOG_DAY_TOL
+ * (midnight, or switched off over night), a smaller step back is a
+ * resync and is held.
+ */
+static unsigned long sdlog_key(unsigned long ms)
+{
+	unsigned long last;
+
+	last = sdlog_last_key % TB_MS_PER_DAY;
+	if(ms < last)
+	{
+		if(last - ms > SDLOG_DAY_TOL) sdlog_day = (sdlog_day + 1) % SDLOG_DAYS;
+		else ms = last;
+	}
+	sdlog_last_key = sdlog_day*TB_MS_PER_DAY + ms;
+	return sdlog_last_key;
+}
+
+/*
+ * How long before sdlog_rp_ref a log ms is, keys wrap at SDLOG_KEY_SPAN
+ */
+static unsigned long sdlog_age(unsigned long key)
+{
+	return (sdlog_rp_ref >= key) ? sdlog_rp_ref - key : sdlog_rp_ref + (SDLOG_KEY_SPAN - key);
+}
+
+/*
+ * Card in SPI mode and idle: clocks with CS high, CMD0, CMD8
+ * Leaves CS low for the ACMD41 loop
+ */
+static unsigned char sdlog_card_start(void)
+{
+	unsigned char ii;
+
+	UCB0CTL1 |= UCSWRST;
+	UCB0BR0 = SDLOG_BR_INIT;
+	UCB0CTL1 &= ~UCSWRST;
+
+	P9OUT |= SDC_CSn;
+	for(ii = 0; ii < 10; ii++) sd_xchg(0xFF);	// >= 74 clocks
+	P9OUT &= ~SDC_CSn;
+
+	if(sd_command(SD_CMD0, 0) != SD_R1_IDLE) return FALSE;
+	if(sd_command(SD_CMD8, 0x000001AAUL) == SD_R1_IDLE)
+	{
+		for(ii = 0; ii < 4; ii++) sd_xchg(0xFF);	// R7, voltage accepted
+	}
+	return TRUE;
+}
+
+/*
+ * Card error or timeout, buffered sectors and the write head are kept
+ * for the next start, a pending read is asked again
+ */
+static void sdlog_card_fail(void)
+{
+	DMA2CTL = 0;
+	P9OUT |= SDC_CSn;
+	sdlog_cache = SDLOG_NONE;
+	if(sdlog_errors < 0xFF) sdlog_errors++;
+	sdlog_state = SDLOG_OFF;
+}
+
+/*
+ * One sector to UCB0TXBUF, triggered by UCB0TXIFG
+ * - the trigger is an edge, so TXIFG is cleared and set again to start
+ */
+static void sdlog_dma_start(unsigned char *buf)
+{
+	DMA2CTL = 0;
+	DMACTL1 = (DMACTL1 & ~DMA2TSEL_31) | DMA2TSEL_19;	// UCB0TXIFG trigger
+	__data16_write_addr((unsigned short)&DMA2SA, (unsigned long)buf);
+	__data16_write_addr((unsigned short)&DMA2DA, (unsigned long)&UCB0TXBUF);
+	DMA2SZ = SDLOG_SECTOR;
+	DMA2CTL = DMADT_0 | DMASRCINCR_3 | DMADSTINCR_0 | DMASRCBYTE | DMADSTBYTE | DMAIE | DMAEN;
+	UCB0IFG &= ~UCTXIFG;
+	UCB0IFG |= UCTXIFG;
+}
+
+/*
+ * CMD17 for sdlog_rd_want, the data token is polled in SDLOG_READ
+ */
+static void sdlog_read_start(unsigned long ticks)
+{
+	P9OUT &= ~SDC_CSn;
+	if(sd_command(SD_CMD17, sdlog_ccs ? sdlog_rd_want : sdlog_rd_want*SDLOG_SECTOR) != 0)
+	{
+		sdlog_card_fail();
+		return;
+	}
+	sdlog_tick = ticks;
+	sdlog_state = SDLOG_READ;
+}
+
+/*
+ * TRUE if the sector is in sdlog_rd, else it is asked for
+ */
+static unsigned char sdlog_have(unsigned long sector)
+{
+	if(sdlog_cache == sector) return TRUE;
+	sdlog_rd_want = sector;
+	return FALSE;
+}
+
+/*
+ * Write head after a reset, one sector per call:
+ * - both superblocks, the valid one with the higher generation wins
+ * - then the sectors written since it, while their sequence follows on,
+ *   their log ms go back into the index of the span
+ * - the log ms of the newest sector carries the day count on
+ */
+static void sdlog_mount_step(void)
+{
+	static unsigned long best_gen;
+	static unsigned char found;
+	unsigned char *p;
+	unsigned long seq;
+	int ii;
+
+	p = sdlog_rd;
+	if(sdlog_mount_n < 2)
+	{
+		if(sdlog_mount_n == 0) found = FALSE;
+		if(!sdlog_have(SDLOG_SUPER_A + sdlog_mount_n)) return;
+		if((sd_get16(&p[0]) == SDLOG_MAGIC_SUPER) &&
+		   (sd_get16(&p[SDLOG_SUPER_SIZE - 2]) == telem_out_crc((char *)p, SDLOG_SUPER_SIZE - 2, TOUT_CRC_SEED)) &&
+		   (!found || (sd_get32(&p[2]) > best_gen)))
+		{
+			found = TRUE;
+			best_gen = sd_get32(&p[2]);
+			sdlog_seq = sd_get32(&p[6]);
+			sdlog_last_key = sd_get32(&p[10]);
+		}
+		sdlog_mount_n++;
+		if(sdlog_mount_n < 2) return;
+		if(!found)
+		{
+			sdlog_seq = 0;						// new card
+			sdlog_last_key = 0;
+		}
+		sdlog_day = sdlog_last_key / TB_MS_PER_DAY;
+		sdlog_gen = found ? best_gen + 1 : 0;
+		return;
+	}
+
+	if(sdlog_mount_n < SDLOG_SCAN_MAX + 2)
+	{
+		seq = sdlog_seq;
+		if(!sdlog_have(SDLOG_POS(seq))) return;
+		if((sd_get32(&p[SDLOG_HDR_SEQ]) == seq) &&
+		   ((sd_get16(&p[SDLOG_HDR_MAGIC]) == SDLOG_MAGIC) || (sd_get16(&p[SDLOG_HDR_MAGIC]) == SDLOG_MAGIC_INDEX)))
+		{
+			if(sd_get16(&p[SDLOG_HDR_MAGIC]) == SDLOG_MAGIC)
+			{
+				sdlog_last_key = sd_get32(&p[SDLOG_HDR_MS]);
+				sdlog_day = sdlog_last_key / TB_MS_PER_DAY;
+				sd_put32(&sdlog_index[SDLOG_HEADER + (seq % SDLOG_SPAN)*4], sdlog_last_key);
+			}
+			sdlog_seq++;
+			sdlog_mount_n++;
+			return;
+		}
+	}
+
+	// Sectors buffered since the reset were keyed before the day count
+	// was known, they follow on from the newest sector on the card
+	for(ii = 0; ii < sdlog_full + (sdlog_fill_n != 0); ii++)
+	{
+		p = sdlog_buf[(sdlog_send + ii) % SDLOG_BUFS];
+		sd_put32(&p[SDLOG_HDR_MS], sdlog_key(sd_get32(&p[SDLOG_HDR_MS]) % TB_MS_PER_DAY));
+	}
+
+	sdlog_super_due = (sdlog_mount_n > 2);		// head moved, record it
+	sdlog_mounted = TRUE;
+}
+
+/*
+ * Superblock copy (generation odd/even), polled CMD24
+ */
+static void sdlog_super_write(unsigned long ticks)
+{
+	unsigned char sb[SDLOG_SUPER_SIZE];
+
+	sd_put16(&sb[0], SDLOG_MAGIC_SUPER);
+	sd_put32(&sb[2], sdlog_gen);
+	sd_put32(&sb[6], sdlog_seq);
+	sd_put32(&sb[10], sdlog_last_key);
+	sd_put16(&sb[SDLOG_SUPER_SIZE - 2], telem_out_crc((char *)sb, SDLOG_SUPER_SIZE - 2, TOUT_CRC_SEED));
+
+	P9OUT &= ~SDC_CSn;
+	if((sd_command(SD_CMD24, sdlog_ccs ? SDLOG_SUPER_A + (sdlog_gen & 1) : (SDLOG_SUPER_A + (sdlog_gen & 1))*SDLOG_SECTOR) != 0) ||
+	   ((sd_put_block(SD_TOKEN_SINGLE, sb, SDLOG_SUPER_SIZE) & 0x1F) != SD_DATA_ACCEPTED))
+	{
+		sdlog_card_fail();
+		return;
+	}
+	sdlog_tick = ticks;
+	sdlog_state = SDLOG_SUPER;
+}
+
+/*
+ * Index sector of the span into the open CMD25, FALSE on a card error
+ */
+static unsigned char sdlog_index_write(void)
+{
+	sd_put16(&sdlog_index[SDLOG_HDR_MAGIC], SDLOG_MAGIC_INDEX);
+	sd_put16(&sdlog_index[SDLOG_HDR_COUNT], SDLOG_SPAN - 1);
+	sd_put32(&sdlog_index[SDLOG_HDR_SEQ], sdlog_seq);
+	sd_put32(&sdlog_index[SDLOG_HDR_MS], sd_get32(&sdlog_index[SDLOG_HEADER]));
+	sd_put32(&sdlog_index[SDLOG_HDR_TB], 0);
+
+	sdlog_block_index = TRUE;
+	if((sd_put_block(SD_TOKEN_MULTI, sdlog_index, SDLOG_INDEX_SIZE) & 0x1F) == SD_DATA_ACCEPTED) return TRUE;
+	sdlog_card_fail();
+	return FALSE;
+}
+
+/*
+ * Replay work that needs a sector, called with no read pending
+ */
+static void sdlog_replay_step(void)
+{
+	unsigned long d, rem;
+	unsigned char *p;
+
+	switch(sdlog_rp)
+	{
+	  case SDR_REQ:
+		// Data sectors in log order: whole spans from the oldest one not
+		// overwritten, then the span being written
+		sdlog_rp_end = sdlog_seq;
+		sdlog_rp_oldest = 0;
+		if(sdlog_rp_end > SDLOG_DATA_SECTORS)
+			sdlog_rp_oldest = ((sdlog_rp_end - SDLOG_DATA_SECTORS + SDLOG_SPAN - 1) / SDLOG_SPAN) * SDLOG_SPAN;
+		d = sdlog_rp_end - sdlog_rp_oldest;
+		rem = d % SDLOG_SPAN;
+		sdlog_rp_lo = 0;
+		sdlog_rp_hi = (d / SDLOG_SPAN)*(SDLOG_SPAN - 1) + ((rem < SDLOG_SPAN - 1) ? rem : SDLOG_SPAN - 1);
+		sdlog_rp_count = 0;
+		sdlog_rp = SDR_SEEK;
+		// no break
+
+	  case SDR_SEEK:
+		sdlog_seek_step();
+		break;
+
+	  case SDR_READ:
+		if((sdlog_rp_seq % SDLOG_SPAN) == SDLOG_SPAN - 1) sdlog_rp_seq++;	// index sector
+		if(sdlog_rp_seq >= sdlog_rp_end)
+		{
+			sdlog_rp = (sdlog_rp_format == TOUT_BINARY) ? SDR_NONE : SDR_END;
+			break;
+		}
+		if(!sdlog_have(SDLOG_POS(sdlog_rp_seq))) break;
+		p = sdlog_rd;
+		if((sd_get16(&p[SDLOG_HDR_MAGIC]) != SDLOG_MAGIC) || (sd_get32(&p[SDLOG_HDR_SEQ]) != sdlog_rp_seq) ||
+		   (sdlog_age(sd_get32(&p[SDLOG_HDR_MS])) < sdlog_age(sdlog_rp_to)))
+		{
+			sdlog_rp = (sdlog_rp_format == TOUT_BINARY) ? SDR_NONE : SDR_END;
+			break;
+		}
+		sdlog_rp_rec = 0;
+		sdlog_rp = SDR_SEND;
+		break;
+
+	  default:
+		break;
+	}
+}
+
+/*
+ * Binary search for the first data sector starting after FROM, keys
+ * come from the index of whole spans and from the sector header in the
+ * span being written, sdlog_rd keeps the last index read. Keys are
+ * compared by their age, a sector that does not read back counts as the
+ * oldest.
+ */
+static void sdlog_seek_step(void)
+{
+	unsigned long mid, seq, idx, key, oldest;
+	unsigned char *p;
+
+	p = sdlog_rd;
+	oldest = (sdlog_rp_ref + 1) % SDLOG_KEY_SPAN;
+	while(sdlog_rp_lo < sdlog_rp_hi)
+	{
+		mid = sdlog_rp_lo + (sdlog_rp_hi - sdlog_rp_lo)/2;
+		seq = sdlog_d2seq(mid);
+		idx = seq - (seq % SDLOG_SPAN) + SDLOG_SPAN - 1;
+		if(idx < sdlog_rp_end)
+		{
+			if(!sdlog_have(SDLOG_POS(idx))) return;
+			key = oldest;
+			if((sd_get16(&p[SDLOG_HDR_MAGIC]) == SDLOG_MAGIC_INDEX) && (sd_get32(&p[SDLOG_HDR_SEQ]) == idx))
+				key = sd_get32(&p[SDLOG_HEADER + (seq % SDLOG_SPAN)*4]);
+		}
+		else
+		{
+			if(!sdlog_have(SDLOG_POS(seq))) return;
+			key = oldest;
+			if((sd_get16(&p[SDLOG_HDR_MAGIC]) == SDLOG_MAGIC) && (sd_get32(&p[SDLOG_HDR_SEQ]) == seq))
+				key = sd_get32(&p[SDLOG_HDR_MS]);
+		}
+		if(sdlog_age(key) >= sdlog_age(sdlog_rp_from)) sdlog_rp_lo = mid + 1;
+		else sdlog_rp_hi = mid;
+	}
+
+	sdlog_rp_seq = sdlog_d2seq((sdlog_rp_lo > 0) ? sdlog_rp_lo - 1 : 0);
+	sdlog_rp = (sdlog_rp_format == TOUT_BINARY) ? SDR_READ : SDR_START;
+}
+
+/*
+ * Sequence of the d-th data sector from the oldest whole span
+ */
+static unsigned long sdlog_d2seq(unsigned long d)
+{
+	return sdlog_rp_oldest + (d / (SDLOG_SPAN - 1))*SDLOG_SPAN + d % (SDLOG_SPAN - 1);
+}
+
+static unsigned int sdlog_next(unsigned char sink, unsigned char format, char **buf)
+{
+	if((sink != sdlog_rp_sink) || (format != sdlog_rp_format)) return 0;
+
+	*buf = (char *)sdlog_part;
+	switch(sdlog_rp)
+	{
+	  case SDR_START:
+		return sdlog_render_mark("TL_SDS,", sdlog_rp_from, sdlog_rp_to);
+
+	  case SDR_SEND:
+		if(sdlog_cache != SDLOG_POS(sdlog_rp_seq))
+		{
+			sdlog_rp = SDR_READ;		// sector written over the cache, read again
+			return 0;
+		}
+		return (format == TOUT_BINARY) ? sdlog_render_half() : sdlog_render_lines();
+
+	  case SDR_END:
+		return sdlog_render_mark("TL_SDE,", sdlog_rp_to, sdlog_rp_count);
+
+	  default:
+		return 0;
+	}
+}
+
+/*
+ * "TL_SDx,0xAAAAAAAA,0xBBBBBBBB,0x0000CCCC"
+ */
+static unsigned int sdlog_render_mark(const char *tag, unsigned long a, unsigned long b)
+{
+	char *line;
+	unsigned int n;
+
+	line = (char *)sdlog_part;
+	memcpy(line, tag, 7);
+	n = 7;
+	n += telem_out_hex32(&line[n], a);
+	line[n++] = ',';
+	n += telem_out_hex32(&line[n], b);
+	return telem_out_crc_field(line, n);
+}
+
+/*
+ * Up to SDLOG_PART_LINES records of the sector from sdlog_rp_rec, skips
+ * the records before FROM and stops at the first one after TO, each line
+ * has its own CRC field
+ */
+static unsigned int sdlog_render_lines(void)
+{
+	unsigned char *rec;
+	unsigned long ms0, tb0, ms;
+	unsigned int count, n, start;
+	char *line;
+
+	line = (char *)sdlog_part;
+	count = sd_get16(&sdlog_rd[SDLOG_HDR_COUNT]);
+	ms0 = sd_get32(&sdlog_rd[SDLOG_HDR_MS]);
+	tb0 = sd_get32(&sdlog_rd[SDLOG_HDR_TB]);
+	sdlog_rp_lines = 0;
+	sdlog_rp_past = FALSE;
+	n = 0;
+
+	while((sdlog_rp_lines < SDLOG_PART_LINES) && (sdlog_rp_rec + sdlog_rp_lines < count))
+	{
+		rec = &sdlog_rd[SDLOG_HEADER + (sdlog_rp_rec + sdlog_rp_lines)*SDLOG_RECORD];
+		ms = ms0 + (sd_get32(&rec[0]) - tb0) / (TB_COUNT_RATE/1000);
+		if(ms >= SDLOG_KEY_SPAN) ms -= SDLOG_KEY_SPAN;
+		if(sdlog_age(ms) < sdlog_age(sdlog_rp_to))
+		{
+			sdlog_rp_past = TRUE;
+			break;
+		}
+		if((sdlog_age(ms) > sdlog_age(sdlog_rp_from)) && (sdlog_rp_lines == 0))
+		{
+			sdlog_rp_rec++;				// not rendered yet, dropped from the part
+			continue;
+		}
+		start = n;
+		memcpy(&line[n], "TL_SDR,", 7);
+		n += 7;
+		n += telem_out_hex32(&line[n], ms);
+		line[n++] = ',';
+		n += telem_out_hex32(&line[n], ((unsigned long)sd_get16(&rec[4]) << 16) | sd_get16(&rec[6]));
+		line[n++] = ',';
+		n += telem_out_hex_data(&line[n], &rec[8]);
+		n = start + telem_out_crc_field(&line[start], n - start);
+		sdlog_rp_lines++;
+	}
+
+	if(n != 0) return n;
+	if(!sdlog_rp_past)
+	{
+		sdlog_rp_seq++;					// whole sector before FROM
+		sdlog_rp = SDR_READ;
+		return 0;
+	}
+	sdlog_rp = SDR_END;
+	return sdlog_render_mark("TL_SDE,", sdlog_rp_to, sdlog_rp_count);
+}
+
+/*
+ * A5 5A type seq 05 01 | sequence (4) | half (1) | 256 sector bytes | crc
+ */
+static unsigned int sdlog_render_half(void)
+{
+	unsigned char *p;
+	unsigned int ii;
+
+	p = sdlog_part;
+	sd_put32(&p[TOUT_BIN_HEADER], sdlog_rp_seq);
+	p[TOUT_BIN_HEADER + 4] = (unsigned char)sdlog_rp_rec;
+	for(ii = 0; ii < SDLOG_HALF; ii++) p[TOUT_BIN_HEADER + 5 + ii] = sdlog_rd[sdlog_rp_rec*SDLOG_HALF + ii];
+	return telem_out_bin_frame((char *)sdlog_part, TOUT_TYPE_SDLOG, sdlog_rp_bseq, 5 + SDLOG_HALF);
+}
+
+/*
+ * Command frame and R1, CS is already low
+ * - CRC is only checked for CMD0 and CMD8 in SPI mode
+ */
+static unsigned char sd_command(unsigned char cmd, unsigned long arg)
+{
+	unsigned char r, ii;
+
+	sd_xchg(0xFF);
+	sd_xchg(0x40 | cmd);
+	sd_xchg((unsigned char)(arg >> 24));
+	sd_xchg((unsigned char)(arg >> 16));
+	sd_xchg((unsigned char)(arg >> 8));
+	sd_xchg((unsigned char)arg);
+	sd_xchg((cmd == SD_CMD0) ? 0x95 : ((cmd == SD_CMD8) ? 0x87 : 0x01));
+
+	r = 0xFF;
+	for(ii = 0; (ii < 8) && (r & 0x80); ii++) r = sd_xchg(0xFF);
+	return r;
+}
+
+/*
+ * Polled data block: token, len bytes, 0xFF up to the sector size, CRC
+ * OUT: data response
+ */
+static unsigned char sd_put_block(unsigned char token, unsigned char *buf, unsigned int len)
+{
+	unsigned int ii;
+
+	sd_xchg(0xFF);
+	sd_xchg(token);
+	for(ii = 0; ii < SDLOG_SECTOR; ii++) sd_xchg((ii < len) ? buf[ii] : 0xFF);
+	sd_xchg(0xFF);
+	sd_xchg(0xFF);
+	return sd_xchg(0xFF);
+}
+
+/*
+ * Exchanges one byte on UCB0
+ *	- Busy waits until the shift is complete
+ */
+static unsigned char sd_xchg(unsigned char data)
+{
+	UCB0TXBUF = data;
+	while((UCB0IFG & UCRXIFG) == 0x00);
+	return UCB0RXBUF;
+}
+
+static void sd_put16(unsigned char *p, unsigned int value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+}
+
+static void sd_put32(unsigned char *p, unsigned long value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+	p[2] = (unsigned char)(value >> 16);
+	p[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned int sd_get16(unsigned char *p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static unsigned long sd_get32(unsigned char *p)
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
@@ -0,0 +1,178 @@
+/*
+ * sdlog.h
+ *
+ *  Black box log of every received CAN frame on the SD card
+ *
+ *  - decode() hands over every CAN0 frame taken from the receive queue,
+ *    the main loop every CAN1 reply, each becomes one SDLOG_RECORD
+ *  - Records fill 512 byte sectors in SDLOG_BUFS RAM buffers, a full
+ *    buffer is written while the next one fills, frames arriving with
+ *    all buffers full are counted and the gap is kept in the next record
+ *  - Sectors go out as one open multiple block write (CMD25) into the
+ *    region SDLOG_FIRST .. SDLOG_FIRST + SDLOG_SECTORS - 1 reserved on
+ *    the card, no file system, the head wraps at the end of the region
+ *  - The 512 data bytes of a block are moved to UCB0 by DMA2, the card
+ *    busy time is polled one byte per main loop pass, so neither holds
+ *    off CAN reception
+ *  - A sector still filling after SDLOG_FLUSH_TICKS is closed as it is
+ *  - "sdlog 0" closes the write and stops, "sdlog 1" starts again
+ *  - tools/sdsim.c runs this file against a simulated card at full bus
+ *    load, with the card's busy times and stalls
+ *
+ *  Card: SPI mode on UCB0 (P3.1-P3.3), SDC_CSn on P9.6, SDC_CDn low =
+ *  card inserted and SDC_WPn low = write protected on P4.
+ *
+ *  Region layout:
+ *  - SDLOG_SUPER_A, SDLOG_SUPER_B: superblock copies, written in turn
+ *    after every index sector, the one with the higher generation holds
+ *    the sequence of the next sector to write
+ *  - SDLOG_DATA onwards: spans of SDLOG_SPAN sectors, SDLOG_SPAN - 1 data
+ *    sectors and an index sector with the log ms of each of them.
+ *    Sector sequence n is always at SDLOG_DATA + n % SDLOG_DATA_SECTORS.
+ *  - After a reset the write head is the superblock sequence, moved on
+ *    over the sectors written since (at most SDLOG_SCAN_MAX reads)
+ *
+ *  Log ms: day * TB_MS_PER_DAY + ms of day at the first record of a
+ *  sector, the day counts from 0 when the log began and steps when the
+ *  ms of day goes back by more than SDLOG_DAY_TOL (midnight, switched
+ *  off over night). It never goes back, so it keys the search across
+ *  midnight. It wraps to 0 after SDLOG_DAYS days, ages are taken modulo
+ *  SDLOG_KEY_SPAN, so a replay reaches back SDLOG_DAYS - 1 days.
+ *
+ *  Sector: magic (2) | records (2) | sequence (4) | log ms (4) |
+ *          tb_now() (4) at the first record | records...
+ *  Record: tb_now() (4) | id (2) | gap (2) | data (8), all LSB first
+ *          id = CAN address | SDLOG_ID_CAN1 | SDLOG_ID_RTR
+ *          gap = frames dropped just before this one, saturating
+ *  Index:  header with SDLOG_MAGIC_INDEX, records = SDLOG_SPAN - 1, the
+ *          log ms of the first sector | log ms (4) of each data sector
+ *  Super:  magic (2) | generation (4) | next sequence (4) | log ms of
+ *          the newest sector (4) | CRC-16 (2)
+ *
+ *  Replay, "sdget FROM TO" (log ms, FROM = 0 from the oldest sector,
+ *  TO = 0 for the end):
+ *  - binary search over the spans by their index sectors, then within
+ *    a span from its index, O(log n) sector reads, the span still being
+ *    written is searched by its sector headers
+ *  - the records from the last sector starting at or before FROM are
+ *    sent to the asking port as a background source, until TO
+ *  - ASCII: "TL_SDS,0xAAAAAAAA,0xBBBBBBBB" start (A = FROM, B = TO as
+ *    used, TO = 0 shows the newest sector + SDLOG_DAY_TOL), records
+ *    "TL_SDR,0xMMMMMMMM,0xIIIIGGGG,0xHHHHHHHH,0xHHHHHHHH" (M = log ms,
+ *    I = id, G = gap), "TL_SDE,0xBBBBBBBB,0xNNNNNNNN" end (TO, records
+ *    sent), each line ends in its CRC field ",0x0000CCCC"
+ *  - Binary: TOUT_TYPE_SDLOG frames, payload = sequence (4) + half (1) +
+ *    256 bytes, two frames per raw sector
+ */
+
+#ifndef SDLOG_H_
+#define SDLOG_H_
+
+#define SDLOG_DEFAULT		TRUE
+#define SDLOG_FIRST			0x00000800UL		// first sector of the region, 1 MiB into the card
+#define SDLOG_SECTORS		0x00100000UL		// 512 MiB region, multiple of SDLOG_SPAN
+#define SDLOG_SECTOR		512
+#ifndef SDLOG_BUFS										// tools/sdsim.c measures other values
+#define SDLOG_BUFS			2					// sector buffers, one written while one fills
+#endif
+#define SDLOG_HEADER		16
+#define SDLOG_RECORD		16
+#define SDLOG_RECORDS		((SDLOG_SECTOR - SDLOG_HEADER)/SDLOG_RECORD)
+#define SDLOG_FLUSH_TICKS	TICK_RATE			// longest time a record waits in RAM
+#define SDLOG_INIT_TICKS	TICK_RATE			// card power up (ACMD41) timeout
+#define SDLOG_BUSY_TICKS	(TICK_RATE/2)		// block programming timeout
+#define SDLOG_READ_TICKS	(TICK_RATE/4)		// data token timeout
+#define SDLOG_RETRY_TICKS	(TICK_RATE*2)		// between card starts after a failure
+#define SDLOG_POLLS			32					// data token polls per pass
+
+// Region layout
+#define SDLOG_SPAN			32					// sectors per index span, the last one is the index
+#define SDLOG_SUPER_A		SDLOG_FIRST
+#define SDLOG_SUPER_B		(SDLOG_FIRST + 1)
+#define SDLOG_DATA			(SDLOG_FIRST + SDLOG_SPAN)	// rest of the first span unused
+#define SDLOG_DATA_SECTORS	(SDLOG_SECTORS - SDLOG_SPAN)
+#define SDLOG_SCAN_MAX		(SDLOG_SPAN*2)		// sector reads to find the head after a reset
+#define SDLOG_SUPER_SIZE	16
+#define SDLOG_INDEX_SIZE	(SDLOG_HEADER + (SDLOG_SPAN - 1)*4)
+#define SDLOG_NONE			0xFFFFFFFF
+
+// Log ms
+#define SDLOG_DAYS			49					// log days before the key wraps, fits 32 bits
+#define SDLOG_KEY_SPAN		(SDLOG_DAYS*TB_MS_PER_DAY)
+#define SDLOG_DAY_TOL		60000UL				// ms of day going back by less is a resync
+
+#define SDLOG_MAGIC			0x4C53				// "SL", data sector
+#define SDLOG_MAGIC_INDEX	0x5853				// "SX"
+#define SDLOG_MAGIC_SUPER	0x4253				// "SB"
+
+// Sector header
+#define SDLOG_HDR_MAGIC		0
+#define SDLOG_HDR_COUNT		2
+#define SDLOG_HDR_SEQ		4
+#define SDLOG_HDR_MS		8
+#define SDLOG_HDR_TB		12
+
+#define SDLOG_ID_CAN1		0x8000				// frame from CAN1 (MPPT bus)
+#define SDLOG_ID_RTR		0x4000				// remote frame, data not valid
+
+#define SDLOG_BR_INIT		25					// SMCLK/25 = 400 kHz during card init
+#define SDLOG_BR_FAST		1					// SMCLK = 10 MHz once initialised
+
+// Replay
+#define SDLOG_LINE_SIZE		(52 + TOUT_CRC_FIELD)	// "TL_SDR,...,0x0000CCCC\r\n"
+#define SDLOG_PART_LINES	4					// ASCII records per background part
+#define SDLOG_HALF			(SDLOG_SECTOR/2)
+#define SDLOG_PART_SIZE		(TOUT_BIN_HEADER + 5 + SDLOG_HALF + TOUT_BIN_TRAILER)	// >= SDLOG_PART_LINES*SDLOG_LINE_SIZE
+
+// States
+#define SDLOG_OFF			0		// stopped, no card or write protected
+#define SDLOG_INIT			1		// ACMD41 until the card is ready
+#define SDLOG_READY			2		// no write open: mount, superblock, reads
+#define SDLOG_OPEN			3		// CMD25 open, waiting for a full sector
+#define SDLOG_DMA			4		// data block going out
+#define SDLOG_BUSY			5		// card programming a block
+#define SDLOG_STOP			6		// stop token sent, card busy
+#define SDLOG_SUPER			7		// card programming the superblock
+#define SDLOG_READ			8		// CMD17 sent, waiting for the data token
+
+// Replay states
+#define SDR_NONE			0
+#define SDR_REQ				1		// asked, search not started
+#define SDR_SEEK			2		// binary search
+#define SDR_START			3		// start line pending (ASCII)
+#define SDR_READ			4		// next sector to read
+#define SDR_SEND			5		// sector in RAM, parts going out
+#define SDR_END				6		// end line pending (ASCII)
+
+// SD commands, SPI mode
+#define SD_CMD0				0		// GO_IDLE_STATE
+#define SD_CMD8				8		// SEND_IF_COND
+#define SD_CMD12			12		// STOP_TRANSMISSION
+#define SD_CMD17			17		// READ_SINGLE_BLOCK
+#define SD_CMD24			24		// WRITE_BLOCK
+#define SD_CMD25			25		// WRITE_MULTIPLE_BLOCK
+#define SD_CMD55			55		// APP_CMD
+#define SD_CMD58			58		// READ_OCR
+#define SD_ACMD41			41		// SD_SEND_OP_COND
+#define SD_R1_IDLE			0x01
+#define SD_TOKEN_SINGLE		0xFE	// data token of CMD17 and CMD24
+#define SD_TOKEN_MULTI		0xFC	// data token of CMD25
+#define SD_TOKEN_STOP		0xFD	// end of CMD25
+#define SD_DATA_ACCEPTED	0x05	// data response & 0x1F
+#define SD_OCR_CCS			0x40	// first OCR byte, block addressed card
+
+// Public functions
+void sdlog_init(void);
+void sdlog_frame(unsigned int id, can_struct *msg);
+void sdlog_service(void);
+unsigned int sdlog_next_modem(unsigned char format, char **buf);
+unsigned int sdlog_next_usb(unsigned char format, char **buf);
+void sdlog_sent(void);
+
+// Status
+extern unsigned char sdlog_state;
+extern unsigned long sdlog_sectors;		// sectors written since start
+extern unsigned int sdlog_dropped;		// frames lost to full buffers, saturating
+extern unsigned char sdlog_errors;		// card failures, saturating
+
+#endif /* SDLOG_H_ */
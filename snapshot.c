@@ -0,0 +1,112 @@
+/*
+ * snapshot.c
+ *
+ *  Sequence counted snapshot of board signals written from interrupts
+ *
+ *  The count and fields are volatile so the compiler keeps the order of
+ *  the stores and loads around the count, the MSP430 itself does not
+ *  reorder memory accesses. A 16 bit increment is one instruction, and
+ *  so is each field copy (MOV.B memory to memory), the SNAP_POINT()s
+ *  between them are all the places an interrupt can land.
+ */
+
+#include "Sunseeker2021.h"
+
+// Private variables
+static volatile unsigned int snap_seq = 0;		// odd while a write is in progress
+static volatile snap_state snap_live;
+
+/*************************************************************
+/ Name: snap_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Clears the snapshot, before interrupts are enabled
+************************************************************/
+void snap_init(void)
+{
+	snap_seq = 0;
+	snap_live.hrs = 0;
+	snap_live.min = 0;
+	snap_live.sec = 0;
+}
+
+/*************************************************************
+/ Name: snap_read
+/ IN: copy to fill
+/ OUT:  void
+/ DESC:  Consistent copy of all fields, retried when a writer
+/        ran in between. Main loop only.
+************************************************************/
+void snap_read(snap_state *out)
+{
+	unsigned int seq;
+
+	do
+	{
+		seq = snap_seq;
+		SNAP_POINT();
+		out->hrs = snap_live.hrs;
+		SNAP_POINT();
+		out->min = snap_live.min;
+		SNAP_POINT();
+		out->sec = snap_live.sec;
+		SNAP_POINT();
+	} while((seq & 1) || (seq != snap_seq));
+}
+
+/*************************************************************
+/ Name: snap_time_set
+/ IN: BCD hours, minutes, seconds
+/ OUT:  void
+/ DESC:  Main loop writer of the wall-clock
+************************************************************/
+void snap_time_set(unsigned char hrs, unsigned char min, unsigned char sec)
+{
+	snap_seq++;
+	SNAP_POINT();
+	snap_live.hrs = hrs;
+	SNAP_POINT();
+	snap_live.min = min;
+	SNAP_POINT();
+	snap_live.sec = sec;
+	SNAP_POINT();
+	snap_seq++;
+}
+
+/*************************************************************
+/ Name: snap_time_tick
+/ IN: void
+/ OUT:  void
+/ DESC:  Advances the BCD wall-clock by one second, called by
+/        the RTC_MFP edge ISR
+************************************************************/
+void snap_time_tick(void)
+{
+	unsigned char sec, min, hrs;
+
+	snap_seq++;
+	sec = snap_live.sec;
+	min = snap_live.min;
+	hrs = snap_live.hrs;
+
+	sec++;
+	if((sec & 0x0F) > 9) sec += 6;
+	if(sec >= 0x60)
+	{
+		sec = 0;
+		min++;
+		if((min & 0x0F) > 9) min += 6;
+		if(min >= 0x60)
+		{
+			min = 0;
+			hrs++;
+			if((hrs & 0x0F) > 9) hrs += 6;
+			if(hrs >= 0x24) hrs = 0;
+		}
+	}
+
+	snap_live.sec = sec;
+	snap_live.min = min;
+	snap_live.hrs = hrs;
+	snap_seq++;
+}
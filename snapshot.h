@@ -0,0 +1,43 @@
+/*
+ * snapshot.h
+ *
+ *  Sequence counted snapshot of board signals written from interrupts
+ *
+ *  - Writers bump snap_seq to odd, store the fields and bump it back to
+ *    even, they never wait on a reader
+ *  - Readers copy the fields and retry while the count was odd or moved,
+ *    so a multi-byte view is consistent without disabling interrupts
+ *  - Readers run in the main loop only. An ISR writer may preempt a main
+ *    loop writer (the count nests and still ends even), the main loop
+ *    writer has to detect that itself, tb_service() compares the MFP
+ *    edge count around the MCP7940 read
+ *  - SNAP_POINT() marks the places between the shared accesses where an
+ *    ISR can come in, empty on the target, tools/seqlock.c runs the
+ *    writer ISR at each of them on the host
+ *
+ *  Fields:
+ *  - hrs, min, sec: MCP7940 format (BCD) wall-clock, set from an I2C read
+ *    in the main loop and advanced by the RTC_MFP edge ISR
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#ifndef SNAP_POINT
+#define SNAP_POINT()
+#endif
+
+typedef struct _snap_state
+{
+  unsigned char hrs;				// BCD 00-23
+  unsigned char min;				// BCD 00-59
+  unsigned char sec;				// BCD 00-59
+} snap_state;
+
+// Public functions
+void snap_init(void);
+void snap_read(snap_state *out);
+void snap_time_set(unsigned char hrs, unsigned char min, unsigned char sec);
+void snap_time_tick(void);
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,201 @@
+/*
+ * stream.c
+ *
+ *  Low latency streaming of changed rows on the modem
+ *
+ *  Row data is read from tout_rows when the record is rendered, only the
+ *  time of the change is kept here. Tokens are in 1/256 bytes so the
+ *  refill of a long modem period does not round to nothing.
+ */
+
+#include "Sunseeker2021.h"
+
+// Private variables
+static unsigned char stream_on = STREAM_DEFAULT;
+static unsigned char stream_pending[LOOKUP_ROWS];
+static unsigned char stream_again[LOOKUP_ROWS];	// changed while being sent
+static unsigned long stream_ms[LOOKUP_ROWS];	// ms of day of the change
+static unsigned long stream_tick[LOOKUP_ROWS];	// last sent
+static unsigned char stream_cur = STREAM_NONE;	// row of the record being sent
+static unsigned int stream_len;
+static unsigned long stream_tokens;				// 1/256 bytes
+static unsigned long stream_last;				// tick of the last refill
+static char stream_buf[STREAM_LINE_SIZE];
+static unsigned char stream_seq = 0;
+
+// Private functions
+static void stream_cmd(unsigned char port, char *args);
+static void stream_refill(unsigned long ticks);
+static unsigned char stream_pick(unsigned long ticks);
+static unsigned int stream_render(unsigned char format, unsigned char row);
+
+/*************************************************************
+/ Name: stream_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Clears the pending rows and adds the "stream" command
+/        (after cmd_init and telem_out_init)
+************************************************************/
+void stream_init(void)
+{
+	int row;
+
+	for(row = 0; row < LOOKUP_ROWS; row++)
+	{
+		stream_pending[row] = FALSE;
+		stream_again[row] = FALSE;
+		stream_tick[row] = 0;
+	}
+	stream_cur = STREAM_NONE;
+	stream_tokens = (unsigned long)STREAM_BURST << 8;
+	stream_last = tb_get_ticks();
+	tout_sinks[TOUT_SINK_MODEM].stream = stream_on;
+
+	cmd_register("stream", stream_cmd);
+}
+
+/*************************************************************
+/ Name: stream_row
+/ IN: lookup row
+/ OUT:  void
+/ DESC:  Called by telem_out_row() when a row's payload changed
+************************************************************/
+void stream_row(int row)
+{
+	if(!stream_on) return;
+
+	stream_ms[row] = tb_get_ms();
+	stream_pending[row] = TRUE;
+	if(row == stream_cur) stream_again[row] = TRUE;
+}
+
+/*************************************************************
+/ Name: stream_next
+/ IN: sink format, pointer to the record
+/ OUT:  record length, 0 if nothing is due or no tokens left
+/ DESC:  Stream source of the modem sink, the same record is
+/        returned until stream_sent()
+************************************************************/
+unsigned int stream_next(unsigned char format, char **buf)
+{
+	unsigned long ticks;
+
+	if(!stream_on) return 0;
+
+	ticks = tb_get_ticks();
+	stream_refill(ticks);
+
+	*buf = stream_buf;
+	if(stream_cur == STREAM_NONE)
+	{
+		stream_cur = stream_pick(ticks);
+		if(stream_cur == STREAM_NONE) return 0;
+	}
+
+	stream_len = stream_render(format, stream_cur);
+	if(((unsigned long)stream_len << 8) > stream_tokens) return 0;	// wait for the bucket
+	return stream_len;
+}
+
+/*
+ * Last record from stream_next() is out
+ */
+void stream_sent(void)
+{
+	if(stream_cur == STREAM_NONE) return;
+
+	stream_tokens -= (unsigned long)stream_len << 8;
+	stream_tick[stream_cur] = tb_get_ticks();
+	if(stream_again[stream_cur]) stream_again[stream_cur] = FALSE;
+	else stream_pending[stream_cur] = FALSE;
+	stream_cur = STREAM_NONE;
+	stream_seq++;
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+/*
+ * "stream 1" / "stream 0", periodic modem frames stop or resume
+ */
+static void stream_cmd(unsigned char port, char *args)
+{
+	int row;
+
+	stream_on = (strtoul(args, 0, 0) != 0);
+	tout_sinks[TOUT_SINK_MODEM].stream = stream_on;
+	if(!stream_on) return;
+
+	// Start with every row, the ground gets a full picture first
+	for(row = 0; row < LOOKUP_ROWS; row++)
+	{
+		stream_pending[row] = tout_rows[row].valid;
+		stream_ms[row] = tb_get_ms();
+	}
+}
+
+/*
+ * Bytes of one periodic frame per modem period, up to STREAM_BURST
+ */
+static void stream_refill(unsigned long ticks)
+{
+	unsigned int divider;
+
+	divider = tout_sinks[TOUT_SINK_MODEM].divider;
+	if(divider == 0) divider = TOUT_MODEM_DIV;
+
+	stream_tokens += (ticks - stream_last) * (((unsigned long)STREAM_FRAME_BYTES << 8) / divider);
+	stream_last = ticks;
+	if(stream_tokens > ((unsigned long)STREAM_BURST << 8)) stream_tokens = (unsigned long)STREAM_BURST << 8;
+}
+
+/*
+ * Pending row of the highest priority, rows due for a refresh become pending
+ */
+static unsigned char stream_pick(unsigned long ticks)
+{
+	unsigned char best;
+	int row;
+
+	best = STREAM_NONE;
+	for(row = 0; row < LOOKUP_ROWS; row++)
+	{
+		if(!tout_rows[row].valid) continue;
+		if(!stream_pending[row] && ((ticks - stream_tick[row]) >= STREAM_REFRESH))
+		{
+			stream_pending[row] = TRUE;
+			stream_ms[row] = tb_get_ms();
+		}
+		if(!stream_pending[row]) continue;
+		if((best == STREAM_NONE) || (addr_lookup[row][4] < addr_lookup[best][4])) best = (unsigned char)row;
+	}
+	return best;
+}
+
+/*
+ * One record of a row, in the sink's format
+ */
+static unsigned int stream_render(unsigned char format, unsigned char row)
+{
+	unsigned char *p;
+	unsigned long ms;
+	unsigned int n;
+	int ii;
+
+	ms = stream_ms[row];
+	if(format == TOUT_ASCII)
+	{
+		n = telem_out_line(stream_buf, row, tout_rows[row].data) - 2;	// without CR LF
+		stream_buf[n++] = ',';
+		n += telem_out_hex32(&stream_buf[n], ms);
+		return telem_out_crc_field(stream_buf, n);
+	}
+
+	p = (unsigned char *)stream_buf;
+	n = TOUT_BIN_HEADER;
+	for(ii = 0; ii < 32; ii += 8) p[n++] = (unsigned char)(ms >> ii);
+	p[n++] = row;
+	for(ii = 0; ii < 8; ii++) p[n++] = tout_rows[row].data[ii];
+	return telem_out_bin_frame(stream_buf, TOUT_TYPE_STREAM, stream_seq, n - TOUT_BIN_HEADER);
+}
@@ -0,0 +1,40 @@
+/*
+ * stream.h
+ *
+ *  Low latency streaming of changed rows on the modem
+ *
+ *  - With "stream 1" the modem sink sends no periodic frames, every row
+ *    whose CAN payload changed becomes a standalone record, sent as soon
+ *    as the sink is free (after alarms and query replies, ahead of the
+ *    background sources)
+ *  - Pending rows go out by "Filter Priority", a row that changes again
+ *    before it is sent is sent once with its latest value
+ *  - A token bucket refilled at the bytes of one periodic frame per
+ *    modem period keeps the average bandwidth of the frames it replaces,
+ *    with up to STREAM_BURST bytes after a quiet time
+ *  - Rows not sent for STREAM_REFRESH ticks are sent again unchanged
+ *  - Periodic frames, and so history and ARQ, stop while streaming
+ *
+ *  ASCII: "XXXXXX,0xHHHHHHHH,0xHHHHHHHH,0xTTTTTTTT,0x0000KKKK"  T = ms of day
+ *  of the change, K = CRC of the record (telem_out_crc_field)
+ *  Binary: TOUT_TYPE_STREAM, payload = ms of day (4) + row (1) + data (8)
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#define STREAM_DEFAULT		FALSE
+#define STREAM_LINE_SIZE	(41 + TOUT_CRC_FIELD)
+#define STREAM_BIN_SIZE		(TOUT_BIN_HEADER + 13 + TOUT_BIN_TRAILER)
+#define STREAM_FRAME_BYTES	BUDGET_MODEM_FRAME		// periodic frame replaced
+#define STREAM_BURST		STREAM_FRAME_BYTES		// bucket size
+#define STREAM_REFRESH		(TOUT_MODEM_DIV*2)		// ticks
+#define STREAM_NONE			0xFF
+
+// Public functions
+void stream_init(void);
+void stream_row(int row);
+unsigned int stream_next(unsigned char format, char **buf);
+void stream_sent(void);
+
+#endif /* STREAM_H_ */
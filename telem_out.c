@@ -0,0 +1,949 @@
+/*
+ * telem_out.c
+ *
+ *  Telemetry output layer - one rendered frame shared by several sinks
+ *
+ *  A frame is rendered at most once per tick and format, into a frame
+ *  buffer no sink is reading. Sinks due on the same tick share it, each
+ *  with its own cursor, so the modem at 1 frame per TELEM_STATUS_COUNT
+ *  and USB at 8 Hz never render twice. Sending is non-blocking through
+ *  the sink write function (DMA) and its completion event.
+ *
+ *  decode() only keeps the 8 raw bytes of each row in tout_rows, the
+ *  ASCII lines (name, hex, CRLF) are made from them and the flash
+ *  templates when a frame is rendered, so the CAN path does no formatting.
+ *
+ *  Data set queries render a reply frame with only the rows of the set,
+ *  in the same ASCII packet framing or binary layout as the sink's
+ *  periodic frames. The reply takes the sink's next free slot.
+ *
+ *  ASCII frames are handed over one line at a time. Between two lines
+ *  (binary: between frames) queued alarm records go first, so an alarm
+ *  waits at most one line instead of a whole packet.
+ *
+ *  Background sources (capture dump, backfill) only get the sink when it
+ *  has no frame, record or query to send, at most TOUT_BG_PER_TICK times
+ *  per tick, and take turns so one long dump does not hold off the other.
+ *
+ *  Modem writes go through a packer: whole records are collected up to
+ *  the RF packet size and handed to the UART in one burst, when the next
+ *  record does not fit, when the sink pauses or when an alarm is packed.
+ *  The radio then sends full RF packets instead of splitting a frame at
+ *  its packetization threshold and waiting out the timeout for the rest.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+tout_row tout_rows[LOOKUP_ROWS];
+tout_sink tout_sinks[TOUT_SINKS];
+
+// Private variables
+static tout_frame tout_frames[TOUT_FRAMES];
+static unsigned char tout_seq = 0;
+static unsigned char tout_sending[TOUT_SINKS];	// TOUT_SEND_xxx
+
+// Modem packer
+static char tout_pack_buf[TOUT_PACK_SIZE];		// records of the next RF packet
+static unsigned int tout_pack_len = 0;
+static char tout_air_buf[TOUT_AIR_SIZE];		// burst being sent, FEC encoded or a copy
+static char tout_pack_done = FALSE;				// completion event of the modem sink
+static unsigned char tout_pack_wait = TOUT_PACK_NONE;
+static unsigned char tout_pack_full = FALSE;	// last record did not fit
+static unsigned long tout_rf_payload = 0;		// record bytes since the last report
+static unsigned long tout_rf_air = 0;			// air bytes, with RF packet overhead
+static unsigned int tout_rf_packets = 0;
+static unsigned long tout_air_start;			// tb_now() when the burst started
+static unsigned long tout_air_busy = 0;			// UART busy with bursts since the last call
+static signed char tout_hf_row[HF_MSG_PACKET];	// lookup row of each HF offset, -1 = none
+
+// ASCII packet templates, in flash
+static const char tout_pre_msg[] = "ABCDEF\r\n";
+static const char tout_init_msg[] = "XXXXXX,0xHHHHHHHH,0xHHHHHHHH\r\n";	// row not received yet
+static const char tout_time_msg[] = "TL_TIM,HH:MM:SS\r\n";
+static const char tout_post_msg[] = "UVWXYZ\r\n";
+static const char tout_hex_digits[] = "0123456789ABCDEF";
+
+#define TOUT_SEND_IDLE		0
+#define TOUT_SEND_FRAME		1
+#define TOUT_SEND_ALARM		2
+#define TOUT_SEND_BG		3
+#define TOUT_SEND_STREAM	4
+
+// Data sets by CAN address, 0 terminated
+static const unsigned int tout_set_var1[] = {
+  MC_CAN_BASE1 + MC_TEMP1, MC_CAN_BASE1 + MC_TEMP2, BP_CAN_BASE + BP_TMAX,
+  AC_CAN_BASE + AC_TMAX, AC_CAN_BASE + AC_TVAL1, AC_CAN_BASE + AC_TVAL2, 0};
+static const unsigned int tout_set_var2[] = {
+  MC_CAN_BASE1 + MC_RAIL1, MC_CAN_BASE1 + MC_RAIL2, BP_CAN_BASE + BP_VMAX,
+  BP_CAN_BASE + BP_VMIN, BP_CAN_BASE + BP_ISH, AC_CAN_BASE + AC_ISH, 0};
+static const unsigned int *tout_sets[TOUT_SETS] = {tout_set_var1, tout_set_var2};
+
+// Private functions
+static void tout_sink_run(tout_sink *sink, unsigned char *sending, unsigned long ticks, unsigned char new_tick);
+static tout_frame *tout_get_frame(unsigned char format, unsigned long ticks, unsigned char density);
+static tout_frame *tout_get_query(unsigned char format, unsigned char set);
+static void tout_render_ascii(tout_frame *frame, unsigned char density);
+static void tout_render_query(tout_frame *frame, unsigned char set);
+static unsigned int tout_render_pre(tout_frame *frame);
+static unsigned int tout_render_time(tout_frame *frame, unsigned int n);
+static unsigned int tout_render_crc(tout_frame *frame, unsigned int n);
+static void tout_render_sched(tout_frame *frame);
+static void tout_render_binary(tout_frame *frame, unsigned char type, const unsigned int *set, unsigned char density);
+static unsigned int tout_put_row(unsigned char *p, unsigned int n, int row);
+static unsigned int tout_render_alarm(tout_sink *sink);
+static unsigned int tout_chunk(tout_sink *sink);
+static unsigned int tout_modem_write(char *buf, unsigned int len);
+static unsigned int tout_usb_write(char *buf, unsigned int len);
+static int tout_modem_ready(void);
+static void tout_pack_service(void);
+static void tout_pack_flush(void);
+
+/*************************************************************
+/ Name: telem_out_init
+/ IN: void
+/ OUT:  void
+/ DESC:  Clears the row cache and sets up the modem and USB sinks
+************************************************************/
+void telem_out_init(void)
+{
+	extern char end_USB_TX;
+	int ii;
+
+	for(ii = 0; ii < LOOKUP_ROWS; ii++) tout_rows[ii].valid = FALSE;
+	for(ii = 0; ii < HF_MSG_PACKET; ii++) tout_hf_row[ii] = -1;
+	for(ii = 0; ii < LOOKUP_ROWS; ii++)
+		if(addr_lookup[ii][3] == 0) tout_hf_row[addr_lookup[ii][1]] = ii;
+	for(ii = 0; ii < TOUT_FRAMES; ii++)
+	{
+		tout_frames[ii].len = 0;
+		tout_frames[ii].readers = 0;
+		tout_frames[ii].tick = 0xFFFFFFFF;
+	}
+
+	tout_sinks[TOUT_SINK_MODEM].format = TOUT_ASCII;
+	tout_sinks[TOUT_SINK_MODEM].divider = TOUT_MODEM_DIV;
+	tout_sinks[TOUT_SINK_MODEM].write = tout_modem_write;
+	tout_sinks[TOUT_SINK_MODEM].done = &tout_pack_done;
+	tout_sinks[TOUT_SINK_MODEM].ready = tout_modem_ready;
+	tout_sinks[TOUT_SINK_MODEM].bg_next[0] = history_next;
+	tout_sinks[TOUT_SINK_MODEM].bg_done[0] = history_sent;
+	tout_sinks[TOUT_SINK_MODEM].bg_next[1] = capture_next;
+	tout_sinks[TOUT_SINK_MODEM].bg_done[1] = capture_sent;
+	tout_sinks[TOUT_SINK_MODEM].bg_next[2] = sdlog_next_modem;
+	tout_sinks[TOUT_SINK_MODEM].bg_done[2] = sdlog_sent;
+	tout_sinks[TOUT_SINK_MODEM].tag = history_tag;
+	tout_sinks[TOUT_SINK_MODEM].stream_next = stream_next;
+	tout_sinks[TOUT_SINK_MODEM].stream_done = stream_sent;
+
+	tout_sinks[TOUT_SINK_USB].format = TOUT_ASCII;
+	tout_sinks[TOUT_SINK_USB].divider = TOUT_USB_DIV;
+	tout_sinks[TOUT_SINK_USB].write = tout_usb_write;
+	tout_sinks[TOUT_SINK_USB].done = &end_USB_TX;
+	tout_sinks[TOUT_SINK_USB].ready = 0;
+	tout_sinks[TOUT_SINK_USB].bg_next[0] = sdlog_next_usb;
+	tout_sinks[TOUT_SINK_USB].bg_done[0] = sdlog_sent;
+	tout_sinks[TOUT_SINK_USB].bg_next[1] = 0;
+	tout_sinks[TOUT_SINK_USB].bg_next[2] = 0;
+	tout_sinks[TOUT_SINK_USB].tag = 0;
+	tout_sinks[TOUT_SINK_USB].stream_next = 0;
+
+	for(ii = 0; ii < TOUT_SINKS; ii++)
+	{
+		tout_sinks[ii].count = tout_sinks[ii].divider;
+		tout_sinks[ii].frame = 0;
+		tout_sinks[ii].cursor = 0;
+		tout_sinks[ii].query = TOUT_QUERY_NONE;
+		tout_sinks[ii].alarm_head = 0;
+		tout_sinks[ii].alarm_tail = 0;
+		tout_sinks[ii].alarm_len = 0;
+		tout_sinks[ii].alarm_lost = 0;
+		tout_sinks[ii].lat_last = TOUT_LAT_NONE;
+		tout_sinks[ii].lat_max = 0;
+		tout_sinks[ii].bg_budget = 0;
+		tout_sinks[ii].bg_turn = 0;
+		tout_sinks[ii].tag_len = 0;
+		tout_sinks[ii].density = TOUT_DENSITY_ALL;
+		tout_sinks[ii].tx_time = TOUT_TX_NONE;
+		tout_sinks[ii].tx_count = 0;
+		tout_sinks[ii].late = 0;
+		tout_sinks[ii].stream = FALSE;
+		tout_sending[ii] = TOUT_SEND_IDLE;
+	}
+	tout_pack_len = 0;
+	tout_pack_wait = TOUT_PACK_NONE;
+	tout_pack_full = FALSE;
+}
+
+/*************************************************************
+/ Name: telem_out_row
+/ IN: lookup row, CAN payload
+/ OUT:  void
+/ DESC:  Called by decode() for every message found in the
+/        lookup table, the latest value is kept
+************************************************************/
+void telem_out_row(int row, unsigned char *data)
+{
+	unsigned char changed;
+	int ii;
+
+	changed = !tout_rows[row].valid;
+	for(ii = 0; ii < 8; ii++)
+	{
+		if(tout_rows[row].data[ii] != data[ii]) changed = TRUE;
+		tout_rows[row].data[ii] = data[ii];
+	}
+	tout_rows[row].valid = TRUE;
+	if(changed) stream_row(row);
+}
+
+/*************************************************************
+/ Name: telem_out_query
+/ IN: sink to answer on, data set (TOUT_SET_xxx)
+/ OUT:  1 if queued, 0 if the sink or set does not exist
+/ DESC:  The reply goes out in the next free slot of the sink,
+/        a second query before that replaces the first
+************************************************************/
+int telem_out_query(unsigned char sink, unsigned char set)
+{
+	if((sink >= TOUT_SINKS) || (set >= TOUT_SETS)) return 0;
+
+	tout_sinks[sink].query = set;
+	return 1;
+}
+
+/*************************************************************
+/ Name: telem_out_alarm
+/ IN: alarm code (TOUT_ALM_xxx), value
+/ OUT:  void
+/ DESC:  Queues an urgent record on every sink, it goes out at
+/        the next line boundary ahead of the frame in progress
+************************************************************/
+void telem_out_alarm(unsigned int code, unsigned long value)
+{
+	tout_sink *sink;
+	unsigned char next;
+	int ii;
+
+	for(ii = 0; ii < TOUT_SINKS; ii++)
+	{
+		sink = &tout_sinks[ii];
+		next = (sink->alarm_head + 1) & (TOUT_ALARMS - 1);
+		if(next == sink->alarm_tail)
+		{
+			sink->alarm_lost++;
+			continue;
+		}
+		sink->alarm[sink->alarm_head].code = code;
+		sink->alarm[sink->alarm_head].value = value;
+		sink->alarm[sink->alarm_head].posted = tb_now();
+		sink->alarm_head = next;
+	}
+}
+
+/*
+ * TRUE between frames, nothing of the sink is being sent or packed
+ */
+int telem_out_idle(unsigned char sink)
+{
+	if((sink == TOUT_SINK_MODEM) && (tout_pack_len || (tout_pack_wait != TOUT_PACK_NONE))) return FALSE;
+	return ((tout_sinks[sink].frame == 0) && (tout_sending[sink] == TOUT_SEND_IDLE));
+}
+
+/*************************************************************
+/ Name: telem_out_rf_stats
+/ IN: pointer to the RF packet count
+/ OUT:  payload / air bytes in 1/1000, TOUT_RF_EFF_NONE if
+/       nothing was sent
+/ DESC:  RF efficiency of the modem packer since the last call
+************************************************************/
+unsigned int telem_out_rf_stats(unsigned int *packets)
+{
+	unsigned int eff;
+
+	eff = TOUT_RF_EFF_NONE;
+	if(tout_rf_air) eff = (unsigned int)((tout_rf_payload * 1000UL) / tout_rf_air);
+	*packets = tout_rf_packets;
+
+	tout_rf_payload = 0;
+	tout_rf_air = 0;
+	tout_rf_packets = 0;
+	return eff;
+}
+
+/*
+ * Time the modem UART spent sending bursts since the last call, TB_COUNT_RATE counts
+ */
+unsigned long telem_out_air_busy(void)
+{
+	unsigned long busy;
+
+	busy = tout_air_busy;
+	tout_air_busy = 0;
+	return busy;
+}
+
+/*************************************************************
+/ Name: telem_out_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop part - completion events, rate dividers and
+/        handing frames to the sinks
+************************************************************/
+void telem_out_service(void)
+{
+	static unsigned long last_tick = 0;
+	unsigned long ticks;
+	unsigned char new_tick;
+	int ii;
+
+	ticks = tb_get_ticks();
+	new_tick = (ticks != last_tick);
+	last_tick = ticks;
+
+	tout_pack_service();
+	for(ii = 0; ii < TOUT_SINKS; ii++)
+		tout_sink_run(&tout_sinks[ii], &tout_sending[ii], ticks, new_tick);
+}
+
+/*************************************************************
+/ Name: telem_out_line
+/ IN: buffer (TOUT_LINE_SIZE), lookup row, CAN payload
+/ OUT:  line length
+/ DESC:  "XXXXXX,0xHHHHHHHH,0xHHHHHHHH\r\n" of the HF packet
+************************************************************/
+unsigned int telem_out_line(char *buf, int row, unsigned char *data)
+{
+	unsigned int n;
+
+	for(n = 0; n < 6; n++) buf[n] = name_lookup[row][n];
+	buf[n++] = ',';
+	n += telem_out_hex_data(&buf[n], data);
+	buf[n++] = 0x0D;
+	buf[n++] = 0x0A;
+	return n;
+}
+
+/*************************************************************
+/ Name: telem_out_crc
+/ IN: bytes, count, CRC so far (TOUT_CRC_SEED to start)
+/ OUT:  CRC-16/CCITT including the bytes
+/ DESC:  Hardware CRC module, fed through the bit reversed
+/        byte register so the result is MSB first CCITT.
+/        Main loop only, the module holds one running CRC.
+************************************************************/
+unsigned int telem_out_crc(const char *buf, unsigned int len, unsigned int crc)
+{
+	CRCINIRES = crc;
+	while(len--) CRCDIRB_L = *buf++;
+	return CRCINIRES;
+}
+
+/*************************************************************
+/ Name: telem_out_crc_line
+/ IN: buffer (TOUT_LINE_SIZE), CRC, bytes covered
+/ OUT:  line length
+/ DESC:  "TL_CRC,0x0000CCCC,0x0000NNNN\r\n"
+************************************************************/
+unsigned int telem_out_crc_line(char *buf, unsigned int crc, unsigned int count)
+{
+	unsigned int n;
+
+	memcpy(buf, "TL_CRC,", 7);
+	n = 7;
+	n += telem_out_hex32(&buf[n], crc);
+	buf[n++] = ',';
+	n += telem_out_hex32(&buf[n], count);
+	buf[n++] = 0x0D;
+	buf[n++] = 0x0A;
+	return n;
+}
+
+/*************************************************************
+/ Name: telem_out_crc_field
+/ IN: standalone record without CR LF, its length
+/ OUT:  record length with ",0x0000CCCC\r\n"
+/ DESC:  CRC field of an ASCII record sent outside a packet's
+/        TL_CRC, over the record bytes ahead of the field
+************************************************************/
+unsigned int telem_out_crc_field(char *buf, unsigned int len)
+{
+	unsigned int crc;
+
+	crc = telem_out_crc(buf, len, TOUT_CRC_SEED);
+	buf[len++] = ',';
+	len += telem_out_hex32(&buf[len], crc);
+	buf[len++] = 0x0D;
+	buf[len++] = 0x0A;
+	return len;
+}
+
+/*************************************************************
+/ Name: telem_out_hex32
+/ IN: buffer (10 bytes), value
+/ OUT:  10
+/ DESC:  "0xHHHHHHHH", MSB first
+************************************************************/
+unsigned int telem_out_hex32(char *buf, unsigned long value)
+{
+	int ii;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for(ii = 0; ii < 8; ii++) buf[2 + ii] = tout_hex_digits[(value >> (28 - 4*ii)) & 0x0F];
+	return 10;
+}
+
+/*************************************************************
+/ Name: telem_out_hex_data
+/ IN: buffer (21 bytes), CAN payload
+/ OUT:  21
+/ DESC:  "0xHHHHHHHH,0xHHHHHHHH", payload bytes in order
+************************************************************/
+unsigned int telem_out_hex_data(char *buf, unsigned char *data)
+{
+	unsigned int n;
+	int ii;
+
+	n = 0;
+	for(ii = 0; ii < 8; ii++)
+	{
+		if((ii & 3) == 0)
+		{
+			if(ii) buf[n++] = ',';
+			buf[n++] = '0';
+			buf[n++] = 'x';
+		}
+		buf[n++] = tout_hex_digits[data[ii] >> 4];
+		buf[n++] = tout_hex_digits[data[ii] & 0x0F];
+	}
+	return n;
+}
+
+/*************************************************************
+/ Name: telem_out_bin_frame
+/ IN: buffer with the payload at TOUT_BIN_HEADER, frame type,
+/     sequence, payload length
+/ OUT:  frame length
+/ DESC:  A5 5A type seq len_lo len_hi | payload | crc, the CRC
+/        covers type to the end of the payload, LSB first
+************************************************************/
+unsigned int telem_out_bin_frame(char *buf, unsigned char type, unsigned char seq, unsigned int len)
+{
+	unsigned char *p;
+	unsigned int n, crc;
+
+	p = (unsigned char *)buf;
+	p[0] = TOUT_SYNC0;
+	p[1] = TOUT_SYNC1;
+	p[2] = type;
+	p[3] = seq;
+	p[4] = (unsigned char)len;
+	p[5] = (unsigned char)(len >> 8);
+
+	n = TOUT_BIN_HEADER + len;
+	crc = telem_out_crc(&buf[2], n - 2, TOUT_CRC_SEED);
+	p[n++] = (unsigned char)crc;
+	p[n++] = (unsigned char)(crc >> 8);
+	return n;
+}
+
+/**************************************************************************************************
+ * PRIVATE FUNCTIONS
+ *************************************************************************************************/
+
+static void tout_sink_run(tout_sink *sink, unsigned char *sending, unsigned long ticks, unsigned char new_tick)
+{
+	unsigned int n;
+	unsigned char start, src, ii;
+	char *buf;
+
+	// Completion of the last write, an alarm record also closes its latency measurement
+	if(*sending && *sink->done)
+	{
+		*sink->done = FALSE;
+		if(*sending == TOUT_SEND_ALARM)
+		{
+			sink->lat_last = tb_now() - sink->alarm[sink->alarm_tail].posted;
+			if(sink->lat_last > sink->lat_max) sink->lat_max = sink->lat_last;
+			sink->alarm_tail = (sink->alarm_tail + 1) & (TOUT_ALARMS - 1);
+			sink->alarm_len = 0;
+		}
+		else if(*sending == TOUT_SEND_BG) sink->bg_done[sink->bg_cur]();
+		else if(*sending == TOUT_SEND_STREAM) sink->stream_done();
+		*sending = TOUT_SEND_IDLE;
+	}
+
+	// Rate divider, a late sink starts on the next frame as soon as it is free
+	if(new_tick && sink->divider && sink->count)
+	{
+		sink->count--;
+		if((sink->count == 0) && sink->frame) sink->late++;
+	}
+	if(new_tick) sink->bg_budget = TOUT_BG_PER_TICK;
+	if(sink->frame && !*sending && (sink->cursor >= sink->frame->len))
+	{
+		if(sink->frame->tick != TOUT_TICK_NONE)
+		{
+			sink->tx_time = tb_now() - sink->tx_start;
+			sink->tx_count++;
+		}
+		sink->frame->readers--;
+		sink->frame = 0;
+		sink->tag_len = 0;
+	}
+
+	// New frames and records only while the sink allows it (modem: no AT script pending)
+	start = (sink->ready == 0) || sink->ready();
+
+	// A query reply goes ahead of the periodic frame, which follows right after
+	if(start && (sink->query != TOUT_QUERY_NONE) && (sink->frame == 0))
+	{
+		sink->frame = tout_get_query(sink->format, sink->query);
+		if(sink->frame)
+		{
+			sink->frame->readers++;
+			sink->cursor = 0;
+			sink->query = TOUT_QUERY_NONE;
+		}
+	}
+	if(start && sink->divider && (sink->count == 0) && (sink->frame == 0) && sink->stream)
+		sink->count = sink->divider;						// stream records take the frame's bandwidth
+	if(start && sink->divider && (sink->count == 0) && (sink->frame == 0))
+	{
+		sink->frame = tout_get_frame(sink->format, ticks, sink->density);
+		if(sink->frame)
+		{
+			sink->frame->readers++;
+			sink->cursor = 0;
+			sink->count = sink->divider;
+			sink->tx_start = tb_now();
+			if(sink->tag) sink->tag_len = sink->tag(sink->format, &sink->tag_buf);
+		}
+	}
+
+	if(*sending) return;
+
+	// Alarm records at a line boundary (ASCII) or between frames (binary)
+	if((sink->alarm_tail != sink->alarm_head) && (sink->frame ? (sink->format == TOUT_ASCII) : start))
+	{
+		if(sink->alarm_len == 0) sink->alarm_len = tout_render_alarm(sink);	// once, keeps its sequence
+		if(sink->write(sink->alarm_buf, sink->alarm_len))
+		{
+			*sink->done = FALSE;
+			*sending = TOUT_SEND_ALARM;
+		}
+		return;
+	}
+
+	// Tag of a periodic frame, after the first line (ASCII) or ahead of the frame (binary)
+	if(sink->frame && sink->tag_len && ((sink->frame->format == TOUT_ASCII) ? (sink->cursor > 0) : (sink->cursor == 0)))
+	{
+		if(sink->write(sink->tag_buf, sink->tag_len))
+		{
+			*sink->done = FALSE;
+			*sending = TOUT_SEND_FRAME;
+			sink->tag_len = 0;
+		}
+		return;
+	}
+
+	// Hand the next part of the frame to the sink
+	if(sink->frame && (sink->cursor < sink->frame->len))
+	{
+		n = sink->write(&sink->frame->buf[sink->cursor], tout_chunk(sink));
+		if(n)
+		{
+			*sink->done = FALSE;
+			sink->cursor += n;
+			*sending = TOUT_SEND_FRAME;
+		}
+		return;
+	}
+
+	// Stream records as soon as the sink is free, ahead of the background
+	if(start && !sink->frame && sink->stream && sink->stream_next)
+	{
+		n = sink->stream_next(sink->format, &buf);
+		if(n)
+		{
+			if(sink->write(buf, n))
+			{
+				*sink->done = FALSE;
+				*sending = TOUT_SEND_STREAM;
+			}
+			return;
+		}
+	}
+
+	// Background parts in the idle time between frames, sources take turns
+	if(!start || sink->frame || (sink->query != TOUT_QUERY_NONE) || !sink->bg_budget) return;
+	for(ii = 0; ii < TOUT_BG_SOURCES; ii++)
+	{
+		src = (sink->bg_turn + ii) % TOUT_BG_SOURCES;
+		if(sink->bg_next[src] == 0) continue;
+		n = sink->bg_next[src](sink->format, &buf);
+		if(n == 0) continue;
+		if(sink->write(buf, n))
+		{
+			*sink->done = FALSE;
+			*sending = TOUT_SEND_BG;
+			sink->bg_cur = src;
+			sink->bg_turn = (src + 1) % TOUT_BG_SOURCES;
+			sink->bg_budget--;
+		}
+		break;
+	}
+}
+
+/*
+ * Next write of the frame, up to the end of the line for ASCII
+ */
+static unsigned int tout_chunk(tout_sink *sink)
+{
+	unsigned int ii;
+
+	if(sink->frame->format != TOUT_ASCII) return sink->frame->len - sink->cursor;
+
+	for(ii = sink->cursor; ii < sink->frame->len; ii++)
+		if(sink->frame->buf[ii] == 0x0A) break;
+	if(ii == sink->frame->len) ii--;
+	return ii + 1 - sink->cursor;
+}
+
+/*
+ * Frame of this format and density rendered on this tick, or a free buffer rendered now
+ */
+static tout_frame *tout_get_frame(unsigned char format, unsigned long ticks, unsigned char density)
+{
+	int ii;
+
+	for(ii = 0; ii < TOUT_FRAMES; ii++)
+		if((tout_frames[ii].tick == ticks) && (tout_frames[ii].format == format) &&
+		   (tout_frames[ii].density == density) && tout_frames[ii].len)
+			return &tout_frames[ii];
+
+	for(ii = 0; ii < TOUT_FRAMES; ii++)
+	{
+		if(tout_frames[ii].readers == 0)
+		{
+			tout_frames[ii].format = format;
+			tout_frames[ii].tick = ticks;
+			tout_frames[ii].density = density;
+			if(format == TOUT_BINARY) tout_render_binary(&tout_frames[ii], TOUT_TYPE_ROWS, 0, density);
+			else tout_render_ascii(&tout_frames[ii], density);
+			return &tout_frames[ii];
+		}
+	}
+	return 0;									// both buffers still being sent
+}
+
+/*
+ * Free buffer rendered with a data set reply, never shared with other sinks
+ */
+static tout_frame *tout_get_query(unsigned char format, unsigned char set)
+{
+	int ii;
+
+	for(ii = 0; ii < TOUT_FRAMES; ii++)
+	{
+		if(tout_frames[ii].readers == 0)
+		{
+			tout_frames[ii].format = format;
+			tout_frames[ii].tick = TOUT_TICK_NONE;
+			tout_frames[ii].density = TOUT_DENSITY_ALL;
+			if(format == TOUT_BINARY) tout_render_binary(&tout_frames[ii], TOUT_TYPE_QUERY, tout_sets[set], TOUT_DENSITY_ALL);
+			else tout_render_query(&tout_frames[ii], set);
+			return &tout_frames[ii];
+		}
+	}
+	return 0;
+}
+
+/*
+ * HF packet text, rendered from the latest raw rows. A lower density
+ * leaves out the lines of rows above its priority.
+ */
+static void tout_render_ascii(tout_frame *frame, unsigned char density)
+{
+	unsigned int n;
+	int off, row;
+
+	if(density == TOUT_DENSITY_SCHED)
+	{
+		tout_render_sched(frame);
+		return;
+	}
+
+	n = tout_render_pre(frame);
+	for(off = 0; off < HF_MSG_PACKET; off++)
+	{
+		row = tout_hf_row[off];
+		if((row < 0) || (addr_lookup[row][4] > density)) continue;
+		if(tout_rows[row].valid) n += telem_out_line(&frame->buf[n], row, tout_rows[row].data);
+		else
+		{
+			memcpy(&frame->buf[n], tout_init_msg, MSG_SIZE);	// not received yet
+			memcpy(&frame->buf[n], name_lookup[row], 6);
+			n += MSG_SIZE;
+		}
+	}
+	n = tout_render_time(frame, n);
+	frame->len = tout_render_crc(frame, n);
+}
+
+/*
+ * HF packet framing around the latest lines of one data set
+ */
+static void tout_render_query(tout_frame *frame, unsigned char set)
+{
+	const unsigned int *addr;
+	unsigned int n;
+	int off, pos, pck, row;
+
+	n = tout_render_pre(frame);
+	for(addr = tout_sets[set]; *addr != 0; addr++)
+		if(lookup(*addr, &off, &pos, &pck, &row) && tout_rows[row].valid)
+			n += telem_out_line(&frame->buf[n], row, tout_rows[row].data);
+	n = tout_render_time(frame, n);
+	frame->len = tout_render_crc(frame, n);
+}
+
+/*
+ * HF packet framing around the rows the scheduler picked for this frame
+ */
+static void tout_render_sched(tout_frame *frame)
+{
+	unsigned char rows[LOOKUP_ROWS];
+	unsigned int n, max;
+	unsigned char count, ii;
+
+	max = sched_budget(tout_sinks[TOUT_SINK_MODEM].divider) / TOUT_LINE_SIZE;
+	if(max > HF_MSG_PACKET) max = HF_MSG_PACKET;	// frame buffer holds one HF packet of lines
+	count = sched_pick(rows, (unsigned char)max);
+
+	n = tout_render_pre(frame);
+	for(ii = 0; ii < count; ii++) n += telem_out_line(&frame->buf[n], rows[ii], tout_rows[rows[ii]].data);
+	n = tout_render_time(frame, n);
+	frame->len = tout_render_crc(frame, n);
+}
+
+/*
+ * Pre message at the start of an ASCII packet
+ */
+static unsigned int tout_render_pre(tout_frame *frame)
+{
+	memcpy(frame->buf, tout_pre_msg, sizeof(tout_pre_msg) - 1);	// no '\0'
+	return sizeof(tout_pre_msg) - 1;
+}
+
+/*
+ * Time line after the first n bytes of an ASCII packet
+ */
+static unsigned int tout_render_time(tout_frame *frame, unsigned int n)
+{
+	memcpy(&frame->buf[n], tout_time_msg, sizeof(tout_time_msg) - 1);
+	insert_time_2(&frame->buf[n]);
+	return n + sizeof(tout_time_msg) - 1;
+}
+
+/*
+ * CRC line and post message after the first n bytes of an ASCII packet
+ */
+static unsigned int tout_render_crc(tout_frame *frame, unsigned int n)
+{
+	n += telem_out_crc_line(&frame->buf[n], telem_out_crc(frame->buf, n, TOUT_CRC_SEED), n);
+	memcpy(&frame->buf[n], tout_post_msg, sizeof(tout_post_msg) - 1);
+	return n + sizeof(tout_post_msg) - 1;
+}
+
+/*
+ * Oldest queued alarm into the sink's record buffer, in the sink's format
+ */
+static unsigned int tout_render_alarm(tout_sink *sink)
+{
+	tout_alarm *alarm;
+	unsigned char *p;
+	unsigned long ms;
+	unsigned int n;
+
+	alarm = &sink->alarm[sink->alarm_tail];
+
+	if(sink->format == TOUT_ASCII)
+	{
+		memcpy(sink->alarm_buf, "TL_ALM,", 7);
+		n = 7;
+		n += telem_out_hex32(&sink->alarm_buf[n], alarm->code);
+		sink->alarm_buf[n++] = ',';
+		n += telem_out_hex32(&sink->alarm_buf[n], alarm->value);
+		return telem_out_crc_field(sink->alarm_buf, n);
+	}
+
+	p = (unsigned char *)sink->alarm_buf;
+	ms = tb_get_ms();
+	n = TOUT_BIN_HEADER;
+	p[n++] = (unsigned char)ms;
+	p[n++] = (unsigned char)(ms >> 8);
+	p[n++] = (unsigned char)(ms >> 16);
+	p[n++] = (unsigned char)(ms >> 24);
+	p[n++] = (unsigned char)alarm->code;
+	p[n++] = (unsigned char)(alarm->code >> 8);
+	p[n++] = (unsigned char)alarm->value;
+	p[n++] = (unsigned char)(alarm->value >> 8);
+	p[n++] = (unsigned char)(alarm->value >> 16);
+	p[n++] = (unsigned char)(alarm->value >> 24);
+	return telem_out_bin_frame(sink->alarm_buf, TOUT_TYPE_ALARM, tout_seq++, n - TOUT_BIN_HEADER);
+}
+
+/*
+ * A5 5A type seq len_lo len_hi | ms of day (LSB first) | {row, data[8]}... | crc
+ * All valid rows up to the density, or the valid rows of a data set
+ */
+static void tout_render_binary(tout_frame *frame, unsigned char type, const unsigned int *set, unsigned char density)
+{
+	unsigned char *p;
+	unsigned long ms;
+	unsigned char rows[LOOKUP_ROWS];
+	unsigned int n;
+	unsigned char count, ii;
+	int row, off, pos, pck;
+
+	p = (unsigned char *)frame->buf;
+	ms = tb_get_ms();
+	n = TOUT_BIN_HEADER;
+	p[n++] = (unsigned char)ms;
+	p[n++] = (unsigned char)(ms >> 8);
+	p[n++] = (unsigned char)(ms >> 16);
+	p[n++] = (unsigned char)(ms >> 24);
+
+	if(set)
+	{
+		for(; *set != 0; set++)
+			if(lookup(*set, &off, &pos, &pck, &row)) n = tout_put_row(p, n, row);
+	}
+	else if(density == TOUT_DENSITY_SCHED)
+	{
+		count = sched_pick(rows, (unsigned char)(sched_budget(tout_sinks[TOUT_SINK_MODEM].divider) / 9));
+		for(ii = 0; ii < count; ii++) n = tout_put_row(p, n, rows[ii]);
+	}
+	else
+	{
+		for(row = 0; row < LOOKUP_ROWS; row++)
+			if((density == TOUT_DENSITY_ALL) || (addr_lookup[row][4] <= density)) n = tout_put_row(p, n, row);
+	}
+
+	frame->len = telem_out_bin_frame(frame->buf, type, tout_seq++, n - TOUT_BIN_HEADER);
+}
+
+static unsigned int tout_put_row(unsigned char *p, unsigned int n, int row)
+{
+	int ii;
+
+	if(!tout_rows[row].valid) return n;
+	p[n++] = (unsigned char)row;
+	for(ii = 0; ii < 8; ii++) p[n++] = tout_rows[row].data[ii];
+	return n;
+}
+
+/*
+ * Sink write functions, the whole part or nothing. The modem part goes
+ * to the packer, a record that does not fit waits for the next packet.
+ */
+static unsigned int tout_modem_write(char *buf, unsigned int len)
+{
+	unsigned int cap, fec;
+
+	if(Modem_AT_active()) return 0;				// radio is being reconfigured
+
+	// Records per packet, FEC adds its block overhead to the burst
+	cap = modem_rf_packet;
+	if(fec_on)
+	{
+		fec = ((cap + FEC_BLOCK - 1) / FEC_BLOCK) * (FEC_BLOCK - FEC_DATA);
+		cap = (cap > fec) ? cap - fec : 0;
+	}
+	if(cap > TOUT_PACK_MAX) cap = TOUT_PACK_MAX;
+
+	if(tout_pack_len && (tout_pack_len + len > cap))
+	{
+		tout_pack_full = TRUE;
+		return 0;
+	}
+	if(tout_pack_len + len > TOUT_PACK_SIZE) return 0;	// one record larger than a packet goes alone
+
+	memcpy(&tout_pack_buf[tout_pack_len], buf, len);
+	tout_pack_len += len;
+	tout_pack_wait = (buf == tout_sinks[TOUT_SINK_MODEM].alarm_buf) ? TOUT_PACK_ALARM : TOUT_PACK_HELD;
+	return len;
+}
+
+/*
+ * Modem packer, before the sinks run: completes the last packed record
+ * and starts a burst when the packet is full, the sink paused (nothing
+ * packed on the last pass) or an alarm is waiting
+ */
+static void tout_pack_service(void)
+{
+	extern char end_Modem_TX, put_status_MODEM;
+	unsigned char pause;
+
+	pause = (tout_pack_wait == TOUT_PACK_NONE);
+	if(tout_pack_wait == TOUT_PACK_HELD)
+	{
+		tout_pack_done = TRUE;
+		tout_pack_wait = TOUT_PACK_NONE;
+	}
+
+	// An alarm completes when its burst is out, for the alarm to air latency
+	if(end_Modem_TX)
+	{
+		end_Modem_TX = FALSE;
+		tout_air_busy += tb_now() - tout_air_start;
+		if(tout_pack_wait == TOUT_PACK_AIR)
+		{
+			tout_pack_done = TRUE;
+			tout_pack_wait = TOUT_PACK_NONE;
+		}
+	}
+
+	if(!tout_pack_len || put_status_MODEM || Modem_AT_active()) return;
+	if(tout_pack_full || pause || (tout_pack_wait == TOUT_PACK_ALARM)) tout_pack_flush();
+}
+
+/*
+ * Packed records to the UART in one burst
+ */
+static void tout_pack_flush(void)
+{
+	unsigned int n;
+
+	if(fec_on) n = fec_encode(tout_air_buf, tout_pack_buf, tout_pack_len);
+	else
+	{
+		memcpy(tout_air_buf, tout_pack_buf, tout_pack_len);
+		n = tout_pack_len;
+	}
+	if(!Modem_UART_puts_dma(tout_air_buf, n)) return;
+	tout_air_start = tb_now();
+
+	tout_rf_payload += tout_pack_len;
+	tout_rf_packets += (n + modem_rf_packet - 1) / modem_rf_packet;
+	tout_rf_air += n + (unsigned long)((n + modem_rf_packet - 1) / modem_rf_packet) * MODEM_RF_OVERHEAD;
+
+	if(tout_pack_wait == TOUT_PACK_ALARM) tout_pack_wait = TOUT_PACK_AIR;
+	tout_pack_len = 0;
+	tout_pack_full = FALSE;
+}
+
+/*
+ * A pending AT script gets the UART once the frame in progress is out
+ */
+static int tout_modem_ready(void)
+{
+	return !Modem_AT_busy();
+}
+
+static unsigned int tout_usb_write(char *buf, unsigned int len)
+{
+	return (Modem_USB_puts_dma(buf, len) ? len : 0);
+}
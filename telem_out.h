@@ -0,0 +1,188 @@
+/*
+ * telem_out.h
+ *
+ *  Telemetry output layer - one rendered frame shared by several sinks
+ *
+ *  - decode() keeps the latest raw data of every lookup row (tout_rows)
+ *  - Each frame tick a due sink gets the frame of its format, rendered at
+ *    most once per tick into one of two frame buffers
+ *  - Every sink has its own rate divider, format and read cursor and
+ *    releases the frame on its completion event
+ *  - A data set query ("var1", "var2") is answered with the latest values
+ *    of the set in the next free slot of the asking port, ahead of the
+ *    periodic frame
+ *  - ASCII frames go out one line per write, alarm records are inserted
+ *    at the next line boundary (binary: frame boundary) and their post to
+ *    completion latency is measured per sink
+ *  - Background sources (capture dump, backfill) take turns in the idle
+ *    time between frames, TOUT_BG_PER_TICK parts per tick
+ *  - A sink with a tag hook (modem: sequence number) sends the tag with
+ *    every periodic frame, after the first line or ahead of a binary frame
+ *  - Packets carry a CRC-16/CCITT (poly 0x1021, seed 0xFFFF) from the
+ *    hardware CRC module: binary frames as a 2 byte trailer over type to
+ *    payload, ASCII packets as "TL_CRC,0x0000CCCC,0x0000NNNN" ahead of the
+ *    post message, over the N bytes from the pre message to the time line
+ *    without the records inserted between them (TL_SEQ, TL_ALM). Standalone
+ *    ASCII records (alarm, tag, capture dump) end in their own CRC field
+ *    ",0x0000CCCC" over the record bytes ahead of it
+ *    (telem_out_crc_field), tools/tlverify.c checks both on the host
+ *  - Modem records are packed into bursts of the radio's RF packet size
+ *    (modem_rf_packet), telem_out_rf_stats() reports payload / air bytes
+ *  - A sink's density (priority limit of addr_lookup) selects the rows of
+ *    its periodic frames, frame time and late frames are measured per sink
+ *    for the rate controller (rate.h), or the row scheduler (sched.h) picks
+ *    the rows of each modem frame
+ *  - A streaming sink (stream.h) sends changed rows as single records in
+ *    place of its periodic frames
+ */
+
+#ifndef TELEM_OUT_H_
+#define TELEM_OUT_H_
+
+// Frame formats
+#define TOUT_ASCII			0		// HF packet text, same as the ground station log
+#define TOUT_BINARY			1		// sync, header, all valid rows raw
+
+// Sinks
+#define TOUT_SINK_MODEM		0
+#define TOUT_SINK_USB		1
+#define TOUT_SINKS			2
+
+#define TOUT_MODEM_DIV		TELEM_STATUS_COUNT	// RF link rate in ticks
+#define TOUT_USB_DIV		2					// ticks, 8 Hz pit crew data
+
+// Binary frame: A5 5A type seq len_lo len_hi | payload | crc_lo crc_hi
+#define TOUT_SYNC0			0xA5
+#define TOUT_SYNC1			0x5A
+#define TOUT_TYPE_ROWS		0x01	// payload = ms of day (4) + {row, data[8]} per valid row
+#define TOUT_TYPE_QUERY		0x02	// same payload, rows of one data set
+#define TOUT_TYPE_ALARM		0x03	// payload = ms of day (4) + code (2, LSB first) + value (4, LSB first)
+#define TOUT_TYPE_CAPTURE	0x04	// payload = ms from trigger (4) + row (1) + data (8), see capture.h
+#define TOUT_TYPE_SEQ		0x05	// payload = sequence (4) + ms of day (4), see history.h
+#define TOUT_TYPE_BACKFILL	0x06	// payload = sequence (4) + ms of day (4) + {row, data[8]}...
+#define TOUT_TYPE_RETRANSMIT	0x07	// same payload, ARQ retransmit
+#define TOUT_TYPE_STREAM	0x08	// payload = ms of day (4) + row (1) + data (8), see stream.h
+#define TOUT_TYPE_SDLOG		0x09	// payload = sequence (4) + half (1) + 256 bytes, see sdlog.h
+#define TOUT_BIN_HEADER		6
+#define TOUT_BIN_TRAILER	2		// CRC-16, LSB first
+#define TOUT_BIN_SIZE		(TOUT_BIN_HEADER + 4 + (LOOKUP_ROWS)*9 + TOUT_BIN_TRAILER)
+#define TOUT_ASCII_SIZE		(8 + HF_MSG_PACKET*MSG_SIZE + 17 + TOUT_LINE_SIZE + 9)
+#define TOUT_FRAME_SIZE		((TOUT_BIN_SIZE > TOUT_ASCII_SIZE) ? TOUT_BIN_SIZE : TOUT_ASCII_SIZE)
+#define TOUT_FRAMES			2		// a sink holds one frame, so one is always free to render
+#define TOUT_TICK_NONE		0xFFFFFFFF	// frame tick of query replies, never shared
+#define TOUT_DENSITY_ALL	0xFF	// every row, the whole HF packet
+#define TOUT_DENSITY_SCHED	0xFE	// rows picked by the scheduler (sched.h)
+#define TOUT_TX_NONE		0xFFFFFFFF	// no frame time measured yet
+
+// Data sets pulled by the ground station, reply goes to the asking port
+#define TOUT_SET_VAR1		0		// temperatures
+#define TOUT_SET_VAR2		1		// rail, pack and cell voltages
+#define TOUT_SETS			2
+#define TOUT_QUERY_NONE		0xFF
+#define TOUT_LINE_SIZE		30		// "XXXXXX,0xHHHHHHHH,0xHHHHHHHH\r\n"
+#define TOUT_CRC_SEED		0xFFFF
+#define TOUT_CRC_FIELD		11		// ",0x0000CCCC" of a standalone record
+#define TOUT_RECORD_SIZE	(TOUT_LINE_SIZE + TOUT_CRC_FIELD)	// "TL_xxx,0xAAAAAAAA,0xBBBBBBBB,0x0000CCCC\r\n"
+
+// Alarm records, "TL_ALM,0xCCCCCCCC,0xVVVVVVVV,0x0000KKKK\r\n" with code and value MSB first, K = CRC
+#define TOUT_ALARMS			8		// queued per sink, power of 2
+#define TOUT_ALARM_SIZE		TOUT_RECORD_SIZE	// ASCII line, binary record is TOUT_BIN_HEADER + 10 + TOUT_BIN_TRAILER
+#define TOUT_LAT_NONE		0xFFFFFFFF	// no alarm sent yet
+
+#define TOUT_BG_PER_TICK	1		// background parts per tick, lowest priority
+#define TOUT_BG_SOURCES		3		// per sink, served in turn
+#define TOUT_BG_NONE		0xFF
+
+// Modem packer
+#define TOUT_PACK_SIZE		MODEM_RF_MAX	// >= TOUT_FRAME_SIZE, a frame part always fits alone
+#define TOUT_PACK_MAX		(FEC_BLOCKS*FEC_DATA)	// records per burst FEC can encode
+#define TOUT_AIR_SIZE		((TOUT_PACK_SIZE > FEC_BUF_SIZE) ? TOUT_PACK_SIZE : FEC_BUF_SIZE)
+#define TOUT_PACK_NONE		0		// nothing packed since the last pass
+#define TOUT_PACK_HELD		1		// record packed, completes on the next pass
+#define TOUT_PACK_ALARM		2		// alarm packed, burst starts at once
+#define TOUT_PACK_AIR		3		// alarm burst on the UART, completes at its end
+#define TOUT_RF_EFF_NONE	0xFFFF
+
+
+typedef struct _tout_row
+{
+  unsigned char data[8];			// latest CAN payload
+  unsigned char valid;				// TRUE once received
+} tout_row;
+
+typedef struct _tout_frame
+{
+  char buf[TOUT_FRAME_SIZE];
+  unsigned int len;
+  unsigned char format;
+  unsigned char readers;			// sinks still sending from buf
+  unsigned long tick;				// tick the frame was rendered on
+  unsigned char density;			// rows up to this priority
+} tout_frame;
+
+typedef struct _tout_alarm
+{
+  unsigned int code;
+  unsigned long value;
+  unsigned long posted;				// tb_now() when posted
+} tout_alarm;
+
+typedef struct _tout_sink
+{
+  unsigned char format;
+  unsigned int divider;				// ticks per frame, 0 = off
+  unsigned int count;
+  tout_frame *frame;				// frame being sent, 0 = idle
+  unsigned int cursor;				// next byte of frame->buf to hand over
+  unsigned int (*write)(char *buf, unsigned int len);	// bytes accepted
+  char *done;						// completion event of the last write
+  int (*ready)(void);				// new frame or record may start, 0 = always
+  unsigned char query;				// data set to answer next, TOUT_QUERY_NONE = none
+  tout_alarm alarm[TOUT_ALARMS];	// urgent records, sent ahead of the frame
+  unsigned char alarm_head;
+  unsigned char alarm_tail;
+  unsigned int alarm_lost;			// posted while the queue was full
+  char alarm_buf[TOUT_ALARM_SIZE];	// record being sent
+  unsigned int alarm_len;			// rendered record in alarm_buf, 0 = none
+  unsigned long lat_last;			// alarm post to write completion, TB_COUNT_RATE counts
+  unsigned long lat_max;
+  unsigned int (*bg_next[TOUT_BG_SOURCES])(unsigned char format, char **buf);	// next background part, 0 = none
+  void (*bg_done[TOUT_BG_SOURCES])(void);	// background part is out
+  unsigned char bg_turn;			// source asked first next time
+  unsigned char bg_cur;				// source of the part being sent
+  unsigned char bg_budget;			// parts left this tick
+  unsigned int (*tag)(unsigned char format, char **buf);	// called once per periodic frame, 0 = none
+  char *tag_buf;
+  unsigned int tag_len;				// tag still to send, 0 = none
+  unsigned char density;			// periodic frame rows up to this priority, TOUT_DENSITY_ALL = all
+  unsigned long tx_start;			// tb_now() when the periodic frame started
+  unsigned long tx_time;			// last periodic frame, start to last part handed over
+  unsigned int tx_count;			// periodic frames completed
+  unsigned int late;				// periodic frames due while the last one was still going
+  unsigned char stream;				// TRUE = stream records replace the periodic frames
+  unsigned int (*stream_next)(unsigned char format, char **buf);	// next record, 0 = none
+  void (*stream_done)(void);		// record is out
+} tout_sink;
+
+// Public variables
+extern tout_row tout_rows[LOOKUP_ROWS];
+extern tout_sink tout_sinks[TOUT_SINKS];
+
+// Public functions
+void telem_out_init(void);
+void telem_out_row(int row, unsigned char *data);
+int telem_out_query(unsigned char sink, unsigned char set);
+void telem_out_alarm(unsigned int code, unsigned long value);
+int telem_out_idle(unsigned char sink);
+unsigned int telem_out_line(char *buf, int row, unsigned char *data);
+unsigned int telem_out_crc(const char *buf, unsigned int len, unsigned int crc);
+unsigned int telem_out_crc_line(char *buf, unsigned int crc, unsigned int count);
+unsigned int telem_out_crc_field(char *buf, unsigned int len);
+unsigned int telem_out_hex32(char *buf, unsigned long value);
+unsigned int telem_out_hex_data(char *buf, unsigned char *data);
+unsigned int telem_out_bin_frame(char *buf, unsigned char type, unsigned char seq, unsigned int len);
+unsigned int telem_out_rf_stats(unsigned int *packets);
+unsigned long telem_out_air_busy(void);
+void telem_out_service(void);
+
+#endif /* TELEM_OUT_H_ */
@@ -0,0 +1,307 @@
+/*
+ * timebase.c
+ *
+ *  Local high resolution clock disciplined by the MCP7940 1 Hz MFP output
+ *
+ *  The MCP7940 is programmed (SetRTC_TxData) to output 1 Hz on MFP. Each rising
+ *  edge is captured against the 250 kHz Timer B count, which gives:
+ *   - wall-clock seconds without an I2C read per status tick
+ *   - millisecond wall-clock time interpolated from the local count
+ *   - XT2 (SMCLK) drift from the counts between edges
+ *   - XT1 (ACLK) drift from the RTC_A prescaler phase at each edge
+ *
+ *  The MCP7940 is only read over I2C (burst read queued on i2c_rtc_bus) at
+ *  boot, every TB_RESYNC_SECS and once a second while the MFP edges are missing.
+ */
+
+#include "Sunseeker2021.h"
+
+// Public variables
+volatile unsigned long tb_ticks = 0;
+volatile unsigned char tb_mfp_ok = FALSE;
+long tb_xt2_ppm = 0;
+long tb_aclk_ppm = 0;
+
+// Private variables
+static volatile unsigned long tb_last_edge;			// local count at last MFP edge
+static volatile unsigned long tb_last_edge_tick;	// tb_ticks at last MFP edge
+static volatile unsigned long tb_sec_of_day;		// wall-clock second started by last edge
+static volatile unsigned int tb_edge_count;
+static unsigned long tb_cps = TB_COUNT_RATE;		// measured local counts per second
+
+static volatile unsigned long tb_win_start, tb_win_counts;
+static volatile unsigned int tb_win_phase0, tb_win_dphase;
+static volatile unsigned char tb_win_n = 0;
+static volatile unsigned char tb_win_ready = FALSE;
+
+static volatile unsigned int tb_resync_count = 0;
+static volatile unsigned char tb_resync_due = FALSE;
+static unsigned char tb_resync_pending = FALSE;
+static unsigned int tb_resync_edge;
+static unsigned long tb_resync_tick;
+
+#define TB_BCD2BIN(x)	((((x)>>4) & 0x0F)*10 + ((x) & 0x0F))
+
+static unsigned int tb_aclk_phase(void);
+static unsigned long tb_bcd_secs(void);
+
+/*************************************************************
+/ Name: timebase_init
+/ IN: snapshot time (BCD from the MCP7940)
+/ OUT:  void
+/ DESC:  Anchors the wall-clock to the last MCP7940 read and
+/        enables the RTC_MFP rising edge interrupt
+************************************************************/
+void timebase_init(void)
+{
+	tb_sec_of_day = tb_bcd_secs();
+	tb_last_edge = tb_now();
+	tb_last_edge_tick = tb_get_ticks();
+	tb_resync_tick = tb_last_edge_tick;
+	tb_cps = TB_COUNT_RATE;
+	tb_win_n = 0;
+	tb_resync_due = TRUE;				// first MCP7940 read from tb_service()
+
+	P1DIR &= ~RTC_MFP;					// MFP is open drain on the MCP7940
+	P1REN |= RTC_MFP;					// - pull up
+	P1OUT |= RTC_MFP;
+	P1IES &= ~RTC_MFP;					// low to high edge
+	P1IFG &= ~RTC_MFP;
+	P1IE  |= RTC_MFP;					// Enable MFP interrupt
+}
+
+/*************************************************************
+/ Name: tb_now
+/ IN: void
+/ OUT:  local count at TB_COUNT_RATE (wraps every 4.7 hours)
+/ DESC:  Combines the tick count and TBR, accounting for a
+/        rollover that has not been serviced yet
+************************************************************/
+unsigned long tb_now(void)
+{
+	unsigned long ticks;
+	unsigned int count;
+	unsigned short istate;
+
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	count = TBR;
+	ticks = tb_ticks;
+	if(TBCCTL0 & CCIFG)
+	{
+		count = TBR;
+		if(count < (TB_TICK_COUNTS/2)) ticks++;		// CCR0 rolled over, ISR pending
+	}
+	__set_interrupt_state(istate);
+
+	return (ticks*TB_TICK_COUNTS + count);
+}
+
+/*************************************************************
+/ Name: tb_get_ticks
+/ IN: void
+/ OUT:  TICK_RATE ticks since timerB_init
+/ DESC:  tb_ticks is 32 bits, read it without a tick ISR in between
+************************************************************/
+unsigned long tb_get_ticks(void)
+{
+	unsigned long ticks;
+	unsigned short istate;
+
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	ticks = tb_ticks;
+	__set_interrupt_state(istate);
+	return ticks;
+}
+
+/*************************************************************
+/ Name: tb_get_ms
+/ IN: void
+/ OUT:  milliseconds since midnight
+/ DESC:  Wall-clock second from the last MFP edge plus the
+/        local count since the edge scaled by the measured rate
+************************************************************/
+unsigned long tb_get_ms(void)
+{
+	unsigned long edge, sec, elapsed, whole;
+	unsigned short istate;
+
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	edge = tb_last_edge;
+	sec = tb_sec_of_day;
+	elapsed = tb_now() - edge;
+	__set_interrupt_state(istate);
+
+	whole = elapsed / tb_cps;					// only non zero while MFP is missing
+	elapsed -= whole * tb_cps;
+
+	return (((sec + whole) % TB_SEC_PER_DAY) * 1000UL + (elapsed * 1000UL) / tb_cps);
+}
+
+/*************************************************************
+/ Name: tb_mfp_edge
+/ IN: void
+/ OUT:  void
+/ DESC:  Called from the PORT1 ISR on the RTC_MFP rising edge
+************************************************************/
+void tb_mfp_edge(void)
+{
+	unsigned long now, interval;
+	unsigned int phase;
+
+	now = tb_now();
+	phase = tb_aclk_phase();
+	interval = now - tb_last_edge;
+
+	tb_last_edge = now;
+	tb_last_edge_tick = tb_ticks;
+	tb_edge_count++;
+
+	tb_sec_of_day++;
+	if(tb_sec_of_day >= TB_SEC_PER_DAY) tb_sec_of_day = 0;
+	snap_time_tick();						// BCD wall-clock for insert_time_2()
+
+	if(!tb_mfp_ok) tb_resync_due = TRUE;		// wall-clock is stale after an outage
+	tb_mfp_ok = TRUE;
+
+	// Drift measurement window, restarted on a missed or extra edge
+	if((tb_win_n != 0) && ((interval < tb_cps - TB_EDGE_TOL) || (interval > tb_cps + TB_EDGE_TOL)))
+		tb_win_n = 0;
+	if(tb_win_n == 0)
+	{
+		tb_win_start = now;
+		tb_win_phase0 = phase;
+	}
+	else if(tb_win_n == TB_DISCIPLINE_SECS)
+	{
+		tb_win_counts = now - tb_win_start;
+		tb_win_dphase = phase - tb_win_phase0;
+		tb_win_ready = TRUE;
+		tb_win_start = now;
+		tb_win_phase0 = phase;
+		tb_win_n = 0;
+	}
+	tb_win_n++;
+
+	tb_resync_count++;
+	if(tb_resync_count >= TB_RESYNC_SECS)
+	{
+		tb_resync_count = 0;
+		tb_resync_due = TRUE;
+	}
+}
+
+/*************************************************************
+/ Name: tb_service
+/ IN: void
+/ OUT:  void
+/ DESC:  Main loop housekeeping - drift computation, MFP loss
+/        detection and MCP7940 wall-clock resync
+************************************************************/
+void tb_service(void)
+{
+	extern char end_RTCIC_RX;
+	static unsigned char tb_rtc_set = FALSE;
+	unsigned long ticks, counts, edge_tick;
+	int dphase;
+	unsigned short istate;
+	snap_state now;
+
+	// Both are 32 bits written by ISRs, read them without one in between
+	istate = __get_interrupt_state();
+	__disable_interrupt();
+	ticks = tb_ticks;
+	edge_tick = tb_last_edge_tick;
+	__set_interrupt_state(istate);
+
+	if(tb_mfp_ok && ((ticks - edge_tick) > TB_MFP_TIMEOUT))
+	{
+		tb_mfp_ok = FALSE;
+		tb_win_n = 0;
+	}
+
+	if(tb_win_ready)
+	{
+		tb_win_ready = FALSE;
+		counts = tb_win_counts;
+		tb_cps = (counts + TB_DISCIPLINE_SECS/2) / TB_DISCIPLINE_SECS;
+		// ppm = error counts * 1e6 / nominal counts, 1e6/TB_COUNT_RATE = 4
+		tb_xt2_ppm = ((long)(counts - (unsigned long)TB_COUNT_RATE*TB_DISCIPLINE_SECS) * (1000000L/TB_COUNT_RATE)) / TB_DISCIPLINE_SECS;
+		// RTC_A prescaler phase slip over the window, 1e6/ACLK_RATE = 15625/512
+		dphase = (int)(tb_win_dphase & 0x7FFF);
+		if(dphase >= 0x4000) dphase -= 0x8000;
+		tb_aclk_ppm = ((long)dphase * 15625L) / (512L * TB_DISCIPLINE_SECS);
+	}
+
+	// Without MFP edges fall back to reading the MCP7940 once a second
+	if(!tb_mfp_ok && ((ticks - tb_resync_tick) >= TICK_RATE)) tb_resync_due = TRUE;
+
+	if(tb_resync_due && !tb_resync_pending && !MCP7940M_busy())
+	{
+		tb_resync_edge = tb_edge_count;
+		tb_resync_tick = ticks;
+		end_RTCIC_RX = FALSE;
+		if(get_MCP7940M_int())
+		{
+			tb_resync_due = FALSE;
+			tb_resync_pending = TRUE;
+		}
+	}
+
+	// Read failed (NACK/timeout), retried on the next due time
+	if(tb_resync_pending && MCP7940M_read_failed()) tb_resync_pending = FALSE;
+
+	if(tb_resync_pending && end_RTCIC_RX)
+	{
+		end_RTCIC_RX = FALSE;
+		tb_resync_pending = FALSE;
+		istate = __get_interrupt_state();
+		__disable_interrupt();
+		if(!tb_mfp_ok)
+		{
+			tb_sec_of_day = tb_bcd_secs();
+			tb_last_edge = tb_now();
+		}
+		else if(tb_edge_count == tb_resync_edge)
+		{
+			tb_sec_of_day = tb_bcd_secs();		// read completed within the same second
+		}
+		else tb_resync_due = TRUE;				// an edge raced the read, try again
+		__set_interrupt_state(istate);
+
+		if(!tb_rtc_set)
+		{
+			tb_rtc_set = TRUE;
+			snap_read(&now);
+			setRTChms(now.hrs, now.min, now.sec);	// on-chip RTC_A follows the MCP7940 once
+		}
+	}
+}
+
+/*
+ * RTC_A calendar prescaler phase within the RTC second, 0-32767 ACLK counts
+ *  - RT0PS counts ACLK, RT1PS counts RT0PS/256 (128 per second)
+ *  - ACLK is asynchronous to MCLK so read until two samples agree
+ */
+static unsigned int tb_aclk_phase(void)
+{
+	unsigned int p1, p2;
+
+	do
+	{
+		p1 = RTCPS;
+		p2 = RTCPS;
+	} while(p1 != p2);
+
+	return (p1 & 0x7FFF);
+}
+
+static unsigned long tb_bcd_secs(void)
+{
+	snap_state now;
+
+	snap_read(&now);
+	return (TB_BCD2BIN(now.hrs)*3600UL + TB_BCD2BIN(now.min)*60UL + TB_BCD2BIN(now.sec));
+}
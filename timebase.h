@@ -0,0 +1,40 @@
+/*
+ * timebase.h
+ *
+ *  Local high resolution clock disciplined by the MCP7940 1 Hz MFP output
+ *
+ *  - Timer B runs from SMCLK/8/5 = 250 kHz and provides the TICK_RATE tick
+ *  - The MFP rising edge (RTC_MFP, P1.6) captures the local count each second
+ *  - Wall-clock is kept from the MFP edges, I2C is only used to resync
+ *  - XT2 drift is measured from the local count between edges
+ *  - XT1 (ACLK) drift is measured from the RTC_A prescaler phase at each edge
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#define TB_COUNT_RATE		250000					// Hz, SMCLK/8/5
+#define TB_TICK_COUNTS		(TB_COUNT_RATE/TICK_RATE)	// counts per tick: 15625
+#define TB_DISCIPLINE_SECS	16						// MFP edges per drift measurement window
+#define TB_RESYNC_SECS		600						// seconds between I2C wall-clock checks
+#define TB_MFP_TIMEOUT		(TICK_RATE*3)			// ticks without an edge before MFP is lost
+#define TB_EDGE_TOL			(TB_COUNT_RATE/1000)	// accepted edge to edge jitter (1000 ppm)
+
+#define TB_SEC_PER_DAY		86400UL
+#define TB_MS_PER_DAY		86400000UL
+
+// Public variables
+extern volatile unsigned long tb_ticks;			// TICK_RATE ticks since timerB_init
+extern volatile unsigned char tb_mfp_ok;		// TRUE while MFP edges are arriving
+extern long tb_xt2_ppm;							// measured XT2 (SMCLK) error vs. MCP7940
+extern long tb_aclk_ppm;						// measured XT1 (ACLK) error vs. MCP7940
+
+// Public functions
+void timebase_init(void);
+void tb_mfp_edge(void);
+void tb_service(void);
+unsigned long tb_now(void);
+unsigned long tb_get_ticks(void);
+unsigned long tb_get_ms(void);
+
+#endif /* TIMEBASE_H_ */
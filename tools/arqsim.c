@@ -0,0 +1,497 @@
+/*
+ * arqsim.c
+ *
+ *  Loopback simulation of the modem link with the ARQ of history.c
+ *  (built in unchanged), goodput with "arq 1" against fire and forget
+ *
+ *  - Tick driven at TICK_RATE: a periodic frame every TELEM_STATUS_COUNT
+ *    ticks (history_tag numbers it), history_service() every tick, and
+ *    one history_next() part per tick in the idle link time between
+ *    frames, as the modem sink does (binary format)
+ *  - Downlink: the modem line rate, each frame is lost with the loss
+ *    rate, independently or in bursts (Gilbert model, mean burst length
+ *    in frames), and arrives at the ground after the down latency
+ *  - Ground: "ack N" for every frame that arrives, "nak N" for each gap
+ *    below it, back to the board after the up latency with its own loss
+ *  - ARQ_WINDOW, ARQ_RTO_TICKS and ARQ_TRIES come from history.h, the
+ *    Makefile target arqsweep builds the simulation with other values
+ *
+ *  Usage: arqsim [options]         loss sweep, ARQ off against on
+ *           -p loss%   one loss rate instead of the sweep
+ *           -B frames  mean loss burst (1 = independent losses)
+ *           -u loss%   uplink loss (default the downlink loss)
+ *           -d ticks   down latency, frame end to the ground (4)
+ *           -a ticks   up latency, frame arrival to the ack on board (8)
+ *           -r baud    modem line rate (MODEM_BR1)
+ *           -f bytes   periodic frame, TL_SEQ tag excluded (318)
+ *           -n frames  frames per run (2000)
+ *           -k         ground sends no naks
+ *           -s seed
+ *         arqsim -t    checks used by make check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sunseeker2021.h"
+
+#define AS_CMDS				8
+#define AS_FRAMES			2000
+#define AS_FRAME_BYTES		(TOUT_BIN_HEADER + 4 + (LOOKUP_ROWS)*9 + TOUT_BIN_TRAILER)	// every row valid
+#define AS_EVENTS			4096				// in flight per direction, power of 2
+#define AS_LIVE				8					// periodic frames queued for the link
+
+// Link events, each direction is in time order (fixed latency)
+typedef struct _as_event
+{
+  unsigned long due;
+  unsigned long seq;
+  char cmd;							// uplink: 'a' ack, 'n' nak
+} as_event;
+
+typedef struct _as_config
+{
+  double loss;						// downlink frame loss, 0..1
+  double burst;						// mean burst in frames
+  double up_loss;					// uplink, < 0 = same as the downlink
+  unsigned long down_lat, up_lat;	// ticks
+  long baud;
+  unsigned int frame;				// periodic frame bytes
+  unsigned long frames;
+  int naks;
+  unsigned long seed;
+} as_config;
+
+typedef struct _as_result
+{
+  unsigned long sent, got;			// frames generated, arrived at least once
+  unsigned long bytes;				// put on the link
+  unsigned long dup;				// retransmits of frames the ground already had when sent
+  double lat_sum, lat_max;			// generation to first arrival, s
+  unsigned int rtx, lost;			// history.c counters
+  double secs;
+} as_result;
+
+// Board side, what history.c links against
+tout_row tout_rows[LOOKUP_ROWS];
+tout_sink tout_sinks[TOUT_SINKS];
+const int addr_lookup[LOOKUP_ROWS][5] = {
+  // HF rows 0..8 at offsets 0..8, the rest never sent
+  {0, 0, 0, 0, 0}, {0, 1, 0, 0, 0}, {0, 2, 0, 0, 0}, {0, 3, 0, 0, 0}, {0, 4, 0, 0, 0},
+  {0, 5, 0, 0, 0}, {0, 6, 0, 0, 0}, {0, 7, 0, 0, 0}, {0, 8, 0, 0, 0},
+  {0, 0, 0, 3, 0}};
+
+static unsigned long as_ticks;
+static const char *as_cmd_name[AS_CMDS];
+static cmd_fn as_cmd_fn[AS_CMDS];
+
+// Simulation
+static as_event as_down[AS_EVENTS], as_up[AS_EVENTS];
+static unsigned int down_head, down_tail, up_head, up_tail;
+static unsigned long *gen_tick;
+static unsigned char *got;
+static unsigned long rng;
+static int burst_bad;
+
+/*
+ * Host stand ins for timebase.c and command.c
+ */
+unsigned long tb_get_ticks(void)
+{
+	return as_ticks;
+}
+
+unsigned long tb_get_ms(void)
+{
+	return as_ticks*1000UL/TICK_RATE;
+}
+
+unsigned long tb_now(void)
+{
+	return as_ticks*TB_TICK_COUNTS;
+}
+
+int cmd_register(const char *name, cmd_fn fn)
+{
+	int ii;
+
+	for(ii = 0; ii < AS_CMDS; ii++)
+	{
+		if((as_cmd_name[ii] == 0) || (strcmp(as_cmd_name[ii], name) == 0))
+		{
+			as_cmd_name[ii] = name;
+			as_cmd_fn[ii] = fn;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void as_cmd(const char *name, unsigned long arg)
+{
+	char args[16];
+	int ii;
+
+	sprintf(args, "%lu", arg);
+	for(ii = 0; ii < AS_CMDS; ii++)
+		if(as_cmd_name[ii] && (strcmp(as_cmd_name[ii], name) == 0)) as_cmd_fn[ii](0, args);
+}
+
+/*
+ * Host stand ins for the telem_out.c helpers history.c uses (binary only)
+ */
+unsigned int telem_out_crc(const char *buf, unsigned int len, unsigned int crc)
+{
+	int ii;
+
+	while(len--)
+	{
+		crc ^= (unsigned int)(unsigned char)*buf++ << 8;
+		for(ii = 0; ii < 8; ii++) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		crc &= 0xFFFF;
+	}
+	return crc;
+}
+
+unsigned int telem_out_bin_frame(char *buf, unsigned char type, unsigned char seq, unsigned int len)
+{
+	unsigned int crc;
+
+	buf[0] = (char)TOUT_SYNC0;
+	buf[1] = (char)TOUT_SYNC1;
+	buf[2] = type;
+	buf[3] = seq;
+	buf[4] = (char)len;
+	buf[5] = (char)(len >> 8);
+	crc = telem_out_crc(&buf[2], len + 4, TOUT_CRC_SEED);
+	buf[TOUT_BIN_HEADER + len] = (char)crc;
+	buf[TOUT_BIN_HEADER + len + 1] = (char)(crc >> 8);
+	return TOUT_BIN_HEADER + len + TOUT_BIN_TRAILER;
+}
+
+unsigned int telem_out_hex32(char *buf, unsigned long value)
+{
+	return sprintf(buf, "0x%08lX", value & 0xFFFFFFFFUL);
+}
+
+unsigned int telem_out_crc_field(char *buf, unsigned int len)
+{
+	return len + sprintf(&buf[len], ",0x%08X\r\n", telem_out_crc(buf, len, TOUT_CRC_SEED));
+}
+
+unsigned int telem_out_crc_line(char *buf, unsigned int crc, unsigned int count)
+{
+	return sprintf(buf, "TL_CRC,0x%08X,0x%08X\r\n", crc, count);
+}
+
+unsigned int telem_out_line(char *buf, int row, unsigned char *data)
+{
+	return sprintf(buf, "ROW%03d,0x%02X%02X%02X%02X,0x%02X%02X%02X%02X\r\n", row,
+			data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
+}
+
+static double as_rand(void)
+{
+	rng = (rng ^ (rng << 13)) & 0xFFFFFFFFUL;
+	rng ^= rng >> 17;
+	rng = (rng ^ (rng << 5)) & 0xFFFFFFFFUL;
+	return rng/4294967296.0;
+}
+
+/*
+ * Downlink frame lost, Gilbert model with the mean burst length
+ */
+static int as_down_lost(const as_config *cfg)
+{
+	double enter;
+
+	if(cfg->burst <= 1.0) return as_rand() < cfg->loss;
+
+	// Leave the bad state with 1/burst, enter it so the mean loss holds
+	if(burst_bad) burst_bad = (as_rand() >= 1.0/cfg->burst);
+	else
+	{
+		enter = cfg->loss/(cfg->burst*(1.0 - cfg->loss));
+		burst_bad = (as_rand() < enter);
+	}
+	return burst_bad;
+}
+
+/*
+ * Sequence number of a binary history frame (TL_SEQ, TL_RTX, TL_BFS)
+ */
+static unsigned long as_seq(const char *buf)
+{
+	const unsigned char *p;
+
+	p = (const unsigned char *)&buf[TOUT_BIN_HEADER];
+	return p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void as_push(as_event *q, unsigned int *head, unsigned long due, unsigned long seq, char cmd)
+{
+	q[*head & (AS_EVENTS - 1)].due = due;
+	q[*head & (AS_EVENTS - 1)].seq = seq;
+	q[*head & (AS_EVENTS - 1)].cmd = cmd;
+	(*head)++;
+}
+
+/*
+ * Frame seq arrives at the ground
+ */
+static void as_ground(const as_config *cfg, int arq, unsigned long seq, unsigned long *next, as_result *res)
+{
+	unsigned long m;
+	double up_loss;
+
+	if(seq >= res->sent) return;
+	if(!got[seq])
+	{
+		got[seq] = 1;
+		res->got++;
+		res->lat_sum += (double)(as_ticks - gen_tick[seq])/TICK_RATE;
+		if((double)(as_ticks - gen_tick[seq])/TICK_RATE > res->lat_max) res->lat_max = (double)(as_ticks - gen_tick[seq])/TICK_RATE;
+	}
+	if(!arq) return;
+
+	up_loss = (cfg->up_loss < 0) ? cfg->loss : cfg->up_loss;
+	if(as_rand() >= up_loss) as_push(as_up, &up_head, as_ticks + cfg->up_lat, seq, 'a');
+	for(m = *next; cfg->naks && (m < seq); m++)
+		if(!got[m] && (as_rand() >= up_loss)) as_push(as_up, &up_head, as_ticks + cfg->up_lat, m, 'n');
+	if(seq >= *next) *next = seq + 1;
+}
+
+/*
+ * One run, ARQ off or on
+ */
+static void as_run(const as_config *cfg, int arq, as_result *res)
+{
+	char *buf;
+	unsigned long live_seq[AS_LIVE];
+	unsigned int live_head, live_tail, len, credit, budget, bg_parts;
+	unsigned long end, next, cur_seq, left;
+	int busy, cur_bg, cur_rtx, ii;
+
+	memset(res, 0, sizeof(*res));
+	memset(tout_rows, 0, sizeof(tout_rows));
+	for(ii = 0; ii < LOOKUP_ROWS; ii++) tout_rows[ii].valid = TRUE;
+	tout_sinks[TOUT_SINK_MODEM].format = TOUT_BINARY;
+	rng = cfg->seed;
+	burst_bad = 0;
+	memset(got, 0, cfg->frames);
+	down_head = down_tail = up_head = up_tail = 0;
+	live_head = live_tail = 0;
+	next = 0;
+	busy = 0;
+	cur_bg = cur_rtx = 0;
+	cur_seq = left = 0;
+	credit = 0;
+
+	as_ticks = 0;
+	history_init();
+	arq_retransmits = 0;
+	arq_lost = 0;
+	as_cmd("arq", arq);
+
+	// Frames, then time for the last one to time out on every try
+	end = cfg->frames*(TELEM_STATUS_COUNT) + (ARQ_TRIES + 2)*(ARQ_RTO_TICKS + cfg->down_lat + cfg->up_lat);
+	for(as_ticks = 0; as_ticks < end; as_ticks++)
+	{
+		// Arrivals
+		while((down_tail != down_head) && (as_down[down_tail & (AS_EVENTS - 1)].due <= as_ticks))
+		{
+			as_ground(cfg, arq, as_down[down_tail & (AS_EVENTS - 1)].seq, &next, res);
+			down_tail++;
+		}
+		while((up_tail != up_head) && (as_up[up_tail & (AS_EVENTS - 1)].due <= as_ticks))
+		{
+			as_cmd((as_up[up_tail & (AS_EVENTS - 1)].cmd == 'a') ? "ack" : "nak", as_up[up_tail & (AS_EVENTS - 1)].seq);
+			up_tail++;
+		}
+
+		history_service();
+
+		// Periodic frame, its tag goes first
+		if((res->sent < cfg->frames) && ((as_ticks % (TELEM_STATUS_COUNT)) == 0))
+		{
+			history_tag(TOUT_BINARY, &buf);
+			gen_tick[res->sent] = as_ticks;
+			if(live_head - live_tail < AS_LIVE) live_seq[live_head++ % AS_LIVE] = as_seq(buf);
+			res->sent++;
+		}
+
+		// Link, the line rate in bytes per tick
+		credit += cfg->baud/10;
+		budget = credit/TICK_RATE;
+		credit %= TICK_RATE;
+		bg_parts = 0;
+		while(budget > 0)
+		{
+			if(!busy)
+			{
+				if(live_head != live_tail)
+				{
+					cur_seq = live_seq[live_tail++ % AS_LIVE];
+					left = TOUT_BIN_HEADER + 8 + TOUT_BIN_TRAILER + cfg->frame;
+					cur_bg = cur_rtx = 0;
+				}
+				else if(bg_parts < TOUT_BG_PER_TICK)
+				{
+					len = history_next(TOUT_BINARY, &buf);
+					if(len == 0) break;
+					cur_seq = as_seq(buf);
+					cur_rtx = ((unsigned char)buf[2] == TOUT_TYPE_RETRANSMIT);
+					left = len;
+					cur_bg = 1;
+					bg_parts++;
+				}
+				else break;
+				busy = 1;
+			}
+
+			len = (left < budget) ? left : budget;
+			left -= len;
+			budget -= len;
+			res->bytes += len;
+			if(left > 0) continue;
+
+			busy = 0;
+			if(cur_bg) history_sent();
+			if(cur_rtx && (cur_seq < res->sent) && got[cur_seq]) res->dup++;
+			if(!as_down_lost(cfg)) as_push(as_down, &down_head, as_ticks + cfg->down_lat, cur_seq, 0);
+		}
+	}
+
+	res->rtx = arq_retransmits;
+	res->lost = arq_lost;
+	res->secs = (double)end/TICK_RATE;
+}
+
+static void as_print_head(const as_config *cfg)
+{
+	printf("window %d, RTO %.2f s, tries %d, %ld baud, frame %u bytes every %.1f s, latency %.2f + %.2f s",
+			ARQ_WINDOW, (double)ARQ_RTO_TICKS/TICK_RATE, ARQ_TRIES, cfg->baud, cfg->frame,
+			(double)(TELEM_STATUS_COUNT)/TICK_RATE, (double)cfg->down_lat/TICK_RATE, (double)cfg->up_lat/TICK_RATE);
+	if(cfg->burst > 1.0) printf(", bursts of %.1f frames", cfg->burst);
+	printf("\n\n loss%%  ARQ  delivered  goodput/min  link use  retransmits  spurious  given up  latency (mean/max s)\n");
+}
+
+static void as_print(const as_config *cfg, int arq, const as_result *res)
+{
+	printf("%6.1f  %-3s  %8.2f%%  %11.2f  %7.1f%%  %11u  %8lu  %8u  %8.2f / %.2f\n",
+			100.0*cfg->loss, arq ? "on" : "off", 100.0*res->got/res->sent, 60.0*res->got/res->secs,
+			100.0*res->bytes/(res->secs*cfg->baud/10), res->rtx, res->dup, res->lost,
+			res->got ? res->lat_sum/res->got : 0.0, res->lat_max);
+}
+
+/*
+ * Checks of the defaults: no spurious retransmits on a clean link (RTO
+ * above the round trip), ARQ recovers what fire and forget loses
+ */
+static int as_self_test(as_config *cfg)
+{
+	as_result off, on;
+	int fail;
+
+	fail = 0;
+	cfg->loss = 0.0;
+	as_run(cfg, 1, &on);
+	if((on.got != on.sent) || on.rtx || on.lost)
+	{
+		printf("clean link: %lu of %lu, %u retransmits, %u given up\n", on.got, on.sent, on.rtx, on.lost);
+		fail = 1;
+	}
+
+	cfg->loss = 0.1;
+	as_run(cfg, 0, &off);
+	as_run(cfg, 1, &on);
+	if((off.got > off.sent*95/100) || (on.got < on.sent*999/1000))
+	{
+		printf("10%% loss: %lu without, %lu with ARQ of %lu\n", off.got, on.got, on.sent);
+		fail = 1;
+	}
+
+	cfg->loss = 0.2;
+	cfg->burst = 4.0;
+	as_run(cfg, 1, &on);
+	if(on.got < on.sent*95/100)
+	{
+		printf("20%% loss in bursts of 4: %lu of %lu with ARQ\n", on.got, on.sent);
+		fail = 1;
+	}
+
+	printf("self test %s\n", fail ? "FAILED" : "passed");
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	static const double sweep[] = {0.0, 0.01, 0.02, 0.05, 0.1, 0.2, 0.3};
+	as_config cfg;
+	as_result res;
+	int ii, arq, test, one;
+
+	cfg.loss = 0.0;
+	cfg.burst = 1.0;
+	cfg.up_loss = -1.0;
+	cfg.down_lat = 4;
+	cfg.up_lat = 8;
+	cfg.baud = MODEM_BR1;
+	cfg.frame = AS_FRAME_BYTES;
+	cfg.frames = AS_FRAMES;
+	cfg.naks = 1;
+	cfg.seed = 0x2545F491UL;
+	test = one = 0;
+
+	for(ii = 1; ii < argc; ii++)
+	{
+		if((strcmp(argv[ii], "-t") == 0) && (argc == 2)) test = 1;
+		else if(strcmp(argv[ii], "-k") == 0) cfg.naks = 0;
+		else if((argv[ii][0] == '-') && (argv[ii][1] != 0) && (argv[ii][2] == 0) && (ii + 1 < argc))
+		{
+			switch(argv[ii++][1])
+			{
+			case 'p': cfg.loss = atof(argv[ii])/100.0; one = 1; break;
+			case 'B': cfg.burst = atof(argv[ii]); break;
+			case 'u': cfg.up_loss = atof(argv[ii])/100.0; break;
+			case 'd': cfg.down_lat = strtoul(argv[ii], 0, 0); break;
+			case 'a': cfg.up_lat = strtoul(argv[ii], 0, 0); break;
+			case 'r': cfg.baud = strtol(argv[ii], 0, 0); break;
+			case 'f': cfg.frame = strtoul(argv[ii], 0, 0); break;
+			case 'n': cfg.frames = strtoul(argv[ii], 0, 0); break;
+			case 's': cfg.seed = strtoul(argv[ii], 0, 0); break;
+			default: ii = argc + 1; break;
+			}
+		}
+		else ii = argc + 1;
+	}
+	if((ii > argc) || (cfg.loss < 0.0) || (cfg.loss >= 1.0) || (cfg.baud < 10*TICK_RATE) || (cfg.frames == 0) || (cfg.seed == 0))
+	{
+		fprintf(stderr, "usage: arqsim [-p loss%%] [-B burst] [-u loss%%] [-d ticks] [-a ticks] [-r baud] [-f bytes] [-n frames] [-k] [-s seed] | -t\n");
+		return 2;
+	}
+
+	gen_tick = malloc(cfg.frames*sizeof(gen_tick[0]));
+	got = malloc(cfg.frames);
+	if((gen_tick == NULL) || (got == NULL))
+	{
+		fprintf(stderr, "arqsim: out of memory\n");
+		return 2;
+	}
+	if(test) return as_self_test(&cfg);
+
+	as_print_head(&cfg);
+	for(ii = 0; ii < (one ? 1 : (int)(sizeof(sweep)/sizeof(sweep[0]))); ii++)
+	{
+		if(!one) cfg.loss = sweep[ii];
+		for(arq = 0; arq < 2; arq++)
+		{
+			as_run(&cfg, arq, &res);
+			as_print(&cfg, arq, &res);
+		}
+	}
+	free(gen_tick);
+	free(got);
+	return 0;
+}
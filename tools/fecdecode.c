@@ -0,0 +1,502 @@
+/*
+ * fecdecode.c
+ *
+ *  Host decoder for the FEC'd modem stream, and a check of the firmware
+ *  encoder (fec.c, built in unchanged) against it
+ *
+ *  - Block: C3 3C | len | data[len] | parity[16], RS over GF(256),
+ *    polynomial 0x11D, generator roots a^0..a^15, the codeword is len +
+ *    data + parity, first byte highest power
+ *  - The decoder is written from the code definition, it shares no
+ *    tables with fec.c: syndromes, Berlekamp-Massey, Chien search and
+ *    Forney. A decode is only taken when the corrected codeword has
+ *    zero syndromes and its len byte gives the length that was tried.
+ *  - The sync bytes are not protected, a block is tried where either of
+ *    them matches. The len byte is tried as received first, then every
+ *    other length, so a hit on len still decodes.
+ *
+ *  Usage: fecdecode [file]         data to stdout, counts to stderr
+ *                                  (fecdecode capture.bin | tlverify)
+ *         fecdecode -t             round trip of fec_encode output
+ *         fecdecode -b [trials]    byte and bit error injection table
+ *  Exit status 1 if a block failed (or the test did), 2 on a usage or
+ *  file error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sunseeker2021.h"
+
+#define FD_N				255
+#define FD_T				(FEC_PARITY/2)
+#define FD_MIN				(1 + 1 + FEC_PARITY)		// len and one data byte
+#define FD_TRIALS			1000
+
+// GF(256), built here from the polynomial, not taken from fec.c
+static unsigned char fd_exp[512];
+static unsigned char fd_log[256];
+
+// Stream counts
+static unsigned long blk_ok, blk_fixed, blk_bad, sym_fixed, junk;
+
+// Benchmark random numbers, fixed seed so runs compare
+static unsigned long fd_rng = 0x2545F491UL;
+
+/*
+ * fec.c registers its command, nothing to do on the host
+ */
+int cmd_register(const char *name, cmd_fn fn)
+{
+	(void)name;
+	(void)fn;
+	return 1;
+}
+
+static void fd_init(void)
+{
+	unsigned int x;
+	int ii;
+
+	x = 1;
+	for(ii = 0; ii < 255; ii++)
+	{
+		fd_exp[ii] = fd_exp[ii + 255] = (unsigned char)x;
+		fd_log[x] = (unsigned char)ii;
+		x <<= 1;
+		if(x & 0x100) x ^= 0x11D;
+	}
+	fd_exp[510] = fd_exp[0];
+	fd_exp[511] = fd_exp[1];
+}
+
+static unsigned char fd_mul(unsigned char a, unsigned char b)
+{
+	if((a == 0) || (b == 0)) return 0;
+	return fd_exp[fd_log[a] + fd_log[b]];
+}
+
+static unsigned char fd_div(unsigned char a, unsigned char b)
+{
+	if(a == 0) return 0;
+	return fd_exp[fd_log[a] + 255 - fd_log[b]];
+}
+
+/*
+ * Polynomial (lowest first, deg + 1 terms) at x
+ */
+static unsigned char fd_eval(const unsigned char *p, int deg, unsigned char x)
+{
+	unsigned char v;
+
+	v = 0;
+	for(; deg >= 0; deg--) v = fd_mul(v, x) ^ p[deg];
+	return v;
+}
+
+/*
+ * S_j = c(a^j), j = 0..FEC_PARITY-1, 1 if any is non zero
+ */
+static int fd_syndromes(const unsigned char *cw, int n, unsigned char *s)
+{
+	int ii, jj, any;
+
+	any = 0;
+	for(jj = 0; jj < FEC_PARITY; jj++)
+	{
+		s[jj] = 0;
+		for(ii = 0; ii < n; ii++) s[jj] = fd_mul(s[jj], fd_exp[jj]) ^ cw[ii];
+		any |= s[jj];
+	}
+	return any != 0;
+}
+
+/*
+ * Corrects cw[n] in place, number of symbols fixed or -1 if it cannot
+ */
+static int fd_correct(unsigned char *cw, int n)
+{
+	unsigned char s[FEC_PARITY];
+	unsigned char lam[FEC_PARITY + 1], b[FEC_PARITY + 1], t[FEC_PARITY + 1];
+	unsigned char om[FEC_PARITY], dlam[FEC_PARITY + 1];
+	unsigned char d, bd, xinv, num, den;
+	int L, m, r, ii, jj, found;
+
+	if(!fd_syndromes(cw, n, s)) return 0;
+
+	// Berlekamp-Massey, error locator lam (lowest first)
+	memset(lam, 0, sizeof(lam));
+	memset(b, 0, sizeof(b));
+	lam[0] = b[0] = 1;
+	L = 0;
+	m = 1;
+	bd = 1;
+	for(r = 0; r < FEC_PARITY; r++)
+	{
+		d = s[r];
+		for(ii = 1; ii <= L; ii++) d ^= fd_mul(lam[ii], s[r - ii]);
+		if(d == 0)
+		{
+			m++;
+			continue;
+		}
+		memcpy(t, lam, sizeof(lam));
+		for(ii = 0; ii + m <= FEC_PARITY; ii++) lam[ii + m] ^= fd_mul(fd_div(d, bd), b[ii]);
+		if(2*L <= r)
+		{
+			L = r + 1 - L;
+			memcpy(b, t, sizeof(b));
+			bd = d;
+			m = 1;
+		}
+		else m++;
+	}
+	if(L > FD_T) return -1;
+
+	// Evaluator om = s*lam mod x^FEC_PARITY, derivative of lam
+	for(ii = 0; ii < FEC_PARITY; ii++)
+	{
+		om[ii] = 0;
+		for(jj = 0; jj <= ii; jj++) om[ii] ^= fd_mul(s[jj], lam[ii - jj]);
+	}
+	memset(dlam, 0, sizeof(dlam));
+	for(ii = 1; ii <= L; ii += 2) dlam[ii - 1] = lam[ii];
+
+	// Chien search over the shortened code, byte ii is power n-1-ii, and
+	// Forney with the first root a^0: e = X*om(1/X)/lam'(1/X)
+	found = 0;
+	for(ii = 0; ii < n; ii++)
+	{
+		xinv = fd_exp[255 - (n - 1 - ii)];
+		if(fd_eval(lam, L, xinv) != 0) continue;
+		num = fd_mul(fd_exp[n - 1 - ii], fd_eval(om, FEC_PARITY - 1, xinv));
+		den = fd_eval(dlam, L, xinv);
+		if(den == 0) return -1;
+		cw[ii] ^= fd_div(num, den);
+		found++;
+	}
+	if(found != L) return -1;
+	if(fd_syndromes(cw, n, s)) return -1;
+	return found;
+}
+
+/*
+ * Block at p (avail bytes), data to out: bytes used, 0 if no block.
+ * *fixed gets the symbols corrected.
+ */
+static int fd_block(const unsigned char *p, int avail, unsigned char *out, int *len, int *fixed)
+{
+	unsigned char cw[FD_N];
+	int want, tries, n, f;
+
+	if((avail < 2 + FD_MIN) || ((p[0] != FEC_SYNC0) && (p[1] != FEC_SYNC1))) return 0;
+
+	// Received len first, then every other one
+	for(tries = 0; tries <= FEC_DATA; tries++)
+	{
+		want = (tries == 0) ? p[2] : tries;
+		if((tries > 0) && (want == p[2])) continue;
+		if((want < 1) || (want > FEC_DATA)) continue;
+		n = 1 + want + FEC_PARITY;
+		if(2 + n > avail) continue;
+
+		memcpy(cw, &p[2], n);
+		f = fd_correct(cw, n);
+		if((f < 0) || (cw[0] != want)) continue;
+
+		memcpy(out, &cw[1], want);
+		*len = want;
+		*fixed = f;
+		return 2 + n;
+	}
+	return 0;
+}
+
+/*
+ * Decodes the stream in buf to out, counts to stderr, 1 if a block failed
+ */
+static int fd_stream(const unsigned char *buf, unsigned long size, FILE *out)
+{
+	unsigned char data[FEC_DATA];
+	unsigned long pos;
+	int used, len, fixed;
+
+	blk_ok = blk_fixed = blk_bad = sym_fixed = junk = 0;
+	pos = 0;
+	while(pos < size)
+	{
+		used = fd_block(&buf[pos], (size - pos > 2 + FD_N) ? 2 + FD_N : (int)(size - pos), data, &len, &fixed);
+		if(used == 0)
+		{
+			// Both sync bytes here but nothing decoded is a lost block
+			if((size - pos >= 2) && (buf[pos] == FEC_SYNC0) && (buf[pos + 1] == FEC_SYNC1))
+			{
+				blk_bad++;
+				fprintf(stderr, "%08lX block not decoded\n", pos);
+			}
+			junk++;
+			pos++;
+			continue;
+		}
+		if(fixed) blk_fixed++;
+		else blk_ok++;
+		sym_fixed += fixed;
+		if(out) fwrite(data, 1, len, out);
+		pos += used;
+	}
+
+	fprintf(stderr, "blocks: %lu clean, %lu corrected (%lu bytes), %lu lost, %lu bytes skipped\n",
+			blk_ok, blk_fixed, sym_fixed, blk_bad, junk);
+	return blk_bad != 0;
+}
+
+static unsigned long fd_rand(void)
+{
+	fd_rng = (fd_rng ^ (fd_rng << 13)) & 0xFFFFFFFFUL;
+	fd_rng ^= fd_rng >> 17;
+	fd_rng = (fd_rng ^ (fd_rng << 5)) & 0xFFFFFFFFUL;
+	return fd_rng;
+}
+
+/*
+ * A fec_encode block with random data, data length len: block length
+ */
+static int fd_make(unsigned char *blk, unsigned char *data, int len)
+{
+	int ii;
+
+	for(ii = 0; ii < len; ii++) data[ii] = (unsigned char)fd_rand();
+	return (int)fec_encode((char *)blk, (char *)data, len);
+}
+
+/*
+ * k distinct codeword bytes (after the sync) hit with a non zero error
+ */
+static void fd_hit_bytes(unsigned char *blk, int n, int k)
+{
+	unsigned char hit[FD_N];
+	int ii, pos;
+
+	memset(hit, 0, sizeof(hit));
+	for(ii = 0; ii < k; ii++)
+	{
+		do pos = (int)(fd_rand() % n); while(hit[pos]);
+		hit[pos] = 1;
+		blk[2 + pos] ^= (unsigned char)(1 + fd_rand() % 255);
+	}
+}
+
+/*
+ * Every codeword bit flipped with probability ber, bytes hit
+ */
+static int fd_hit_bits(unsigned char *blk, int n, double ber)
+{
+	unsigned long limit;
+	int ii, jj, bytes;
+	unsigned char e;
+
+	limit = (unsigned long)(ber*4294967296.0);
+	bytes = 0;
+	for(ii = 0; ii < n; ii++)
+	{
+		e = 0;
+		for(jj = 0; jj < 8; jj++) if(fd_rand() < limit) e |= 1 << jj;
+		blk[2 + ii] ^= e;
+		bytes += (e != 0);
+	}
+	return bytes;
+}
+
+/*
+ * One trial: 1 corrected, 0 reported lost, -1 decoded to the wrong data
+ */
+static int fd_trial(const unsigned char *blk, int size, const unsigned char *data, int len)
+{
+	unsigned char out[FEC_DATA];
+	int got, fixed;
+
+	if(fd_block(blk, size, out, &got, &fixed) != size) return 0;
+	return ((got == len) && (memcmp(out, data, len) == 0)) ? 1 : -1;
+}
+
+/*
+ * Round trip of fec_encode output, every error pattern up to FD_T bytes
+ * per block must come back, 1 on a failure
+ */
+static int fd_self_test(void)
+{
+	static const int lens[] = {1, 2, 17, 100, FEC_DATA};
+	unsigned char data[FEC_BLOCKS*FEC_DATA], blk[FEC_BUF_SIZE], ref[FEC_BUF_SIZE];
+	unsigned char out[FEC_DATA];
+	unsigned int size;
+	int ii, k, rep, n, got, fixed, fail;
+	FILE *null;
+
+	fail = 0;
+
+	// Clean blocks: zero syndromes and the data back
+	for(ii = 0; ii < (int)(sizeof(lens)/sizeof(lens[0])); ii++)
+	{
+		size = fd_make(blk, data, lens[ii]);
+		if((size != 3 + (unsigned int)lens[ii] + FEC_PARITY) || (fd_block(blk, size, out, &got, &fixed) != (int)size)
+				|| (got != lens[ii]) || fixed || memcmp(out, data, got))
+		{
+			printf("len %d: clean block not decoded\n", lens[ii]);
+			fail = 1;
+		}
+	}
+
+	// Up to FD_T byte errors anywhere in the codeword, len byte included
+	for(ii = 0; ii < (int)(sizeof(lens)/sizeof(lens[0])); ii++)
+	{
+		n = 1 + lens[ii] + FEC_PARITY;
+		for(k = 1; k <= FD_T; k++)
+		{
+			for(rep = 0; rep < 200; rep++)
+			{
+				size = fd_make(blk, data, lens[ii]);
+				fd_hit_bytes(blk, n, (k < n) ? k : n);
+				if(fd_trial(blk, size, data, lens[ii]) != 1)
+				{
+					printf("len %d, %d errors: not corrected\n", lens[ii], k);
+					fail = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	// Longest part: FEC_BLOCKS blocks back to back, through the stream path
+	size = fd_make(ref, data, FEC_BLOCKS*FEC_DATA);
+	memcpy(blk, ref, size);
+	for(ii = 0; ii < FEC_BLOCKS; ii++) fd_hit_bytes(&blk[ii*FEC_BLOCK], FEC_BLOCK - 2, FD_T);
+	blk[0] = 0;										// one sync byte lost
+	null = tmpfile();
+	if((null == NULL) || fd_stream(blk, size, null) || (blk_fixed != FEC_BLOCKS)
+			|| (ftell(null) != FEC_BLOCKS*FEC_DATA))
+	{
+		printf("two block part not decoded\n");
+		fail = 1;
+	}
+	else
+	{
+		rewind(null);
+		if((fread(out, 1, FEC_DATA, null) != FEC_DATA) || memcmp(out, data, FEC_DATA)
+				|| (fread(out, 1, FEC_DATA, null) != FEC_DATA) || memcmp(out, &data[FEC_DATA], FEC_DATA))
+		{
+			printf("two block part decoded to the wrong data\n");
+			fail = 1;
+		}
+	}
+	if(null) fclose(null);
+
+	// Parts that do not fit are refused
+	if(fec_encode((char *)blk, (char *)data, FEC_BLOCKS*FEC_DATA + 1) != 0)
+	{
+		printf("oversize part encoded\n");
+		fail = 1;
+	}
+
+	printf("self test %s\n", fail ? "FAILED" : "passed");
+	return fail;
+}
+
+/*
+ * Error injection on full length blocks, corrected / lost / wrong
+ */
+static int fd_bench(long trials)
+{
+	static const double bers[] = {1e-4, 1e-3, 3e-3, 1e-2, 2e-2};
+	unsigned char data[FEC_DATA], blk[FEC_BLOCK];
+	unsigned long res[3], bytes;
+	int size, k, ii, r;
+	long rep;
+
+	printf("RS(255,%d) blocks, %ld trials each\n\n", 255 - FEC_PARITY, trials);
+	printf("byte errors  corrected       lost      wrong\n");
+	for(k = 0; k <= FD_T + 4; k++)
+	{
+		res[0] = res[1] = res[2] = 0;
+		for(rep = 0; rep < trials; rep++)
+		{
+			size = fd_make(blk, data, FEC_DATA);
+			fd_hit_bytes(blk, size - 2, k);
+			r = fd_trial(blk, size, data, FEC_DATA);
+			res[(r == 1) ? 0 : (r == 0) ? 1 : 2]++;
+		}
+		printf("%11d %10lu %10lu %10lu\n", k, res[0], res[1], res[2]);
+	}
+
+	printf("\n    bit BER  bytes/blk  corrected       lost      wrong  goodput\n");
+	for(ii = 0; ii < (int)(sizeof(bers)/sizeof(bers[0])); ii++)
+	{
+		res[0] = res[1] = res[2] = 0;
+		bytes = 0;
+		for(rep = 0; rep < trials; rep++)
+		{
+			size = fd_make(blk, data, FEC_DATA);
+			bytes += fd_hit_bits(blk, size - 2, bers[ii]);
+			r = fd_trial(blk, size, data, FEC_DATA);
+			res[(r == 1) ? 0 : (r == 0) ? 1 : 2]++;
+		}
+		// Goodput: share of the line rate that arrives as good data
+		printf("%11.0e %10.2f %10lu %10lu %10lu  %6.1f%%\n", bers[ii], (double)bytes/trials,
+				res[0], res[1], res[2], 100.0*res[0]*FEC_DATA/((double)trials*FEC_BLOCK));
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *in;
+	unsigned char *buf;
+	unsigned long size, cap, len;
+	long trials;
+	int bad;
+
+	fd_init();
+	fec_init();
+
+	if((argc == 2) && (strcmp(argv[1], "-t") == 0)) return fd_self_test();
+	if((argc >= 2) && (strcmp(argv[1], "-b") == 0))
+	{
+		trials = (argc > 2) ? strtol(argv[2], 0, 0) : FD_TRIALS;
+		if((argc > 3) || (trials <= 0))
+		{
+			fprintf(stderr, "usage: fecdecode -b [trials]\n");
+			return 2;
+		}
+		return fd_bench(trials);
+	}
+	if((argc > 2) || ((argc == 2) && (argv[1][0] == '-')))
+	{
+		fprintf(stderr, "usage: fecdecode [file] | -t | -b [trials]\n");
+		return 2;
+	}
+	in = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+	if(in == NULL)
+	{
+		perror(argv[1]);
+		return 2;
+	}
+
+	cap = 65536;
+	size = 0;
+	buf = malloc(cap);
+	while(buf && ((len = fread(&buf[size], 1, cap - size, in)) > 0))
+	{
+		size += len;
+		if(size == cap) buf = realloc(buf, cap *= 2);
+	}
+	if(buf == NULL)
+	{
+		fprintf(stderr, "fecdecode: out of memory\n");
+		return 2;
+	}
+
+	bad = fd_stream(buf, size, stdout);
+	free(buf);
+	if(in != stdin) fclose(in);
+	return bad;
+}
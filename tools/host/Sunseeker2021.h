@@ -0,0 +1,91 @@
+/*
+ * Sunseeker2021.h (host)
+ *
+ *  Stands in for the board header when a firmware module is built into
+ *  a host tool. The Makefile force includes it ahead of the module, so
+ *  the module's own #include "Sunseeker2021.h" finds the guard already
+ *  defined and pulls in nothing for the MSP430.
+ *
+ *  Only what the host built modules use is here, each tool provides
+ *  the functions it needs (cmd_register, tb_get_ticks, ...). The board
+ *  values below are copies and must follow ../Sunseeker2021.h.
+ */
+
+#ifndef SUNSEEKER2021_H_
+#define SUNSEEKER2021_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FALSE				0
+#define TRUE				1
+
+// Event timing
+#define TICK_RATE			16		// Hz
+#define TELEM_STATUS_COUNT	16*5	// ticks per modem frame
+
+// UART rates
+#define MODEM_BR1			9600
+
+// Transmit Packet Info
+#define HF_MSG_PACKET		9
+#define LF_MSG_PACKET		0
+#define ST_MSG_PACKET		0
+#define No_MSG_PACKET		25
+#define LOOKUP_ROWS			HF_MSG_PACKET+LF_MSG_PACKET+ST_MSG_PACKET+No_MSG_PACKET
+#define MSG_SIZE			30
+#define MODEM_RF_MAX		0x201
+
+extern const int addr_lookup[LOOKUP_ROWS][5];
+
+#include "can.h"
+#include "command.h"
+#include "timebase.h"
+#include "fec.h"
+#include "telem_out.h"
+#include "history.h"
+
+// Preemption points of snapshot.c, the tool decides what runs there
+#define SNAP_POINT()		snap_point()
+void snap_point(void);
+#include "snapshot.h"
+
+// SD card socket of sdlog.c, the registers are variables of the tool and
+// UCB0TXBUF/UCB0RXBUF go to its card, DMA2 only records the source
+#define SDC_WPn				0x10
+#define SDC_CDn				0x20
+#define SDC_CSn				0x40
+
+#define UCSWRST				0x01
+#define UCSYNC				0x01
+#define UCMODE_0			0x00
+#define UCMST				0x08
+#define UCMSB				0x20
+#define UCCKPH				0x80
+#define UCSSEL_2			0x80
+#define UCBUSY				0x01
+#define UCRXIFG				0x01
+#define UCTXIFG				0x02
+#define DMA2TSEL_19			0x0013
+#define DMA2TSEL_31			0x001F
+#define DMADT_0				0x0000
+#define DMASRCINCR_3		0x0300
+#define DMADSTINCR_0		0x0000
+#define DMASRCBYTE			0x0040
+#define DMADSTBYTE			0x0080
+#define DMAIE				0x0004
+#define DMAEN				0x0010
+
+extern unsigned char P4IN, P9OUT;
+extern unsigned char UCB0CTL0, UCB0CTL1, UCB0BR0, UCB0BR1, UCB0STAT, UCB0IFG;
+extern unsigned int DMACTL1, DMA2CTL, DMA2SZ;
+unsigned char *sdsim_txbuf(void);
+unsigned char sdsim_rxbuf(void);
+void sdsim_dma_addr(unsigned long addr);
+#define UCB0TXBUF			(*sdsim_txbuf())
+#define UCB0RXBUF			sdsim_rxbuf()
+#define __data16_write_addr(reg, addr)	sdsim_dma_addr(addr)
+#include "sdlog.h"
+
+#endif /* SUNSEEKER2021_H_ */
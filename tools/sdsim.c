@@ -0,0 +1,946 @@
+/*
+ * sdsim.c
+ *
+ *  Sustained throughput of the SD black box logger (sdlog.c, built in
+ *  unchanged) against a simulated card at full CAN bus load
+ *
+ *  - Main loop: one decode() per pass, as Telem_main.c does, then
+ *    sdlog_service(), then the rest of the loop (-l). Every polled SPI
+ *    byte of sdlog.c takes its time at the UCB0BR0 rate, a DMA block
+ *    runs next to the loop and ends with the DMA2 interrupt (end_SD_TX).
+ *  - CAN0: back to back frames at the bit rate, each numbered, into the
+ *    msg_fifo_size receive queue, a frame finding the queue full is lost
+ *    before sdlog.c sees it (reception blocked)
+ *  - Card: SPI mode, SDHC, CMD0/8/55/41/58/17/24/25. After each block
+ *    of the multiple block write it is busy for -w, and for the stall -g
+ *    on every -n th block (wear levelling, erase), single block writes
+ *    (superblock) are busy for -u.
+ *  - The load starts once the card is up. When it ends the loop runs on
+ *    until the last sector is flushed, one more frame stores the last
+ *    gap, and the card is read back: sequences, log ms that never go
+ *    back, index sectors, the superblock, and every frame either logged
+ *    in order or counted in the gap of the next record.
+ *  - The self test also logs across midnight and replays the log with
+ *    "sdget" in ASCII and binary through sdlog_next_usb()/sdlog_sent().
+ *
+ *  Usage: sdsim [options]      one run, then the card is checked
+ *           -r kbps   CAN bit rate (250)
+ *           -f bits   frame with the interframe space (114, 8 data bytes
+ *                     and no stuff bits, the most frames a second)
+ *           -s secs   load time (60)
+ *           -l us     main loop pass without sdlog_service() (200)
+ *           -w us     card busy per block (800)
+ *           -g ms     card stall in place of the busy (10)
+ *           -n blocks every n th block stalls (256)
+ *           -u us     superblock busy (1500)
+ *           -c ms     ms of day at the start (12:00)
+ *           -x        stall sweep, frames dropped against -g
+ *         sdsim -t    checks used by make check
+ *  The Makefile target sdsweep runs the sweep with other SDLOG_BUFS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sunseeker2021.h"
+#include "can_FIFO.h"
+
+#define SS_SMCLK			10.0			// MHz, UCB0 clock
+#define SS_POLL_US			0.6				// sd_xchg() around the shift
+#define SS_DMA_US			0.1				// DMA2 cycles per byte
+#define SS_CARD				(SDLOG_FIRST + SDLOG_SECTORS)	// sectors on the card
+#define SS_INIT_US			100000.0		// ACMD41 until the card is ready
+#define SS_READ_US			300.0			// CMD17 to the data token
+#define SS_STOP_US			500.0			// busy after the stop token
+#define SS_QUEUE			(msg_fifo_size - 1)	// can_fifo_PUT() keeps one slot free
+
+// Card states
+#define C_CMD				0		// command bytes
+#define C_MULTI				1		// CMD25 open, data or stop token
+#define C_TOKEN				2		// CMD24, data token
+#define C_DATA				3		// data block and CRC
+#define C_READ				4		// CMD17, access time
+#define C_BUSY				5		// programming
+
+typedef struct _ss_config
+{
+  double kbps;
+  double frame_bits;
+  double secs;
+  double loop_us;
+  double busy_us;
+  double stall_ms;
+  unsigned long every;
+  double super_us;
+  unsigned long start_ms;			// ms of day
+} ss_config;
+
+typedef struct _ss_result
+{
+  unsigned long bus;				// frames on the bus
+  unsigned long overflow;			// lost to a full receive queue
+  unsigned long handed;				// given to sdlog_frame()
+  unsigned long logged;				// records read back
+  unsigned long gaps;				// sum of the record gaps
+  unsigned long sectors, index, supers, stalls;
+  unsigned int dropped, errors;		// sdlog.c counters
+  unsigned int queue_max;
+  double service_max;				// longest sdlog_service() call, us
+  int bad;							// card read back failed
+} ss_result;
+
+typedef struct _ss_replay
+{
+  unsigned long lines;				// TL_SDR, binary: frames
+  unsigned long first, last;		// log ms of the first and last TL_SDR
+  unsigned long days;				// TL_SDR after a day step
+  int starts, ends;					// TL_SDS, TL_SDE
+  int bad;
+} ss_replay;
+
+// Board side, what sdlog.c links against
+unsigned char P4IN, P9OUT;
+unsigned char UCB0CTL0, UCB0CTL1, UCB0BR0, UCB0BR1, UCB0STAT, UCB0IFG;
+unsigned int DMACTL1, DMA2CTL, DMA2SZ;
+char end_SD_TX;
+tout_sink tout_sinks[TOUT_SINKS];
+
+static double ss_us;				// simulated time
+static cmd_fn ss_sdget;
+static unsigned char ss_tx;			// UCB0TXBUF
+static unsigned char ss_rx;			// UCB0RXBUF
+static int ss_tx_new;				// UCB0TXBUF written since the last UCB0RXBUF read
+static unsigned char *ss_dma_src;
+static int ss_dma_on;
+static double ss_dma_end;
+
+// Card
+static const ss_config *ss_cfg;
+static unsigned char **ss_store;	// SS_CARD sectors, allocated when written
+static unsigned char ss_out[SDLOG_SECTOR + 8];	// bytes queued for the host
+static unsigned int ss_out_n, ss_out_i;
+static unsigned char ss_cmd[6];
+static unsigned int ss_cmd_n;
+static unsigned char ss_blk[SDLOG_SECTOR + 2];
+static unsigned int ss_blk_n;
+static int ss_mode, ss_after, ss_multi, ss_idle, ss_app;
+static unsigned long ss_addr;
+static double ss_ready;			// end of the busy or access time
+static double ss_acmd41;		// first ACMD41, < 0 = none yet
+static unsigned long ss_blocks, ss_supers, ss_stalls;
+
+/*
+ * Host stand ins for timebase.c and command.c
+ */
+unsigned long tb_get_ticks(void)
+{
+	return (unsigned long)(ss_us/(1e6/TICK_RATE));
+}
+
+unsigned long tb_get_ms(void)
+{
+	return (ss_cfg->start_ms + (unsigned long)(ss_us/1000.0)) % TB_MS_PER_DAY;
+}
+
+unsigned long tb_now(void)
+{
+	return (unsigned long)(ss_us/(1e6/TB_COUNT_RATE));
+}
+
+int cmd_register(const char *name, cmd_fn fn)
+{
+	if(strcmp(name, "sdget") == 0) ss_sdget = fn;
+	return 1;
+}
+
+/*
+ * Host stand ins for the telem_out.c helpers sdlog.c uses
+ */
+unsigned int telem_out_crc(const char *buf, unsigned int len, unsigned int crc)
+{
+	int ii;
+
+	while(len--)
+	{
+		crc ^= (unsigned int)(unsigned char)*buf++ << 8;
+		for(ii = 0; ii < 8; ii++) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		crc &= 0xFFFF;
+	}
+	return crc;
+}
+
+unsigned int telem_out_hex32(char *buf, unsigned long value)
+{
+	return sprintf(buf, "0x%08lX", value & 0xFFFFFFFFUL);
+}
+
+unsigned int telem_out_hex_data(char *buf, unsigned char *data)
+{
+	return sprintf(buf, "0x%02X%02X%02X%02X,0x%02X%02X%02X%02X",
+			data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
+}
+
+unsigned int telem_out_crc_field(char *buf, unsigned int len)
+{
+	return len + sprintf(&buf[len], ",0x%08X\r\n", telem_out_crc(buf, len, TOUT_CRC_SEED));
+}
+
+unsigned int telem_out_bin_frame(char *buf, unsigned char type, unsigned char seq, unsigned int len)
+{
+	unsigned int crc;
+
+	buf[0] = (char)TOUT_SYNC0;
+	buf[1] = (char)TOUT_SYNC1;
+	buf[2] = type;
+	buf[3] = seq;
+	buf[4] = (char)len;
+	buf[5] = (char)(len >> 8);
+	crc = telem_out_crc(&buf[2], len + 4, TOUT_CRC_SEED);
+	buf[TOUT_BIN_HEADER + len] = (char)crc;
+	buf[TOUT_BIN_HEADER + len + 1] = (char)(crc >> 8);
+	return TOUT_BIN_HEADER + len + TOUT_BIN_TRAILER;
+}
+
+static unsigned long ss_get32(const unsigned char *p)
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned int ss_get16(const unsigned char *p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+/*
+ * R1 after one byte of Ncr, then extra bytes of R3/R7
+ */
+static void ss_reply(unsigned char r1, const unsigned char *extra, unsigned int n)
+{
+	ss_out_n = ss_out_i = 0;
+	ss_out[ss_out_n++] = 0xFF;
+	ss_out[ss_out_n++] = r1;
+	while(n--) ss_out[ss_out_n++] = *extra++;
+}
+
+static void ss_command(void)
+{
+	static const unsigned char r7[4] = {0x00, 0x00, 0x01, 0xAA};
+	static const unsigned char ocr[4] = {0xC0, 0xFF, 0x80, 0x00};	// ready, CCS
+	unsigned char cmd;
+	int app;
+
+	cmd = ss_cmd[0] & 0x3F;
+	ss_addr = ((unsigned long)ss_cmd[1] << 24) | ((unsigned long)ss_cmd[2] << 16) | ((unsigned long)ss_cmd[3] << 8) | ss_cmd[4];
+	app = ss_app;
+	ss_app = 0;
+	ss_mode = C_CMD;
+
+	if(cmd == SD_CMD0)
+	{
+		ss_idle = 1;
+		ss_acmd41 = -1.0;
+		ss_reply(SD_R1_IDLE, 0, 0);
+	}
+	else if(cmd == SD_CMD8) ss_reply(ss_idle, r7, 4);
+	else if(cmd == SD_CMD55)
+	{
+		ss_app = 1;
+		ss_reply(ss_idle, 0, 0);
+	}
+	else if(app && (cmd == SD_ACMD41))
+	{
+		if(ss_acmd41 < 0) ss_acmd41 = ss_us;
+		if(ss_us - ss_acmd41 >= SS_INIT_US) ss_idle = 0;
+		ss_reply(ss_idle, 0, 0);
+	}
+	else if(cmd == SD_CMD58) ss_reply(ss_idle, ocr, 4);
+	else if(ss_idle) ss_reply(SD_R1_IDLE | 0x04, 0, 0);		// illegal before init
+	else if(((cmd == SD_CMD17) || (cmd == SD_CMD24) || (cmd == SD_CMD25)) && (ss_addr >= SS_CARD))
+		ss_reply(0x40, 0, 0);								// address error
+	else if(cmd == SD_CMD17)
+	{
+		ss_reply(0x00, 0, 0);
+		ss_ready = ss_us + SS_READ_US;
+		ss_mode = C_READ;
+	}
+	else if(cmd == SD_CMD24)
+	{
+		ss_reply(0x00, 0, 0);
+		ss_multi = 0;
+		ss_mode = C_TOKEN;
+	}
+	else if(cmd == SD_CMD25)
+	{
+		ss_reply(0x00, 0, 0);
+		ss_multi = 1;
+		ss_mode = C_MULTI;
+	}
+	else ss_reply(0x04, 0, 0);								// illegal command
+}
+
+/*
+ * Block and CRC are in, the data response goes out and the card is busy
+ */
+static void ss_block(void)
+{
+	double busy;
+
+	if(ss_store[ss_addr] == NULL)
+	{
+		ss_store[ss_addr] = malloc(SDLOG_SECTOR);
+		if(ss_store[ss_addr] == NULL)
+		{
+			fprintf(stderr, "sdsim: out of memory\n");
+			exit(2);
+		}
+	}
+	memcpy(ss_store[ss_addr], ss_blk, SDLOG_SECTOR);
+
+	if(ss_multi)
+	{
+		busy = ss_cfg->busy_us;
+		if((ss_cfg->every != 0) && ((ss_blocks % ss_cfg->every) == ss_cfg->every - 1))
+		{
+			busy = ss_cfg->stall_ms*1000.0;
+			ss_stalls++;
+		}
+		ss_blocks++;
+		ss_addr++;
+		ss_after = C_MULTI;
+	}
+	else
+	{
+		busy = ss_cfg->super_us;
+		ss_supers++;
+		ss_after = C_CMD;
+	}
+	ss_out_n = ss_out_i = 0;
+	ss_out[ss_out_n++] = 0xE5;			// data accepted
+	ss_ready = ss_us + busy;
+	ss_mode = C_BUSY;
+}
+
+/*
+ * One byte each way with CS low
+ */
+static unsigned char ss_card(unsigned char in)
+{
+	unsigned int ii;
+
+	if(P9OUT & SDC_CSn) return 0xFF;
+	if(ss_out_i < ss_out_n) return ss_out[ss_out_i++];
+
+	switch(ss_mode)
+	{
+	  case C_MULTI:
+		if(in == SD_TOKEN_MULTI)
+		{
+			ss_blk_n = 0;
+			ss_mode = C_DATA;
+		}
+		else if(in == SD_TOKEN_STOP)
+		{
+			ss_out_n = ss_out_i = 0;
+			ss_out[ss_out_n++] = 0xFF;	// Nbr, then busy
+			ss_ready = ss_us + SS_STOP_US;
+			ss_after = C_CMD;
+			ss_mode = C_BUSY;
+		}
+		else if(in == 0x40) 			// CMD0 of a restart
+		{
+			ss_cmd[0] = in;
+			ss_cmd_n = 1;
+			ss_mode = C_CMD;
+		}
+		return 0xFF;
+
+	  case C_TOKEN:
+		if(in == SD_TOKEN_SINGLE)
+		{
+			ss_blk_n = 0;
+			ss_mode = C_DATA;
+		}
+		return 0xFF;
+
+	  case C_DATA:
+		ss_blk[ss_blk_n++] = in;
+		if(ss_blk_n == SDLOG_SECTOR + 2) ss_block();
+		return 0xFF;
+
+	  case C_READ:
+		if(ss_us < ss_ready) return 0xFF;
+		ss_out_n = ss_out_i = 0;
+		for(ii = 0; ii < SDLOG_SECTOR; ii++) ss_out[ss_out_n++] = ss_store[ss_addr] ? ss_store[ss_addr][ii] : 0x00;
+		ss_out[ss_out_n++] = 0xFF;		// CRC
+		ss_out[ss_out_n++] = 0xFF;
+		ss_mode = C_CMD;
+		return SD_TOKEN_SINGLE;
+
+	  case C_BUSY:
+		if(ss_us < ss_ready) return 0x00;
+		ss_mode = ss_after;
+		return 0xFF;
+
+	  default:
+		if((ss_cmd_n == 0) && ((in & 0xC0) != 0x40)) return 0xFF;
+		ss_cmd[ss_cmd_n++] = in;
+		if(ss_cmd_n == 6)
+		{
+			ss_cmd_n = 0;
+			ss_command();
+		}
+		return 0xFF;
+	}
+}
+
+/*
+ * UCB0TXBUF/UCB0RXBUF: a read after a write shifts the byte, sd_xchg()
+ * takes the shift and the loop around it
+ */
+unsigned char *sdsim_txbuf(void)
+{
+	ss_tx_new = 1;
+	return &ss_tx;
+}
+
+unsigned char sdsim_rxbuf(void)
+{
+	if(ss_tx_new)
+	{
+		ss_tx_new = 0;
+		ss_rx = ss_card(ss_tx);
+		ss_us += 8.0*(UCB0BR0 ? UCB0BR0 : 1)/SS_SMCLK + SS_POLL_US;
+	}
+	return ss_rx;
+}
+
+void sdsim_dma_addr(unsigned long addr)
+{
+	if(addr != (unsigned long)&ss_tx) ss_dma_src = (unsigned char *)addr;
+}
+
+/*
+ * DMA2 started by sdlog_dma_start(), the block reaches the card when the
+ * last byte is shifted
+ */
+static void ss_dma(void)
+{
+	unsigned int ii;
+
+	if(!(DMA2CTL & DMAEN))
+	{
+		ss_dma_on = 0;					// not started, or stopped by sdlog_card_fail()
+		return;
+	}
+	if(!ss_dma_on)
+	{
+		ss_dma_on = 1;
+		ss_tx_new = 0;					// &UCB0TXBUF of the setup
+		ss_dma_end = ss_us + DMA2SZ*(8.0*UCB0BR0/SS_SMCLK + SS_DMA_US);
+		return;
+	}
+	if(ss_us < ss_dma_end) return;
+	for(ii = 0; ii < DMA2SZ; ii++) ss_rx = ss_card(ss_dma_src[ii]);
+	DMA2CTL &= ~DMAEN;
+	ss_dma_on = 0;
+	end_SD_TX = TRUE;
+}
+
+/*
+ * New card, sdlog.c counters cleared, sdlog_init() as at reset
+ */
+static void ss_reset(const ss_config *cfg)
+{
+	unsigned long ii;
+
+	ss_cfg = cfg;
+	if(ss_store == NULL)
+	{
+		ss_store = calloc(SS_CARD, sizeof(ss_store[0]));
+		if(ss_store == NULL)
+		{
+			fprintf(stderr, "sdsim: out of memory\n");
+			exit(2);
+		}
+	}
+	for(ii = 0; ii < SS_CARD; ii++)
+	{
+		free(ss_store[ii]);
+		ss_store[ii] = NULL;
+	}
+	ss_out_n = ss_out_i = ss_cmd_n = 0;
+	ss_mode = C_CMD;
+	ss_idle = 1;
+	ss_app = 0;
+	ss_acmd41 = -1.0;
+	ss_blocks = ss_supers = ss_stalls = 0;
+	ss_us = 0.0;
+	ss_tx_new = ss_dma_on = 0;
+
+	P4IN = SDC_WPn;						// card in, not write protected
+	UCB0IFG = UCRXIFG;					// every shift is done when it is read
+	DMA2CTL = 0;
+	end_SD_TX = FALSE;
+	sdlog_sectors = 0;
+	sdlog_dropped = 0;
+	sdlog_errors = 0;
+	sdlog_init();
+}
+
+/*
+ * One pass of the main loop, frame = number of the frame to decode or -1
+ */
+static void ss_pass(const ss_config *cfg, long frame, ss_result *res)
+{
+	can_struct msg;
+	double t0;
+	int ii;
+
+	ss_dma();
+	if(frame >= 0)
+	{
+		msg.status = CAN_OK;
+		msg.address = (unsigned int)(frame % 0x7FF);
+		for(ii = 0; ii < 4; ii++)			// data_u32 is 8 bytes on the host
+		{
+			msg.data.data_u8[ii] = (unsigned char)(frame >> (8*ii));
+			msg.data.data_u8[4 + ii] = (unsigned char)~(frame >> (8*ii));
+		}
+		sdlog_frame(0, &msg);
+		res->handed++;
+	}
+	t0 = ss_us;
+	sdlog_service();
+	if(ss_us - t0 > res->service_max) res->service_max = ss_us - t0;
+	ss_dma();
+	ss_us += cfg->loop_us;
+}
+
+/*
+ * Card read back, 0 if every sector and frame is accounted for
+ */
+static int ss_check(ss_result *res, unsigned long frames)
+{
+	unsigned long seq, next, n, ms[SDLOG_SPAN], best_gen, super_seq, key;
+	unsigned char *p, *rec;
+	unsigned int count, ii, gap;
+	int found;
+
+	next = key = 0;
+	res->logged = res->gaps = res->index = 0;
+	for(seq = 0; seq < sdlog_sectors; seq++)
+	{
+		p = ss_store[SDLOG_DATA + seq % SDLOG_DATA_SECTORS];
+		if((p == NULL) || (ss_get32(&p[SDLOG_HDR_SEQ]) != seq))
+		{
+			printf("sector %lu: %s\n", seq, p ? "wrong sequence" : "not written");
+			return 1;
+		}
+		if((seq % SDLOG_SPAN) == SDLOG_SPAN - 1)
+		{
+			for(ii = 0; ii < SDLOG_SPAN - 1; ii++)
+			{
+				if(ss_get32(&p[SDLOG_HEADER + ii*4]) != ms[ii])
+				{
+					printf("index %lu: entry %u is not the ms of its sector\n", seq, ii);
+					return 1;
+				}
+			}
+			if((ss_get16(&p[SDLOG_HDR_MAGIC]) != SDLOG_MAGIC_INDEX) || (ss_get32(&p[SDLOG_HDR_MS]) != ms[0]))
+			{
+				printf("index %lu: bad header\n", seq);
+				return 1;
+			}
+			res->index++;
+			continue;
+		}
+
+		count = ss_get16(&p[SDLOG_HDR_COUNT]);
+		if((ss_get16(&p[SDLOG_HDR_MAGIC]) != SDLOG_MAGIC) || (count == 0) || (count > SDLOG_RECORDS))
+		{
+			printf("sector %lu: bad header\n", seq);
+			return 1;
+		}
+		ms[seq % SDLOG_SPAN] = ss_get32(&p[SDLOG_HDR_MS]);
+		if(ms[seq % SDLOG_SPAN] < key)
+		{
+			printf("sector %lu: log ms %lu after %lu\n", seq, ms[seq % SDLOG_SPAN], key);
+			return 1;
+		}
+		key = ms[seq % SDLOG_SPAN];
+		for(ii = 0; ii < count; ii++)
+		{
+			rec = &p[SDLOG_HEADER + ii*SDLOG_RECORD];
+			n = ss_get32(&rec[8]);
+			gap = ss_get16(&rec[6]);
+			if((n != next + gap) || (ss_get32(&rec[12]) != (~n & 0xFFFFFFFFUL)) || (ss_get16(&rec[4]) != n % 0x7FF))
+			{
+				printf("sector %lu record %u: frame %lu with gap %u after frame %lu\n", seq, ii, n, gap, next - 1);
+				return 1;
+			}
+			next = n + 1;
+			res->gaps += gap;
+			res->logged++;
+		}
+	}
+	if(next != frames)
+	{
+		printf("last frame logged %lu of %lu\n", next - 1, frames);
+		return 1;
+	}
+
+	// The newer superblock holds the sequence after the last index sector
+	found = 0;
+	best_gen = super_seq = 0;
+	for(ii = 0; ii < 2; ii++)
+	{
+		p = ss_store[SDLOG_SUPER_A + ii];
+		if((p == NULL) || (ss_get16(&p[0]) != SDLOG_MAGIC_SUPER) ||
+		   (ss_get16(&p[SDLOG_SUPER_SIZE - 2]) != telem_out_crc((char *)p, SDLOG_SUPER_SIZE - 2, TOUT_CRC_SEED))) continue;
+		if(found && (ss_get32(&p[2]) <= best_gen)) continue;
+		found = 1;
+		best_gen = ss_get32(&p[2]);
+		super_seq = ss_get32(&p[6]);
+	}
+	if((sdlog_sectors >= SDLOG_SPAN) && (!found || (super_seq != sdlog_sectors - sdlog_sectors % SDLOG_SPAN)))
+	{
+		printf("superblock: %s\n", found ? "not the head after the last index" : "none");
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Card up, cfg->secs of load, drain, last gap, read back
+ */
+static void ss_run(const ss_config *cfg, ss_result *res)
+{
+	unsigned long q[SS_QUEUE + 1];
+	unsigned int q_head, q_tail, q_n;
+	double frame_us, t_next, t_end;
+	unsigned long frame;
+
+	memset(res, 0, sizeof(*res));
+	ss_reset(cfg);
+	while((sdlog_state < SDLOG_READY) && (ss_us < 10e6)) ss_pass(cfg, -1, res);
+	t_next = ss_us + 200000.0;				// superblocks read
+	while(ss_us < t_next) ss_pass(cfg, -1, res);
+
+	// Bus at full load, decode() takes one frame per pass
+	frame_us = cfg->frame_bits*1000.0/cfg->kbps;
+	t_end = ss_us + cfg->secs*1e6;
+	t_next = ss_us;
+	frame = 0;
+	q_head = q_tail = q_n = 0;
+	while((ss_us < t_end) || (q_n != 0))
+	{
+		for(; (t_next <= ss_us) && (t_next < t_end); t_next += frame_us)
+		{
+			res->bus++;
+			if(q_n == SS_QUEUE)
+			{
+				res->overflow++;			// never numbered, sdlog.c cannot see it
+				continue;
+			}
+			q[q_head] = frame++;
+			q_head = (q_head + 1) % (SS_QUEUE + 1);
+			q_n++;
+			if(q_n > res->queue_max) res->queue_max = q_n;
+		}
+		if(q_n == 0)
+		{
+			ss_pass(cfg, -1, res);
+			continue;
+		}
+		ss_pass(cfg, (long)q[q_tail], res);
+		q_tail = (q_tail + 1) % (SS_QUEUE + 1);
+		q_n--;
+	}
+
+	// Flush, then one frame so the last gap is on the card, flush again
+	t_next = ss_us + 3e6;
+	while(ss_us < t_next) ss_pass(cfg, -1, res);
+	ss_pass(cfg, (long)frame++, res);
+	t_next = ss_us + 3e6;
+	while(ss_us < t_next) ss_pass(cfg, -1, res);
+
+	res->sectors = sdlog_sectors;
+	res->dropped = sdlog_dropped;
+	res->errors = sdlog_errors;
+	res->supers = ss_supers;
+	res->stalls = ss_stalls;
+	res->bad = ss_check(res, frame);
+	if(!res->bad && ((res->logged + res->gaps != frame) || (res->handed != res->logged + res->dropped)))
+	{
+		printf("frames: %lu decoded, %lu logged, %lu in gaps, %u dropped\n", frame, res->logged, res->gaps, res->dropped);
+		res->bad = 1;
+	}
+}
+
+static void ss_print(const ss_config *cfg, const ss_result *res)
+{
+	double fps;
+
+	fps = cfg->kbps*1000.0/cfg->frame_bits;
+	printf("CAN %.0f kbps, %.0f bit frames: %.0f frames/s for %.0f s, main loop pass %.0f us + sdlog_service()\n",
+			cfg->kbps, cfg->frame_bits, fps, cfg->secs, cfg->loop_us);
+	printf("card: busy %.0f us per block, %.0f ms every %lu blocks, superblock %.0f us, SDLOG_BUFS %d\n",
+			cfg->busy_us, cfg->stall_ms, cfg->every, cfg->super_us, SDLOG_BUFS);
+	printf("  frames on the bus      %lu\n", res->bus);
+	printf("  lost in the CAN queue  %lu (deepest %u of %d)\n", res->overflow, res->queue_max, SS_QUEUE);
+	printf("  logged                 %lu\n", res->logged);
+	printf("  dropped by sdlog.c     %u (%.3f %%), gaps on the card %lu\n", res->dropped,
+			res->handed ? 100.0*res->dropped/res->handed : 0.0, res->gaps);
+	printf("  sectors                %lu (%lu index), %lu superblocks, %lu stalls\n",
+			res->sectors, res->index, res->supers, res->stalls);
+	printf("  card write             %.1f kB/s, records %.1f kB/s\n",
+			res->sectors*(double)SDLOG_SECTOR/cfg->secs/1000.0, res->logged*(double)SDLOG_RECORD/cfg->secs/1000.0);
+	printf("  longest sdlog_service  %.0f us\n", res->service_max);
+	printf("  card errors            %u\n", res->errors);
+	printf("  read back              %s\n", res->bad ? "FAILED" : "every frame logged in order or counted in a gap");
+}
+
+/*
+ * Frames dropped against the card stall
+ */
+static int ss_sweep(ss_config *cfg)
+{
+	static const double stall[] = {0, 5, 10, 15, 20, 30, 50, 100, 250};
+	ss_result res;
+	int ii, bad;
+
+	printf("CAN %.0f kbps, %.0f frames/s for %.0f s, busy %.0f us per block, stall every %lu blocks, SDLOG_BUFS %d\n",
+			cfg->kbps, cfg->kbps*1000.0/cfg->frame_bits, cfg->secs, cfg->busy_us, cfg->every, SDLOG_BUFS);
+	printf("  stall ms   dropped   dropped %%   queue lost   errors   read back\n");
+	bad = 0;
+	for(ii = 0; ii < (int)(sizeof(stall)/sizeof(stall[0])); ii++)
+	{
+		cfg->stall_ms = stall[ii];
+		ss_run(cfg, &res);
+		printf("  %8.0f  %8u  %10.3f  %11lu  %7u   %s\n", stall[ii], res.dropped,
+				res.handed ? 100.0*res.dropped/res.handed : 0.0, res.overflow, res.errors, res.bad ? "FAILED" : "ok");
+		bad |= res.bad;
+	}
+	return bad;
+}
+
+/*
+ * "sdget from to" on the USB port after a run, every part checked
+ */
+static void ss_replay_run(unsigned char format, unsigned long from, unsigned long to, ss_replay *rp)
+{
+	char args[32], *buf, *line, *eol;
+	unsigned char *b, bseq;
+	unsigned int n, len, crc, d[8], gap;
+	unsigned long ms, id_gap, frame, next, idle_end;
+	ss_result pass;
+	int ii, got;
+
+	memset(rp, 0, sizeof(*rp));
+	memset(&pass, 0, sizeof(pass));
+	tout_sinks[TOUT_SINK_USB].format = format;
+	sprintf(args, "%lu %lu", from, to);
+	ss_sdget(CMD_PORT_USB, args);
+
+	next = 0;
+	bseq = 0;
+	idle_end = ss_us + 2e6;
+	while((ss_us < idle_end) && (rp->ends == 0))
+	{
+		ss_pass(ss_cfg, -1, &pass);
+		n = sdlog_next_usb(format, &buf);
+		if(n == 0) continue;
+		idle_end = ss_us + 2e6;
+
+		if(format == TOUT_BINARY)
+		{
+			b = (unsigned char *)buf;
+			len = b[4] | (b[5] << 8);
+			crc = telem_out_crc(&buf[2], len + 4, TOUT_CRC_SEED);
+			if((b[0] != TOUT_SYNC0) || (b[2] != TOUT_TYPE_SDLOG) || (n != TOUT_BIN_HEADER + len + TOUT_BIN_TRAILER) ||
+			   (b[n - 2] != (crc & 0xFF)) || (b[n - 1] != (crc >> 8)) || ((rp->lines != 0) && (b[3] != (unsigned char)(bseq + 1))))
+				rp->bad = 1;
+			bseq = b[3];
+			if((sdlog_next_usb(format, &buf) != n) || ((unsigned char)buf[3] != bseq)) rp->bad = 1;	// same part until sent
+			rp->lines++;
+			sdlog_sent();
+			continue;
+		}
+
+		// ASCII, one or more CRLF lines, each with its CRC field
+		for(line = buf; line < buf + n; line = eol + 2)
+		{
+			eol = line;
+			while((eol + 1 < buf + n) && !((eol[0] == 0x0D) && (eol[1] == 0x0A))) eol++;
+			len = (unsigned int)(eol - line);
+			if((eol + 1 >= buf + n) || (len < TOUT_CRC_FIELD + 7) ||
+			   (sscanf(&line[len - TOUT_CRC_FIELD], ",0x%8x", &crc) != 1) ||
+			   (crc != telem_out_crc(line, len - TOUT_CRC_FIELD, TOUT_CRC_SEED)))
+			{
+				rp->bad = 1;
+				break;
+			}
+			if(memcmp(line, "TL_SDS,", 7) == 0) rp->starts++;
+			else if(memcmp(line, "TL_SDE,", 7) == 0) rp->ends++;
+			else
+			{
+				got = sscanf(line, "TL_SDR,0x%8lx,0x%8lx,0x%2x%2x%2x%2x,0x%2x%2x%2x%2x", &ms, &id_gap,
+						&d[0], &d[1], &d[2], &d[3], &d[4], &d[5], &d[6], &d[7]);
+				frame = 0;
+				for(ii = 0; ii < 4; ii++) frame |= (unsigned long)d[ii] << (8*ii);
+				gap = id_gap & 0xFFFF;
+				if((got != 10) || (rp->lines && ((frame != next + gap) || (ms < rp->last))) || (ms < from) || (to && (ms > to)))
+				{
+					rp->bad = 1;
+					break;
+				}
+				if(rp->lines == 0) rp->first = ms;
+				if(ms >= TB_MS_PER_DAY) rp->days++;
+				rp->last = ms;
+				next = frame + 1;
+				rp->lines++;
+			}
+		}
+		sdlog_sent();
+	}
+	if((format != TOUT_BINARY) && ((rp->starts != 1) || (rp->ends != 1))) rp->bad = 1;
+}
+
+/*
+ * Replays of a run that crossed midnight, 1 on a failure
+ */
+static int ss_replay_test(const ss_result *res)
+{
+	ss_replay rp;
+	unsigned long from, to, want;
+	int fail;
+
+	fail = res->bad;
+	from = TB_MS_PER_DAY - 10000;
+	to = TB_MS_PER_DAY + 10000;
+	want = (unsigned long)(20.0*ss_cfg->kbps*1000.0/ss_cfg->frame_bits);
+
+	ss_replay_run(TOUT_ASCII, from, to, &rp);
+	printf("  sdget %lu %lu, ASCII  %lu records %lu..%lu, %lu after midnight%s\n", from, to, rp.lines, rp.first, rp.last,
+			rp.days, rp.bad ? ", FAILED" : "");
+	if(rp.bad || (rp.lines + 50 < want) || (rp.lines > want + 50) || (rp.first > from + 5) || (rp.last + 5 < to) || (rp.days == 0))
+		fail = 1;
+
+	ss_replay_run(TOUT_BINARY, from, to, &rp);
+	printf("  sdget %lu %lu, binary %lu frames%s\n", from, to, rp.lines, rp.bad ? ", FAILED" : "");
+	if(rp.bad || (rp.lines < 2*want/SDLOG_RECORDS) || (rp.lines & 1)) fail = 1;
+
+	ss_replay_run(TOUT_ASCII, 0, 0, &rp);
+	printf("  sdget 0 0, ASCII %lu records of %lu%s\n", rp.lines, res->logged, rp.bad ? ", FAILED" : "");
+	if(rp.bad || (rp.lines != res->logged)) fail = 1;
+
+	if(fail) printf("FAILED: replay across midnight\n");
+	return fail;
+}
+
+/*
+ * Checks used by make check
+ * - typical card at full load: nothing lost, queue never full
+ * - long stalls: frames dropped, every one counted in a gap
+ * - a stall past SDLOG_BUSY_TICKS: card error, restart, the log goes on
+ */
+static int ss_self_test(ss_config *cfg)
+{
+	ss_result res;
+	int fail;
+
+	fail = 0;
+	cfg->secs = 30;
+	ss_run(cfg, &res);
+	ss_print(cfg, &res);
+	if(res.bad || res.dropped || res.overflow || res.errors || (res.logged != res.bus + 1))
+	{
+		printf("FAILED: typical card\n");
+		fail = 1;
+	}
+
+	cfg->stall_ms = 100;
+	cfg->every = 64;
+	ss_run(cfg, &res);
+	ss_print(cfg, &res);
+	if(res.bad || !res.dropped || res.overflow || res.errors)
+	{
+		printf("FAILED: long stalls\n");
+		fail = 1;
+	}
+
+	cfg->stall_ms = 1000.0*SDLOG_BUSY_TICKS/TICK_RATE + 200;
+	cfg->every = 1000;
+	ss_run(cfg, &res);
+	ss_print(cfg, &res);
+	if(res.bad || !res.errors || res.overflow || (res.logged < res.bus/2))
+	{
+		printf("FAILED: busy timeout\n");
+		fail = 1;
+	}
+
+	// Across midnight, replayed from 10 s before to 10 s after it
+	cfg->stall_ms = 10;
+	cfg->every = 256;
+	cfg->secs = 60;
+	cfg->start_ms = TB_MS_PER_DAY - 30000;
+	ss_run(cfg, &res);
+	ss_print(cfg, &res);
+	fail |= ss_replay_test(&res);
+
+	printf("sdsim self test %s\n", fail ? "FAILED" : "passed");
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	ss_config cfg;
+	ss_result res;
+	int ii, test, sweep;
+
+	cfg.kbps = 250;
+	cfg.frame_bits = 114;
+	cfg.secs = 60;
+	cfg.loop_us = 200;
+	cfg.busy_us = 800;
+	cfg.stall_ms = 10;
+	cfg.every = 256;
+	cfg.super_us = 1500;
+	cfg.start_ms = 12*3600000UL;
+	test = sweep = 0;
+
+	for(ii = 1; ii < argc; ii++)
+	{
+		if((strcmp(argv[ii], "-t") == 0) && (argc == 2)) test = 1;
+		else if(strcmp(argv[ii], "-x") == 0) sweep = 1;
+		else if((argv[ii][0] == '-') && (argv[ii][1] != 0) && (argv[ii][2] == 0) && (ii + 1 < argc))
+		{
+			switch(argv[ii++][1])
+			{
+			case 'r': cfg.kbps = atof(argv[ii]); break;
+			case 'f': cfg.frame_bits = atof(argv[ii]); break;
+			case 's': cfg.secs = atof(argv[ii]); break;
+			case 'l': cfg.loop_us = atof(argv[ii]); break;
+			case 'w': cfg.busy_us = atof(argv[ii]); break;
+			case 'g': cfg.stall_ms = atof(argv[ii]); break;
+			case 'n': cfg.every = strtoul(argv[ii], 0, 0); break;
+			case 'u': cfg.super_us = atof(argv[ii]); break;
+			case 'c': cfg.start_ms = strtoul(argv[ii], 0, 0) % TB_MS_PER_DAY; break;
+			default: ii = argc + 1; break;
+			}
+		}
+		else ii = argc + 1;
+	}
+	if((ii > argc) || (cfg.kbps <= 0) || (cfg.frame_bits < 44) || (cfg.secs <= 0) || (cfg.loop_us <= 0))
+	{
+		fprintf(stderr, "usage: sdsim [-r kbps] [-f bits] [-s secs] [-l us] [-w us] [-g ms] [-n blocks] [-u us] [-c ms] [-x] | -t\n");
+		return 2;
+	}
+
+	if(test) return ss_self_test(&cfg);
+	if(sweep) return ss_sweep(&cfg);
+	ss_run(&cfg, &res);
+	ss_print(&cfg, &res);
+	return res.bad;
+}
@@ -0,0 +1,247 @@
+/*
+ * seqlock.c
+ *
+ *  Host preemption check of the snapshot seqlock (snapshot.c, built in
+ *  unchanged)
+ *
+ *  snapshot.c marks every place between its shared accesses with
+ *  SNAP_POINT(), on the MSP430 each access is one instruction so these
+ *  are all the places an interrupt can land. Here SNAP_POINT() runs the
+ *  RTC_MFP edge (edge count, snap_time_tick) at the points picked by a
+ *  mask, and every mask is tried.
+ *
+ *  - Reader: snap_read() with the edge at any subset of its first
+ *    SL_READ_POINTS points (three passes of the retry loop) must return
+ *    a time the clock really held, never a mix, and must not hang
+ *  - Main loop writer: snap_time_set() with the edge ahead of it or at
+ *    any of its points. The count nests and ends even, so no reader can
+ *    tell, and the stored time can be wrong or torn. tb_service() only
+ *    keeps an MCP7940 read when the edge count did not move since the
+ *    read started (tb_resync_edge), else it reads again. Every wrong
+ *    case must have moved the count, and the read again must fix it.
+ *
+ *  Usage: seqlock [-v]      -v lists every writer case
+ *  Exit status 1 if a check failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "Sunseeker2021.h"
+
+#define SL_READ_POINTS		12				// 4 per pass of the snap_read() loop
+#define SL_SET_POINTS		4
+#define SL_STUCK			1000			// points in one call, the count is left odd
+#define SL_DAY				86400UL
+
+static unsigned long sl_mask;				// edge at point n when bit n is set
+static int sl_hits;							// points passed in this call
+static unsigned int sl_edges;				// tb_edge_count
+static unsigned long sl_true;				// seconds of day the MCP7940 holds
+static jmp_buf sl_stuck;
+
+/*
+ * The parts of tb_mfp_edge() that touch the snapshot
+ */
+static void sl_edge(void)
+{
+	sl_edges++;
+	sl_true = (sl_true + 1) % SL_DAY;
+	snap_time_tick();
+}
+
+void snap_point(void)
+{
+	if((sl_hits < 32) && (sl_mask & (1UL << sl_hits))) sl_edge();
+	if(++sl_hits > SL_STUCK) longjmp(sl_stuck, 1);
+}
+
+static unsigned char sl_bcd(unsigned long v)
+{
+	return (unsigned char)(((v / 10) << 4) | (v % 10));
+}
+
+static unsigned long sl_bin(unsigned char v)
+{
+	return (v >> 4)*10 + (v & 0x0F);
+}
+
+static unsigned long sl_secs(const snap_state *s)
+{
+	return sl_bin(s->hrs)*3600UL + sl_bin(s->min)*60UL + sl_bin(s->sec);
+}
+
+/*
+ * snap_time_set() with the edges of mask, 0 if it hangs
+ */
+static int sl_set(unsigned long secs, unsigned long mask)
+{
+	sl_mask = mask;
+	sl_hits = 0;
+	if(setjmp(sl_stuck)) return 0;
+	snap_time_set(sl_bcd(secs / 3600), sl_bcd((secs / 60) % 60), sl_bcd(secs % 60));
+	return 1;
+}
+
+/*
+ * snap_read() with the edges of mask, -1 if it hangs (count left odd)
+ */
+static long sl_read(unsigned long mask)
+{
+	snap_state out;
+
+	sl_mask = mask;
+	sl_hits = 0;
+	if(setjmp(sl_stuck)) return -1;
+	snap_read(&out);
+	return (long)sl_secs(&out);
+}
+
+static char *sl_text(unsigned long secs)
+{
+	static char buf[4][12];
+	static int n;
+
+	n = (n + 1) & 3;
+	sprintf(buf[n], "%02lu:%02lu:%02lu", secs / 3600, (secs / 60) % 60, secs % 60);
+	return buf[n];
+}
+
+/*
+ * Reader against the edge ISR, 1 on a failure
+ */
+static int sl_reader(unsigned long start)
+{
+	unsigned long mask, runs, passes, max_passes;
+	long got;
+	int fail;
+
+	fail = 0;
+	runs = max_passes = 0;
+	for(mask = 0; mask < (1UL << SL_READ_POINTS); mask++)
+	{
+		snap_init();
+		sl_true = start;
+		sl_set(start, 0);
+
+		sl_edges = 0;
+		got = sl_read(mask);
+		if(got < 0)
+		{
+			printf("reader from %s, edges at 0x%03lX: hangs\n", sl_text(start), mask);
+			fail = 1;
+			continue;
+		}
+
+		// Some time between the call and the return, as it was then
+		if(((unsigned long)got - start + SL_DAY) % SL_DAY > sl_edges)
+		{
+			printf("reader from %s, edges at 0x%03lX: got %s\n", sl_text(start), mask, sl_text(got));
+			fail = 1;
+		}
+		passes = (sl_hits + 3)/4;
+		if(passes > max_passes) max_passes = passes;
+		runs++;
+	}
+	printf("reader from %s: %lu edge patterns, up to %lu passes, %s\n",
+			sl_text(start), runs, max_passes, fail ? "FAILED" : "always a whole time");
+	return fail;
+}
+
+/*
+ * Main loop writer against the edge ISR: the MCP7940 read returned the
+ * time the clock held, the edge comes at point 'at' of snap_time_set(),
+ * -1 = between the read and the set, SL_SET_POINTS = not during it.
+ * 1 on a failure.
+ */
+static int sl_writer(unsigned long now, int at, int verbose, int *caught)
+{
+	unsigned long read;
+	unsigned int resync_edge;
+	long stored, fixed;
+	int wrong, fail;
+	char where[24];
+
+	snap_init();
+	sl_true = now;
+	sl_set(now, 0);							// kept by the edges so far
+
+	// tb_service(): resync starts, the read returns the chip's time
+	resync_edge = sl_edges = 0;
+	read = sl_true;
+	if(at < 0) sl_edge();
+
+	sl_set(read, ((at >= 0) && (at < SL_SET_POINTS)) ? (1UL << at) : 0);
+	if(at == SL_SET_POINTS) sl_edge();
+
+	stored = sl_read(0);
+	wrong = (stored != (long)sl_true);
+
+	// tb_service() on end_RTCIC_RX, the read is only kept without an edge
+	fixed = stored;
+	if(sl_edges != resync_edge)
+	{
+		(*caught)++;
+		sl_set(sl_true, 0);					// tb_resync_due, the next read
+		fixed = sl_read(0);
+	}
+
+	fail = (stored < 0) || (fixed != (long)sl_true) || (wrong && (sl_edges == resync_edge));
+	if(verbose || fail)
+	{
+		if(at < 0) strcpy(where, "before the set");
+		else if(at == SL_SET_POINTS) strcpy(where, "after the set");
+		else sprintf(where, "at point %d", at);
+		printf("  edge %-14s read %s, stored %s%s%s\n", where, sl_text(read), (stored < 0) ? "(count odd)" : sl_text(stored), wrong ? " wrong" : "",
+				(sl_edges != resync_edge) ? ", edge count moved, read again" : "");
+	}
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned long starts[] = {12*3600UL + 34*60 + 56, 12*3600UL + 59*60 + 59, SL_DAY - 1};
+	int ii, at, fail, verbose, caught, wrong_runs;
+
+	verbose = (argc == 2) && (strcmp(argv[1], "-v") == 0);
+	if((argc > 2) || ((argc == 2) && !verbose))
+	{
+		fprintf(stderr, "usage: seqlock [-v]\n");
+		return 2;
+	}
+
+	fail = 0;
+	for(ii = 0; ii < (int)(sizeof(starts)/sizeof(starts[0])); ii++) fail |= sl_reader(starts[ii]);
+
+	// Writer
+	caught = wrong_runs = 0;
+	for(ii = 0; ii < (int)(sizeof(starts)/sizeof(starts[0])); ii++)
+	{
+		if(verbose) printf("writer at %s:\n", sl_text(starts[ii]));
+		for(at = -1; at <= SL_SET_POINTS; at++)
+		{
+			fail |= sl_writer(starts[ii], at, verbose, &caught);
+		}
+	}
+
+	// How many of them the snapshot alone would have left wrong
+	for(ii = 0; ii < (int)(sizeof(starts)/sizeof(starts[0])); ii++)
+	{
+		for(at = 0; at < SL_SET_POINTS; at++)
+		{
+			snap_init();
+			sl_true = starts[ii];
+			sl_set(starts[ii], 0);
+			sl_set(sl_true, 1UL << at);
+			wrong_runs += (sl_read(0) != (long)sl_true);
+		}
+	}
+	printf("writer: %d edge placements, %d caught by the edge count, %d of %d edges inside the set left a wrong time\n",
+			(int)(sizeof(starts)/sizeof(starts[0]))*(SL_SET_POINTS + 2), caught, wrong_runs,
+			(int)(sizeof(starts)/sizeof(starts[0]))*SL_SET_POINTS);
+
+	printf("seqlock check %s\n", fail ? "FAILED" : "passed");
+	return fail;
+}
@@ -0,0 +1,344 @@
+/*
+ * tlverify.c
+ *
+ *  Host check of a captured telemetry stream (modem or USB, FEC removed)
+ *
+ *  - Binary frames: A5 5A type seq len_lo len_hi | payload | CRC-16 LSB
+ *    first over type to the end of the payload
+ *  - ASCII packets: "ABCDEF" pre message to "UVWXYZ" post message, the
+ *    "TL_CRC,0x0000CCCC,0x0000NNNN" line holds the CRC and byte count of
+ *    the packet lines from the pre message to the time line. TL_ records
+ *    inserted between them (TL_SEQ, TL_BFS, TL_RTX, TL_ALM) are skipped.
+ *  - Standalone ASCII records (alarms, tags, capture dump, stream and SD
+ *    replay lines) end in ",0x0000CCCC" over the record bytes ahead of it
+ *
+ *  CRC-16/CCITT, poly 0x1021, seed 0xFFFF, MSB first - the same as
+ *  telem_out_crc() on the F5438A CRC module.
+ *
+ *  Usage: tlverify [-v] [file]     (stdin without a file)
+ *         tlverify -t              self test on a made up stream
+ *  Exit status 1 if anything failed, 2 on a usage or file error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TL_SYNC0			0xA5
+#define TL_SYNC1			0x5A
+#define TL_BIN_HEADER		6
+#define TL_BIN_TRAILER		2
+#define TL_BIN_MAX			1024			// longest payload accepted before resync
+#define TL_LINE_MAX			256
+#define TL_TYPES			16
+#define TL_CRC_SEED			0xFFFF
+
+static const char *tl_type_name[TL_TYPES] = {
+	"?", "rows", "query", "alarm", "capture", "seq", "backfill", "retransmit",
+	"stream", "sdlog", "?", "?", "?", "?", "?", "?"};
+
+static int tl_verbose = 0;
+
+// Counts
+static unsigned long bin_ok[TL_TYPES], bin_bad[TL_TYPES];
+static unsigned long pck_ok, pck_bad, pck_open;
+static unsigned long rec_ok, rec_bad, rec_none;
+static unsigned long junk;
+
+/*
+ * CRC-16/CCITT, MSB first
+ */
+static unsigned int tl_crc(const unsigned char *buf, unsigned long len, unsigned int crc)
+{
+	int ii;
+
+	while(len--)
+	{
+		crc ^= (unsigned int)*buf++ << 8;
+		for(ii = 0; ii < 8; ii++) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		crc &= 0xFFFF;
+	}
+	return crc;
+}
+
+/*
+ * "0xHHHHHHHH" at p, -1 if not hex
+ */
+static long tl_hex32(const char *p)
+{
+	long v;
+	int ii;
+
+	if((p[0] != '0') || (p[1] != 'x')) return -1;
+	v = 0;
+	for(ii = 2; ii < 10; ii++)
+	{
+		v <<= 4;
+		if((p[ii] >= '0') && (p[ii] <= '9')) v |= p[ii] - '0';
+		else if((p[ii] >= 'A') && (p[ii] <= 'F')) v |= p[ii] - 'A' + 10;
+		else return -1;
+	}
+	return v;
+}
+
+/*
+ * Standalone record, line without CR LF: last field is the CRC
+ */
+static void tl_record(const char *line, unsigned long len, unsigned long at)
+{
+	long crc;
+
+	if((len < 11) || (line[len - 11] != ',') || ((crc = tl_hex32(&line[len - 10])) < 0) || (crc > 0xFFFF))
+	{
+		rec_none++;
+		if(tl_verbose) printf("%08lX record without CRC: %.*s\n", at, (int)len, line);
+		return;
+	}
+	if((unsigned int)crc == tl_crc((const unsigned char *)line, len - 11, TL_CRC_SEED)) rec_ok++;
+	else
+	{
+		rec_bad++;
+		printf("%08lX record CRC error: %.*s\n", at, (int)len, line);
+	}
+}
+
+/*
+ * Checks everything in buf, prints a summary, 1 if anything failed
+ */
+static int tl_scan(const unsigned char *buf, unsigned long size)
+{
+	unsigned long pos, end, len, at;
+	unsigned int crc, pcrc;
+	unsigned long pcount, pstart;
+	int in_packet, type, bad;
+	long want_crc, want_n;
+	const char *line;
+
+	memset(bin_ok, 0, sizeof(bin_ok));
+	memset(bin_bad, 0, sizeof(bin_bad));
+	pck_ok = pck_bad = pck_open = 0;
+	rec_ok = rec_bad = rec_none = 0;
+	junk = 0;
+
+	in_packet = 0;
+	pcrc = TL_CRC_SEED;
+	pcount = 0;
+	pstart = 0;
+	pos = 0;
+	while(pos < size)
+	{
+		// Binary frame
+		if((buf[pos] == TL_SYNC0) && (pos + 1 < size) && (buf[pos + 1] == TL_SYNC1))
+		{
+			if(pos + TL_BIN_HEADER > size) break;
+			type = buf[pos + 2] & (TL_TYPES - 1);
+			len = buf[pos + 4] | ((unsigned long)buf[pos + 5] << 8);
+			end = pos + TL_BIN_HEADER + len + TL_BIN_TRAILER;
+			if((len <= TL_BIN_MAX) && (end <= size))
+			{
+				crc = tl_crc(&buf[pos + 2], TL_BIN_HEADER - 2 + len, TL_CRC_SEED);
+				if((unsigned int)(buf[end - 2] | (buf[end - 1] << 8)) == crc)
+				{
+					bin_ok[type]++;
+					if(tl_verbose) printf("%08lX %s seq %u len %lu\n", pos, tl_type_name[type], buf[pos + 3], len);
+					pos = end;
+					continue;
+				}
+			}
+			bin_bad[type]++;
+			printf("%08lX binary %s frame error (len %lu)\n", pos, tl_type_name[type], len);
+			pos++;								// resync on the next sync
+			continue;
+		}
+
+		// ASCII line
+		at = pos;
+		end = pos;
+		while((end < size) && (buf[end] != 0x0A) && (end - pos < TL_LINE_MAX)) end++;
+		if((end >= size) || (buf[end] != 0x0A) || (end == pos) || (buf[end - 1] != 0x0D))
+		{
+			junk++;
+			pos++;
+			continue;
+		}
+		line = (const char *)&buf[pos];
+		len = end - 1 - pos;					// without CR LF
+		pos = end + 1;
+
+		if((len == 6) && (memcmp(line, "ABCDEF", 6) == 0))
+		{
+			if(in_packet)
+			{
+				pck_open++;
+				printf("%08lX packet at %08lX has no TL_CRC\n", at, pstart);
+			}
+			in_packet = 1;
+			pstart = at;
+			pcrc = tl_crc((const unsigned char *)line, len + 2, TL_CRC_SEED);
+			pcount = len + 2;
+			continue;
+		}
+		if((len == 6) && (memcmp(line, "UVWXYZ", 6) == 0)) continue;	// post message, after TL_CRC
+		if(!in_packet)
+		{
+			tl_record(line, len, at);
+			continue;
+		}
+		if((len >= 6) && (memcmp(line, "TL_CRC", 6) == 0))
+		{
+			want_crc = (len >= 17) ? tl_hex32(&line[7]) : -1;
+			want_n = (len >= 28) ? tl_hex32(&line[18]) : -1;
+			bad = (want_crc != (long)pcrc) || (want_n != (long)pcount);
+			if(bad)
+			{
+				pck_bad++;
+				printf("%08lX packet at %08lX CRC %04X/%lu, TL_CRC says %04lX/%ld\n", at, pstart, pcrc, pcount, want_crc, want_n);
+			}
+			else pck_ok++;
+			in_packet = 0;
+			continue;
+		}
+		if((len >= 3) && (memcmp(line, "TL_", 3) == 0) && !((len >= 6) && (memcmp(line, "TL_TIM", 6) == 0)))
+		{
+			tl_record(line, len, at);			// inserted record, not part of the packet CRC
+			continue;
+		}
+		pcrc = tl_crc((const unsigned char *)line, len + 2, pcrc);
+		pcount += len + 2;
+	}
+	if(in_packet) pck_open++;
+
+	printf("ASCII packets: %lu ok, %lu bad, %lu without TL_CRC\n", pck_ok, pck_bad, pck_open);
+	printf("ASCII records: %lu ok, %lu bad, %lu without CRC\n", rec_ok, rec_bad, rec_none);
+	for(type = 0; type < TL_TYPES; type++)
+		if(bin_ok[type] || bin_bad[type])
+			printf("binary %-10s: %lu ok, %lu bad\n", tl_type_name[type], bin_ok[type], bin_bad[type]);
+	if(junk) printf("bytes outside lines or frames: %lu\n", junk);
+
+	bad = (pck_bad || pck_open || rec_bad || rec_none);
+	for(type = 0; type < TL_TYPES; type++) if(bin_bad[type]) bad = 1;
+	return bad;
+}
+
+/*
+ * Line with its CRC field, as telem_out_crc_field()
+ */
+static unsigned long tl_put_record(unsigned char *p, const char *text)
+{
+	unsigned long n;
+
+	n = strlen(text);
+	memcpy(p, text, n);
+	n += sprintf((char *)&p[n], ",0x%08X\r\n", tl_crc(p, n, TL_CRC_SEED));
+	return n;
+}
+
+/*
+ * Made up stream of every packet kind, then the same with one byte hit
+ */
+static int tl_self_test(void)
+{
+	static const char *rows[] = {"ABCDEF\r\n", "MC1BUS,0x00004842,0x0000C842\r\n",
+		"MC1VEL,0x00002041,0x00401C45\r\n", "TL_TIM,12:34:56\r\n", 0};
+	unsigned char buf[1024];
+	unsigned long n, start, ii;
+	unsigned int crc;
+	int fail;
+
+	fail = 0;
+	if(tl_crc((const unsigned char *)"123456789", 9, TL_CRC_SEED) != 0x29B1)
+	{
+		printf("CRC check value wrong\n");
+		fail = 1;
+	}
+
+	n = 0;
+	start = 0;										// packet bytes
+	crc = TL_CRC_SEED;
+	for(ii = 0; rows[ii]; ii++)
+	{
+		memcpy(&buf[n], rows[ii], strlen(rows[ii]));
+		crc = tl_crc(&buf[n], strlen(rows[ii]), crc);
+		start += strlen(rows[ii]);
+		n += strlen(rows[ii]);
+		if(ii == 0) n += tl_put_record(&buf[n], "TL_SEQ,0x00000007,0x02B3F5A0");
+		if(ii == 1) n += tl_put_record(&buf[n], "TL_ALM,0x00000201,0x42C80000");
+	}
+	n += sprintf((char *)&buf[n], "TL_CRC,0x%08X,0x%08lX\r\nUVWXYZ\r\n", crc, start);
+	n += tl_put_record(&buf[n], "TL_CPS,0x02B3F5A0,0x00010008");
+
+	start = n;										// binary alarm frame
+	buf[n++] = TL_SYNC0;
+	buf[n++] = TL_SYNC1;
+	buf[n++] = 0x03;
+	buf[n++] = 0x11;
+	buf[n++] = 10;
+	buf[n++] = 0;
+	for(ii = 0; ii < 10; ii++) buf[n++] = (unsigned char)(ii * 17);
+	crc = tl_crc(&buf[start + 2], n - start - 2, TL_CRC_SEED);
+	buf[n++] = (unsigned char)crc;
+	buf[n++] = (unsigned char)(crc >> 8);
+
+	printf("-- clean stream\n");
+	if(tl_scan(buf, n) || (pck_ok != 1) || (rec_ok != 3) || (bin_ok[3] != 1)) fail = 1;
+
+	for(ii = 0; ii < n; ii += 37)
+	{
+		buf[ii] ^= 0x04;
+		if(!tl_scan(buf, n))
+		{
+			printf("byte %lu hit, not detected\n", ii);
+			fail = 1;
+		}
+		buf[ii] ^= 0x04;
+	}
+
+	printf("self test %s\n", fail ? "FAILED" : "passed");
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *in;
+	unsigned char *buf;
+	unsigned long size, cap, len;
+	int argi, bad;
+
+	argi = 1;
+	if((argc == 2) && (strcmp(argv[1], "-t") == 0)) return tl_self_test();
+	if((argc > argi) && (strcmp(argv[argi], "-v") == 0))
+	{
+		tl_verbose = 1;
+		argi++;
+	}
+	if(argc > argi + 1)
+	{
+		fprintf(stderr, "usage: tlverify [-v] [file] | -t\n");
+		return 2;
+	}
+	in = (argc > argi) ? fopen(argv[argi], "rb") : stdin;
+	if(in == NULL)
+	{
+		perror(argv[argi]);
+		return 2;
+	}
+
+	cap = 65536;
+	size = 0;
+	buf = malloc(cap);
+	while(buf && ((len = fread(&buf[size], 1, cap - size, in)) > 0))
+	{
+		size += len;
+		if(size == cap) buf = realloc(buf, cap *= 2);
+	}
+	if(buf == NULL)
+	{
+		fprintf(stderr, "tlverify: out of memory\n");
+		return 2;
+	}
+
+	bad = tl_scan(buf, size);
+	free(buf);
+	if(in != stdin) fclose(in);
+	return bad;
+}
@@ -0,0 +1,71 @@
+/*
+ * uart_baud.h
+ *
+ *  Compile time USCI_A UART baud rate generator (SLAU208 34.3.10)
+ *
+ *  For a rate br from SMCLK_RATE both modes are derived:
+ *   - low frequency:  N = UCBR + UCBRS/8, rounded to 1/8 BRCLK
+ *   - oversampling:   N = 16*UCBR + UCBRF, rounded to 1 BRCLK (N >= 16)
+ *  and the one with the lower error is used.
+ *
+ *  Errors are in 0.01 % units:
+ *   - rate error of the average bit time
+ *   - low frequency mode also moves bit edges by up to one BRCLK,
+ *     counted against a 10 bit frame
+ *  All terms stay below 2^32 for SMCLK_RATE up to 25 MHz.
+ *
+ *  UART_BRW(br) and UART_MCTL(br) go straight into UCAxBRW and UCAxMCTL.
+ *  UART_DMA_PERIOD(br) is the SMCLK timer period that paces DMA transmit
+ *  on UCA2/UCA3, which have no DMA trigger of their own.
+ */
+
+#ifndef UART_BAUD_H_
+#define UART_BAUD_H_
+
+#define UART_ERR_BUDGET		200			// 2.00 %, receiver samples mid bit over a 10 bit frame
+
+#define UART_DIFF(a,b)		((a) > (b) ? (a) - (b) : (b) - (a))
+
+// Low frequency mode, divider in 1/8 BRCLK
+#define UART_D8(br)			((8UL*SMCLK_RATE + (br)/2) / (br))
+#define UART_ERR_LF(br)		(UART_DIFF(UART_D8(br)*(br), 8UL*SMCLK_RATE) / ((8UL*SMCLK_RATE)/10000UL))
+#define UART_JIT_LF(br)		((1000UL*(br) + SMCLK_RATE/2) / SMCLK_RATE)
+
+// Oversampling mode, divider in BRCLK, UCBRF spreads the fraction inside each bit
+#define UART_D1(br)			((1UL*SMCLK_RATE + (br)/2) / (br))
+#define UART_ERR_OS(br)		(UART_DIFF(UART_D1(br)*(br), 1UL*SMCLK_RATE) / ((1UL*SMCLK_RATE)/10000UL))
+
+#define UART_USE_OS(br)		((UART_D1(br) >= 16UL) && (UART_ERR_OS(br) <= UART_ERR_LF(br) + UART_JIT_LF(br)))
+
+// Register values and resulting error
+#define UART_BRW(br)		((unsigned int)(UART_USE_OS(br) ? UART_D1(br)/16 : UART_D8(br)/8))
+#define UART_MCTL(br)		((unsigned char)(UART_USE_OS(br) ? (((UART_D1(br)%16) << 4) | UCOS16) : ((UART_D8(br)%8) << 1)))
+#define UART_ERROR(br)		(UART_USE_OS(br) ? UART_ERR_OS(br) : UART_ERR_LF(br) + UART_JIT_LF(br))
+
+// Timer paced DMA transmit, one byte per 10.25 bit times so TXBUF is always free
+#define UART_DMA_PERIOD(br)	(((SMCLK_RATE/4UL)*41UL + (br) - 1) / (br))
+
+/*
+ * Budget checks for the configured rates
+ */
+#if (UART_D8(MODEM_BR1) < 24UL) || (UART_ERROR(MODEM_BR1) > UART_ERR_BUDGET)
+#error "MODEM_BR1 is not reachable from SMCLK_RATE within UART_ERR_BUDGET"
+#endif
+
+#if (UART_D8(MODEM_BR2) < 24UL) || (UART_ERROR(MODEM_BR2) > UART_ERR_BUDGET)
+#error "MODEM_BR2 is not reachable from SMCLK_RATE within UART_ERR_BUDGET"
+#endif
+
+#if (UART_D8(USB_BR) < 24UL) || (UART_ERROR(USB_BR) > UART_ERR_BUDGET)
+#error "USB_BR is not reachable from SMCLK_RATE within UART_ERR_BUDGET"
+#endif
+
+#if (UART_DMA_PERIOD(MODEM_BR1) > 65536UL) || (UART_DMA_PERIOD(USB_BR) > 65536UL)
+#error "UART_DMA_PERIOD does not fit the 16 bit timer"
+#endif
+
+#if (UART_D8(UART_BR) < 24UL) || (UART_ERROR(UART_BR) > UART_ERR_BUDGET)
+#error "UART_BR is not reachable from SMCLK_RATE within UART_ERR_BUDGET"
+#endif
+
+#endif /* UART_BAUD_H_ */